@@ -0,0 +1,265 @@
+/**
+ * Copyright (c) 2011-2019 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "batch.hpp"
+
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <bitcoin/client.hpp>
+
+using namespace bc::client;
+using namespace bc::system;
+using namespace bc::system::chain;
+using namespace bc::system::wallet;
+using namespace std::chrono;
+
+static const int32_t retries = 3;
+static const uint32_t timeout_milliseconds = 30000;
+static const uint32_t poll_milliseconds = 10;
+
+batch::batch(std::istream& commands, std::ostream& output,
+    size_t concurrency)
+  : commands_(commands),
+    output_(output),
+    concurrency_(concurrency == 0 ? 1 : concurrency),
+    outstanding_(0),
+    failures_(0),
+    connection_(retries)
+{
+}
+
+int batch::run(const std::string& server)
+{
+    if (!connection_.connect(config::endpoint(server)))
+    {
+        std::cerr << "Failed to connect to " << server << std::endl;
+        return -1;
+    }
+
+    size_t line = 0;
+    auto exhausted = false;
+    deadline_ = steady_clock::now() + milliseconds(timeout_milliseconds);
+
+    while (!exhausted || outstanding_ != 0)
+    {
+        // Keep the window of outstanding queries full.
+        std::string text;
+        while (outstanding_ < concurrency_ && !exhausted)
+        {
+            if (!std::getline(commands_, text))
+                exhausted = true;
+            else if (!issue(++line, text))
+                ++failures_;
+        }
+
+        if (outstanding_ == 0)
+            continue;
+
+        // Zero wait fails the queries that remain with a timeout.
+        if (connection_.poll(poll_milliseconds) &&
+            steady_clock::now() >= deadline_)
+            connection_.wait(0);
+    }
+
+    output_.flush();
+    return failures_ == 0 ? 0 : -1;
+}
+
+bool batch::issue(size_t line, const std::string& text)
+{
+    std::stringstream reader(text);
+    std::string command;
+    reader >> command;
+
+    if (command.empty() || command.front() == '#')
+        return true;
+
+    const auto start = steady_clock::now();
+
+    if (command == "version")
+    {
+        auto handler = [=](const code& ec, const std::string& version)
+        {
+            complete(line, command, start, ec, quote(version));
+        };
+
+        ++outstanding_;
+        connection_.server_version(handler);
+        return true;
+    }
+
+    if (command == "height")
+    {
+        auto handler = [=](const code& ec, size_t height)
+        {
+            complete(line, command, start, ec, std::to_string(height));
+        };
+
+        ++outstanding_;
+        connection_.blockchain_fetch_last_height(handler);
+        return true;
+    }
+
+    std::string argument;
+    reader >> argument;
+
+    if (command == "header")
+    {
+        hash_digest hash;
+        if (!decode_hash(hash, argument))
+        {
+            reject(line, command, start, "invalid hash");
+            return false;
+        }
+
+        auto handler = [=](const code& ec, const header& header)
+        {
+            if (ec)
+            {
+                complete(line, command, start, ec, {});
+                return;
+            }
+
+            std::ostringstream result;
+            result
+                << "{\"hash\":" << quote(encode_hash(header.hash()))
+                << ",\"version\":" << header.version()
+                << ",\"previous\":"
+                << quote(encode_hash(header.previous_block_hash()))
+                << ",\"merkle_root\":"
+                << quote(encode_hash(header.merkle_root()))
+                << ",\"timestamp\":" << header.timestamp()
+                << ",\"bits\":" << header.bits()
+                << ",\"nonce\":" << header.nonce() << "}";
+
+            complete(line, command, start, ec, result.str());
+        };
+
+        ++outstanding_;
+        connection_.blockchain_fetch_block_header(handler, hash);
+        return true;
+    }
+
+    if (command == "history")
+    {
+        const payment_address address(argument);
+        if (!address)
+        {
+            reject(line, command, start, "invalid address");
+            return false;
+        }
+
+        auto handler = [=](const code& ec, const history::list& rows)
+        {
+            std::ostringstream result;
+            result << "[";
+            for (auto row = rows.begin(); row != rows.end(); ++row)
+            {
+                const auto spent = row->spend.hash() != null_hash;
+                result
+                    << (row == rows.begin() ? "" : ",")
+                    << "{\"output\":" << quote(encode_hash(row->output.hash()))
+                    << ",\"index\":" << row->output.index()
+                    << ",\"height\":" << row->output_height
+                    << ",\"value\":" << row->value
+                    << ",\"spent\":" << (spent ? "true" : "false") << "}";
+            }
+
+            result << "]";
+            complete(line, command, start, ec, result.str());
+        };
+
+        ++outstanding_;
+        connection_.blockchain_fetch_history4(handler,
+            script_key(address.output_script()));
+        return true;
+    }
+
+    reject(line, command, start, "unknown command");
+    return false;
+}
+
+void batch::complete(size_t line, const std::string& command,
+    time_point start, const code& ec, const std::string& result)
+{
+    const auto now = steady_clock::now();
+    const auto latency = duration_cast<microseconds>(now - start).count();
+
+    // Queries expire when none completes within the timeout.
+    deadline_ = now + milliseconds(timeout_milliseconds);
+    --outstanding_;
+
+    output_ << "{\"line\":" << line << ",\"command\":" << quote(command)
+        << ",\"latency_us\":" << latency;
+
+    if (ec)
+    {
+        ++failures_;
+        output_ << ",\"error\":" << quote(ec.message()) << "}\n";
+        return;
+    }
+
+    output_ << ",\"result\":" << result << "}\n";
+}
+
+void batch::reject(size_t line, const std::string& command,
+    time_point start, const std::string& reason)
+{
+    const auto latency = duration_cast<microseconds>(
+        steady_clock::now() - start).count();
+
+    output_ << "{\"line\":" << line << ",\"command\":" << quote(command)
+        << ",\"latency_us\":" << latency
+        << ",\"error\":" << quote(reason) << "}\n";
+}
+
+std::string batch::quote(const std::string& text)
+{
+    std::ostringstream out;
+    out << '"';
+
+    for (const auto character: text)
+    {
+        switch (character)
+        {
+            case '"': out << "\\\""; break;
+            case '\\': out << "\\\\"; break;
+            case '\n': out << "\\n"; break;
+            case '\r': out << "\\r"; break;
+            case '\t': out << "\\t"; break;
+            default:
+            {
+                // Control and non-ascii bytes are escaped, so that the line
+                // remains valid JSON whatever the encoding of the text.
+                const auto byte = static_cast<uint8_t>(character);
+                if (byte < 0x20 || byte >= 0x80)
+                    out << "\\u" << std::hex << std::setw(4)
+                        << std::setfill('0') << static_cast<int>(byte)
+                        << std::dec;
+                else
+                    out << character;
+            }
+        }
+    }
+
+    out << '"';
+    return out.str();
+}
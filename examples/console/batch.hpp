@@ -0,0 +1,88 @@
+/**
+ * Copyright (c) 2011-2019 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef BITCOIN_CLIENT_BATCH_HPP
+#define BITCOIN_CLIENT_BATCH_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <bitcoin/client.hpp>
+
+/**
+ * Executes a file of console commands over one connection, keeping a
+ * bounded number of queries outstanding, and writes each result as a line
+ * of JSON with the latency of its query.
+ *
+ * Supported commands are version, height, header <hash> and
+ * history <address>. Blank lines and lines starting with '#' are skipped.
+ */
+class batch
+{
+public:
+    /**
+     * Constructor, the streams are not owned by the batch.
+     */
+    batch(std::istream& commands, std::ostream& output, size_t concurrency);
+
+    /**
+     * Connects to the server and executes all commands, returning the
+     * process exit code (nonzero if the connection or any command failed).
+     */
+    int run(const std::string& server);
+
+private:
+    typedef std::chrono::steady_clock::time_point time_point;
+
+    /**
+     * Parses and issues the command, returning false if it is invalid.
+     */
+    bool issue(size_t line, const std::string& text);
+
+    /**
+     * Writes the result of a completed query as a JSON line.
+     */
+    void complete(size_t line, const std::string& command, time_point start,
+        const bc::system::code& ec, const std::string& result);
+
+    /**
+     * Writes a JSON line for a command that could not be issued.
+     */
+    void reject(size_t line, const std::string& command, time_point start,
+        const std::string& reason);
+
+    /**
+     * Quotes the text as a JSON string.
+     */
+    static std::string quote(const std::string& text);
+
+    /**
+     * Private members.
+     */
+    std::istream& commands_;
+    std::ostream& output_;
+    const size_t concurrency_;
+    size_t outstanding_;
+    size_t failures_;
+    time_point deadline_;
+    bc::client::obelisk_client connection_;
+};
+
+#endif
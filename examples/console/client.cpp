@@ -18,6 +18,7 @@
  */
 #include "client.hpp"
 
+#include <chrono>
 #include <iostream>
 #include <memory>
 #include <sstream>
@@ -30,9 +31,11 @@ using namespace bc::protocol;
 using namespace bc::system;
 using namespace bc::system::chain;
 using namespace bc::system::wallet;
+using namespace std::chrono;
 
 client::client()
-  : done_(false)
+  : done_(false),
+    timeout_milliseconds_(30000)
 {
 }
 
@@ -93,7 +96,7 @@ void client::cmd_version(std::stringstream&)
     };
 
     connection_->server_version(handler);
-    connection_->wait();
+    restart_timeout();
 }
 
 void client::cmd_height(std::stringstream&)
@@ -114,7 +117,7 @@ void client::cmd_height(std::stringstream&)
     };
 
     connection_->blockchain_fetch_last_height(handler);
-    connection_->wait();
+    restart_timeout();
 }
 
 void client::cmd_history(std::stringstream& args)
@@ -139,9 +142,9 @@ void client::cmd_history(std::stringstream& args)
                 std::cout << "History value: " << row.value << std::endl;
     };
 
-    const auto key = sha256_hash(address.output_script().to_data(false));
-    connection_->blockchain_fetch_history4(handler, key);
-    connection_->wait();
+    connection_->blockchain_fetch_history4(handler,
+        script_key(address.output_script()));
+    restart_timeout();
 }
 
 void client::cmd_header(std::stringstream& args)
@@ -178,29 +181,66 @@ void client::cmd_header(std::stringstream& args)
     };
 
     connection_->blockchain_fetch_block_header(handler, hash);
-    connection_->wait();
+    restart_timeout();
 }
 
 int client::run()
 {
-    static const size_t delay_milliseconds = 100;
+    static const int32_t delay_milliseconds = 100;
 
     std::cout << "Type \"help\" for supported instructions" << std::endl;
     terminal_.show_prompt();
 
     const auto terminal_socket_id = terminal_.socket().id();
-    zmq::poller poller;
-    poller.add(terminal_.socket());
 
-    while (!poller.terminated() && !done_)
+    // Queries remain outstanding while the terminal accepts commands. The
+    // terminal and the connection are waited on together, so that either
+    // wakes the loop, and responses are processed as soon as they arrive.
+    while (!done_)
     {
-        if (poller.wait(delay_milliseconds).contains(terminal_socket_id))
+        const auto pending = connection_ && connection_->poll();
+        if (pending)
+            check_timeout();
+
+        zmq::poller poller;
+        poller.add(terminal_.socket());
+        if (connection_)
+            connection_->add_sockets(poller);
+
+        const auto delay = pending ? remaining_milliseconds() :
+            delay_milliseconds;
+
+        const auto identifiers = poller.wait(delay);
+        if (poller.terminated())
+            break;
+
+        if (identifiers.contains(terminal_socket_id))
             command();
     }
 
     return 0;
 }
 
+void client::restart_timeout()
+{
+    deadline_ = steady_clock::now() + milliseconds(timeout_milliseconds_);
+}
+
+void client::check_timeout()
+{
+    // Zero wait fails the queries that remain with a timeout.
+    if (steady_clock::now() >= deadline_)
+        connection_->wait(0);
+}
+
+int32_t client::remaining_milliseconds() const
+{
+    const auto remaining = duration_cast<milliseconds>(deadline_ -
+        steady_clock::now()).count();
+
+    return remaining < 0 ? 0 : static_cast<int32_t>(remaining);
+}
+
 void client::command()
 {
     typedef std::function<void(std::stringstream&)> handler;
@@ -220,6 +260,17 @@ void client::command()
     };
 
     std::stringstream reader(terminal_.get_line());
+
+    // At the end of piped input the outstanding queries complete first.
+    if (terminal_.end_of_input())
+    {
+        if (connection_)
+            connection_->wait(remaining_milliseconds());
+
+        done_ = true;
+        return;
+    }
+
     std::string command;
     reader >> command;
 
@@ -19,6 +19,7 @@
 #ifndef BITCOIN_CLIENT_CLIENT_HPP
 #define BITCOIN_CLIENT_CLIENT_HPP
 
+#include <chrono>
 #include <iostream>
 #include <memory>
 #include <sstream>
@@ -39,7 +40,8 @@ public:
 
     /**
      * The main loop for the example application. This loop can be woken up
-     * by either events from the network or by input from the terminal.
+     * by either events from the network or by input from the terminal, and
+     * any number of queries may be outstanding while commands are entered.
      */
     int run();
 
@@ -62,6 +64,21 @@ private:
      */
     void command();
 
+    /**
+     * Restarts the timeout of outstanding queries after issuing a query.
+     */
+    void restart_timeout();
+
+    /**
+     * Fails outstanding queries if none has been issued within the timeout.
+     */
+    void check_timeout();
+
+    /**
+     * The time remaining until outstanding queries time out.
+     */
+    int32_t remaining_milliseconds() const;
+
     /**
      * Parses a string argument out of the command line, or prints an error
      * message if there is none.
@@ -86,6 +103,8 @@ private:
      * Private members.
      */
     bool done_;
+    uint32_t timeout_milliseconds_;
+    std::chrono::steady_clock::time_point deadline_;
     read_line terminal_;
     std::shared_ptr<bc::client::obelisk_client> connection_;
 };
@@ -16,10 +16,33 @@
  * You should have received a copy of the GNU Affero General Public License
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include "batch.hpp"
 #include "client.hpp"
 
-int main()
+// Usage: console [<server> <command-file> [<concurrency>]]
+int main(int argc, char* argv[])
 {
-    client client;
-    return client.run();
+    static const size_t default_concurrency = 100;
+
+    if (argc < 3)
+    {
+        client client;
+        return client.run();
+    }
+
+    std::ifstream file(argv[2]);
+    if (!file)
+    {
+        std::cerr << "Failed to open " << argv[2] << std::endl;
+        return -1;
+    }
+
+    const size_t concurrency = argc > 3 ?
+        std::strtoul(argv[3], nullptr, 10) : default_concurrency;
+
+    batch batch(file, std::cout, concurrency);
+    return batch.run(argv[1]);
 }
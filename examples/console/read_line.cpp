@@ -18,7 +18,6 @@
  */
 #include "read_line.hpp"
 
-#include <cstring>
 #include <iostream>
 #include <memory>
 #include <string>
@@ -32,7 +31,8 @@ uint32_t signal_halt = 0;
 uint32_t signal_continue = 1;
 
 read_line::read_line()
-  : socket_(context_, zmq::socket::role::requester)
+  : socket_(context_, zmq::socket::role::requester),
+    end_of_input_(false)
 {
     DEBUG_ONLY(const auto ec =) socket_.bind({ "inproc://terminal" });
     BITCOIN_ASSERT(!ec);
@@ -70,12 +70,21 @@ std::string read_line::get_line()
         zmq::message message;
         ec = socket_.receive(message);
         BITCOIN_ASSERT(!ec);
-        return message.dequeue_text();
+
+        uint32_t signal;
+        const auto text = message.dequeue_text();
+        end_of_input_ = message.dequeue(signal) && signal == signal_halt;
+        return text;
     }
 
     return{};
 }
 
+bool read_line::end_of_input() const
+{
+    return end_of_input_;
+}
+
 void read_line::run()
 {
     zmq::socket socket(context_, zmq::socket::role::replier);
@@ -92,13 +101,14 @@ void read_line::run()
         if (!message.dequeue(signal) || signal == signal_halt)
             break;
 
-        // Read input:
-        char line[1000];
-        std::cin.getline(line, sizeof(line));
-        std::string text(line);
+        // Read input, signaling the end of input so that the console closes.
+        std::string text;
+        const auto input = std::getline(std::cin, text) ? signal_continue :
+            signal_halt;
 
         zmq::message response;
         response.enqueue(text);
+        response.enqueue_little_endian(input);
         ec = socket.send(response);
         BITCOIN_ASSERT(!ec);
     }
@@ -65,6 +65,12 @@ public:
      */
     std::string get_line();
 
+    /**
+     * True if the line retrieved by `get_line` was not read because the
+     * terminal input has ended.
+     */
+    bool end_of_input() const;
+
     virtual bc::protocol::zmq::socket& socket();
 
 private:
@@ -73,6 +79,7 @@ private:
     bc::protocol::zmq::context context_;
     bc::protocol::zmq::socket socket_;
     std::shared_ptr<std::thread> thread_;
+    bool end_of_input_;
 };
 
 #endif
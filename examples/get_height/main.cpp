@@ -16,22 +16,244 @@
  * You should have received a copy of the GNU Affero General Public License
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
 #include <iostream>
 #include <memory>
+#include <string>
+#include <thread>
+#include <vector>
 #include <bitcoin/client.hpp>
 
 using namespace bc::system;
 using namespace bc::client;
 using namespace bc::protocol;
+using namespace std::chrono;
+
+// Latency histogram bucket upper bounds, in milliseconds.
+static const std::vector<uint32_t> buckets
+{
+    1, 2, 5, 10, 20, 50, 100, 200, 500, 1000, 2000, 5000
+};
+
+// Cumulative statistics are reported each time this many samples complete.
+static const size_t report_interval = 100;
+
+static const uint32_t timeout_milliseconds = 30000;
+
+struct probe
+{
+    std::string server;
+    std::shared_ptr<obelisk_client> client;
+
+    // From connect to the first response, which includes connection setup
+    // as the connect itself is asynchronous.
+    microseconds connect_time;
+
+    // State of the current sample.
+    steady_clock::time_point start;
+    microseconds latency;
+    bool done;
+    code ec;
+    size_t height;
+
+    // Cumulative statistics.
+    std::vector<size_t> histogram;
+    size_t samples;
+    size_t failures;
+    size_t max_lag;
+};
+
+static double to_milliseconds(microseconds duration)
+{
+    return duration.count() / 1000.0;
+}
+
+static void report(const std::vector<probe>& probes)
+{
+    for (const auto& probe: probes)
+    {
+        std::cout << probe.server
+            << " connect_ms=" << to_milliseconds(probe.connect_time)
+            << " samples=" << probe.samples
+            << " failures=" << probe.failures
+            << " max_lag=" << probe.max_lag << std::endl;
+
+        std::cout << "  latency_ms";
+        for (size_t bucket = 0; bucket < buckets.size(); ++bucket)
+            std::cout << " <" << buckets[bucket] << ":"
+                << probe.histogram[bucket];
+
+        std::cout << " >=" << buckets.back() << ":" << probe.histogram.back()
+            << std::endl;
+    }
+}
+
+// Fetch the height from every server at once, each timed from its start.
+static void fetch(std::vector<probe>& probes, zmq::poller& poller)
+{
+    for (auto& probe: probes)
+    {
+        const auto handler = [&probe](const code& ec, size_t height)
+        {
+            probe.latency = duration_cast<microseconds>(
+                steady_clock::now() - probe.start);
+            probe.done = true;
+            probe.ec = ec;
+            probe.height = height;
+        };
+
+        probe.done = false;
+        probe.client->blockchain_fetch_last_height(handler);
+    }
+
+    const auto deadline = steady_clock::now() +
+        milliseconds(timeout_milliseconds);
+
+    // The servers are waited on together, so that each response is handled
+    // (and its latency taken) as soon as it arrives. Every client is polled
+    // so that late responses to an earlier sample do not wake the poller.
+    auto now = steady_clock::now();
+    while (now < deadline)
+    {
+        auto pending = false;
+        for (auto& probe: probes)
+            pending |= probe.client->poll() && !probe.done;
+
+        if (!pending)
+            break;
+
+        const auto remaining = duration_cast<milliseconds>(deadline - now);
+        poller.wait(static_cast<int32_t>(remaining.count()));
+        if (poller.terminated())
+            break;
+
+        now = steady_clock::now();
+    }
+
+    // Zero wait fails the queries that remain with a timeout.
+    for (auto& probe: probes)
+        if (!probe.done)
+            probe.client->wait(0);
+}
+
+// Sample the height of every server and record the results.
+static void sample(std::vector<probe>& probes, zmq::poller& poller)
+{
+    for (auto& probe: probes)
+        probe.start = steady_clock::now();
+
+    fetch(probes, poller);
+
+    size_t top = 0;
+    for (const auto& probe: probes)
+        if (!probe.ec)
+            top = std::max(top, probe.height);
+
+    for (auto& probe: probes)
+    {
+        ++probe.samples;
+
+        if (probe.ec)
+        {
+            ++probe.failures;
+            std::cout << probe.server << " error=\"" << probe.ec.message()
+                << "\"" << std::endl;
+            continue;
+        }
+
+        // Tip lag is relative to the highest server in the sample.
+        const auto lag = top - probe.height;
+        probe.max_lag = std::max(probe.max_lag, lag);
+
+        const auto latency = to_milliseconds(probe.latency);
+        const auto bucket = std::upper_bound(buckets.begin(), buckets.end(),
+            latency) - buckets.begin();
+        ++probe.histogram[bucket];
+
+        std::cout << probe.server
+            << " height=" << probe.height
+            << " latency_ms=" << latency
+            << " lag=" << lag << std::endl;
+    }
+}
+
+static int run_probe(uint32_t interval_milliseconds, size_t samples,
+    const std::vector<std::string>& servers)
+{
+    std::vector<probe> probes;
+    probes.reserve(servers.size());
+
+    // The sockets of every client are waited on by one poller.
+    zmq::poller poller;
+
+    for (const auto& server: servers)
+    {
+        const auto start = steady_clock::now();
+        const auto client = std::make_shared<obelisk_client>();
+        if (!client->connect(config::endpoint(server)))
+        {
+            std::cerr << "Failed to connect to " << server << std::endl;
+            return 1;
+        }
+
+        client->add_sockets(poller);
+        probes.push_back({ server, client, {}, start, {}, false, {}, 0,
+            std::vector<size_t>(buckets.size() + 1, 0), 0, 0, 0 });
+    }
+
+    // The first response completes the connection, timed from its start.
+    fetch(probes, poller);
+
+    for (auto& probe: probes)
+    {
+        probe.connect_time = probe.latency;
+        if (probe.ec)
+            std::cout << probe.server << " connect error=\""
+                << probe.ec.message() << "\"" << std::endl;
+        else
+            std::cout << probe.server << " connect_ms="
+                << to_milliseconds(probe.connect_time) << std::endl;
+    }
+
+    // Zero samples probes until the process is terminated.
+    for (size_t count = 1; samples == 0 || count <= samples; ++count)
+    {
+        const auto next = steady_clock::now() +
+            milliseconds(interval_milliseconds);
+
+        sample(probes, poller);
+
+        if (count % report_interval == 0 || count == samples)
+            report(probes);
+
+        std::this_thread::sleep_until(next);
+    }
+
+    return 0;
+}
 
 /**
  * A minimal example that connects to a server and fetches height.
+ * In probe mode it samples height and latency from each server at the
+ * given interval, reporting tip lag between them and latency histograms.
  */
 int main(int argc, char* argv[])
 {
+    if (argc > 3)
+    {
+        std::vector<std::string> servers(argv + 3, argv + argc);
+        return run_probe(std::strtoul(argv[1], nullptr, 10),
+            std::strtoul(argv[2], nullptr, 10), servers);
+    }
+
     if (argc != 2)
     {
         std::cerr << "usage: " << argv[0] << " <server>" << std::endl;
+        std::cerr << "usage: " << argv[0]
+            << " <interval-ms> <samples> <server>..." << std::endl;
         return 1;
     }
 
@@ -16,9 +16,27 @@
 
 #include <bitcoin/system.hpp>
 #include <bitcoin/protocol.hpp>
+#include <bitcoin/client/client_state.hpp>
+#include <bitcoin/client/conflict_detector.hpp>
+#include <bitcoin/client/consistency_checker.hpp>
 #include <bitcoin/client/define.hpp>
+#include <bitcoin/client/fee_estimator.hpp>
+#include <bitcoin/client/hash_batch.hpp>
+#include <bitcoin/client/header_buffer.hpp>
 #include <bitcoin/client/history.hpp>
+#include <bitcoin/client/history_verifier.hpp>
+#include <bitcoin/client/memory_cache.hpp>
+#include <bitcoin/client/mempool_mirror.hpp>
+#include <bitcoin/client/notification_coalescer.hpp>
 #include <bitcoin/client/obelisk_client.hpp>
+#include <bitcoin/client/response_cache.hpp>
+#include <bitcoin/client/script_keys.hpp>
+#include <bitcoin/client/sharded_cache.hpp>
+#include <bitcoin/client/subscription_table.hpp>
+#include <bitcoin/client/traffic_recorder.hpp>
+#include <bitcoin/client/verification.hpp>
 #include <bitcoin/client/version.hpp>
+#include <bitcoin/client/wallet_scanner.hpp>
+#include <bitcoin/client/watch_wallet.hpp>
 
 #endif
@@ -0,0 +1,88 @@
+/**
+ * Copyright (c) 2011-2019 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_CLIENT_CLIENT_STATE_HPP
+#define LIBBITCOIN_CLIENT_CLIENT_STATE_HPP
+
+#include <cstdint>
+#include <istream>
+#include <map>
+#include <string>
+#include <vector>
+#include <bitcoin/system.hpp>
+#include <bitcoin/client/define.hpp>
+
+namespace libbitcoin {
+namespace client {
+
+/// Durable client state, persisted across process restarts so that
+/// subscriptions can be restored in bulk and only deltas fetched.
+class BCC_API client_state
+{
+public:
+    /// A subscribed key with the last notification received for it.
+    struct subscription
+    {
+        typedef std::vector<subscription> list;
+
+        system::hash_digest key;
+        uint16_t sequence;
+
+        /// Highest confirmed height notified, history is refetched from here.
+        uint32_t height;
+    };
+
+    /// Named heights maintained by the application (such as scan progress).
+    typedef std::map<std::string, uint32_t> watermark_map;
+
+    static const uint32_t version;
+
+    /// Construct an empty state.
+    client_state();
+
+    bool from_data(const system::data_chunk& data);
+    bool from_data(std::istream& stream);
+    bool from_data(system::istream_reader& source);
+    system::data_chunk to_data() const;
+    void to_data(std::ostream& stream) const;
+    void to_data(system::ostream_writer& sink) const;
+
+    /// Load the state from a file written by save.
+    bool load(const std::string& path);
+
+    /// Write the state to a file, replacing any previous file atomically.
+    /// The file is flushed to storage before it replaces the previous file,
+    /// which is retained if the state cannot be saved.
+    bool save(const std::string& path) const;
+
+    void reset();
+
+    /// The height of the last of the tip headers.
+    uint32_t tip_height;
+
+    /// The most recent headers of the chain, in height order.
+    system::chain::header::list tip_headers;
+
+    watermark_map watermarks;
+    subscription::list subscriptions;
+};
+
+} // namespace client
+} // namespace libbitcoin
+
+#endif
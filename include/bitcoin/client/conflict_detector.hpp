@@ -0,0 +1,106 @@
+/**
+ * Copyright (c) 2011-2019 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_CLIENT_CONFLICT_DETECTOR_HPP
+#define LIBBITCOIN_CLIENT_CONFLICT_DETECTOR_HPP
+
+#include <cstddef>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+#include <bitcoin/system.hpp>
+#include <bitcoin/client/define.hpp>
+#include <bitcoin/client/mempool_mirror.hpp>
+
+namespace libbitcoin {
+namespace client {
+
+/// Detects double spends of the wallet's own unconfirmed transactions.
+/// The outpoints spent by each watched transaction are indexed, and the
+/// spends of transactions from the transaction notification stream, from
+/// key notifications (resolved through the mempool mirror) and from blocks
+/// are checked against the index as they arrive.
+///
+/// Safe for use by multiple threads, the handler is invoked unlocked.
+class BCC_API conflict_detector
+{
+public:
+    /// A spend of an outpoint of a watched transaction by another.
+    struct conflict
+    {
+        system::chain::point outpoint;
+        system::hash_digest watched;
+        system::hash_digest spender;
+
+        /// True if the spender has been confirmed in a block.
+        bool confirmed;
+    };
+
+    typedef std::vector<conflict> list;
+    typedef std::function<void(const conflict&)> conflict_handler;
+
+    conflict_detector(conflict_handler handler);
+
+    /// Watch the outpoints spent by the wallet's unconfirmed transaction.
+    /// Returns false if already watched.
+    bool watch(const system::chain::transaction& tx);
+
+    /// Stop watching the transaction, returning false if not watched.
+    bool unwatch(const system::hash_digest& tx_hash);
+
+    /// Check the spends of an announced transaction, returning conflicts.
+    list check(const system::chain::transaction& tx);
+
+    /// Check the spends of the notified transaction if it is mirrored,
+    /// returning false if not (so that the caller may fetch and check it).
+    bool check(list& out, const system::hash_digest& tx_hash,
+        const mempool_mirror& mirror);
+
+    /// Stop watching transactions confirmed by the block, and check its
+    /// transactions, returning (confirmed) conflicts. A confirmed watched
+    /// transaction conflicts with other watched spenders of its outpoints.
+    list confirm(const system::chain::block& block);
+
+    /// The number of watched transactions.
+    size_t size() const;
+
+private:
+    typedef std::unordered_multimap<system::chain::point,
+        system::hash_digest> outpoint_map;
+    typedef std::unordered_map<system::hash_digest,
+        system::chain::point::list> watched_map;
+
+    // Find conflicts of the spends of the transaction (shared lock required).
+    void find(list& out, const system::hash_digest& tx_hash,
+        const system::chain::point::list& spends, bool confirmed) const;
+
+    // Remove the watched transaction (exclusive lock required).
+    bool remove(const system::hash_digest& tx_hash);
+
+    void notify(const list& conflicts) const;
+
+    const conflict_handler handler_;
+    outpoint_map outpoints_;
+    watched_map watched_;
+    mutable system::shared_mutex mutex_;
+};
+
+} // namespace client
+} // namespace libbitcoin
+
+#endif
@@ -0,0 +1,97 @@
+/**
+ * Copyright (c) 2011-2019 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_CLIENT_CONSISTENCY_CHECKER_HPP
+#define LIBBITCOIN_CLIENT_CONSISTENCY_CHECKER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <bitcoin/system.hpp>
+#include <bitcoin/client/define.hpp>
+#include <bitcoin/client/history.hpp>
+#include <bitcoin/client/obelisk_client.hpp>
+
+namespace libbitcoin {
+namespace client {
+
+/// Issues identical queries to several servers concurrently and compares
+/// digests of the decoded results.
+class BCC_API consistency_checker
+{
+public:
+    typedef std::vector<obelisk_client*> client_list;
+
+    /// The outcome of a check, indexed in the order of the clients.
+    struct report
+    {
+        /// The height at which the servers were compared.
+        size_t height;
+
+        /// The result of each query, the digest is meaningful only if the
+        /// corresponding code is success.
+        std::vector<system::code> codes;
+        system::hash_list digests;
+
+        /// True if all queries succeeded with equal digests.
+        bool consistent() const;
+
+        /// Indexes of the servers that differ from the first successful one.
+        std::vector<size_t> divergent() const;
+    };
+
+    /// The clients must be connected and are not owned by the checker.
+    consistency_checker(const client_list& clients,
+        uint32_t timeout_milliseconds=30000);
+
+    /// Compare block headers at the lowest height reported by the servers.
+    report check_tip();
+
+    /// Compare the block header at the given height.
+    report check_header(size_t height);
+
+    /// Compare the header and transaction hashes of the block at the given
+    /// height, both of which are fetched from every server.
+    report check_block(size_t height);
+
+    /// Compare the history of the script hash key. Servers offer no digest
+    /// of history, so rows are fetched in full and compared by digest.
+    report check_history(const system::hash_digest& key,
+        uint32_t from_height=0);
+
+    /// The digest of transaction hashes, in block order.
+    static system::hash_digest hashes_digest(const system::hash_list& hashes);
+
+    /// The digest of history rows, independent of their order.
+    static system::hash_digest history_digest(const history::list& rows);
+
+private:
+    report make_report(size_t height) const;
+
+    // Resolve the queries outstanding on every client, polling all of them
+    // together until the timeout and then expiring those that remain.
+    void wait();
+
+    const client_list clients_;
+    const uint32_t timeout_milliseconds_;
+};
+
+} // namespace client
+} // namespace libbitcoin
+
+#endif
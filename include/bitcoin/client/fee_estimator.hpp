@@ -0,0 +1,130 @@
+/**
+ * Copyright (c) 2011-2019 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_CLIENT_FEE_ESTIMATOR_HPP
+#define LIBBITCOIN_CLIENT_FEE_ESTIMATOR_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include <bitcoin/system.hpp>
+#include <bitcoin/client/define.hpp>
+#include <bitcoin/client/mempool_mirror.hpp>
+
+namespace libbitcoin {
+namespace client {
+
+/// Estimates the fee rate required for confirmation within a number of
+/// blocks, from the transaction and block notification streams. Announced
+/// transactions of known fee rate (computed by the mempool mirror from their
+/// previous outputs) are tracked in fixed exponentially spaced fee rate
+/// buckets, and the blocks taken to confirm them are accumulated per bucket
+/// with exponential decay. Estimates are recomputed on each block, so that
+/// queries are constant time.
+///
+/// Safe for use by multiple threads.
+class BCC_API fee_estimator
+{
+public:
+    struct settings
+    {
+        /// The lower bound of the lowest bucket, in satoshis per 1000 bytes.
+        uint64_t minimum_rate;
+
+        /// The ratio of the bounds of consecutive buckets.
+        double spacing;
+
+        /// The number of buckets.
+        size_t buckets;
+
+        /// The largest confirmation target, in blocks.
+        size_t maximum_target;
+
+        /// The ratio of transactions confirmed within the target required
+        /// of the buckets at or above an estimate.
+        double success_ratio;
+
+        /// The factor applied to accumulated history on each block.
+        double decay;
+
+        /// The decayed number of transactions required to judge buckets.
+        double minimum_samples;
+    };
+
+    static const settings default_settings;
+
+    /// Settings of zero buckets or a zero maximum target are rejected, the
+    /// estimator is then invalid, tracks nothing and estimates zero.
+    fee_estimator(const settings& settings=default_settings);
+
+    /// Track the mirrored transaction from the block in which it was
+    /// announced, ignored if its fee is unknown or it is already tracked.
+    bool track(const mempool_mirror::entry& entry);
+
+    /// Stop tracking a transaction that can no longer confirm, as when the
+    /// mirror replaces or expires it (see mempool_mirror::removal_handler),
+    /// so that it is not counted as a failure. Returns false if not tracked.
+    bool untrack(const system::hash_digest& tx_hash);
+
+    /// Record the confirmation of tracked transactions in the block, which
+    /// must be the next block, and recompute the estimates. Transactions
+    /// unconfirmed beyond the maximum target are counted as failures.
+    void confirm(const system::chain::block& block);
+
+    /// The lowest fee rate in satoshis per 1000 virtual bytes expected to
+    /// confirm within the target number of blocks (clamped to the range of
+    /// targets), or zero if there is insufficient data.
+    uint64_t estimate(size_t target) const;
+
+    /// False if the settings were rejected.
+    operator bool() const;
+
+    /// The number of transactions awaiting confirmation.
+    size_t tracked() const;
+
+private:
+    struct tracked_transaction
+    {
+        size_t bucket;
+        size_t height;
+    };
+
+    // These require the exclusive lock.
+    size_t bucket(uint64_t fee_rate) const;
+    void record(size_t bucket, size_t blocks);
+    void compute_estimates();
+
+    const settings settings_;
+    const bool valid_;
+    std::vector<uint64_t> bounds_;
+
+    // Decayed totals per bucket, and confirmations per bucket and target.
+    std::vector<double> totals_;
+    std::vector<double> confirmed_;
+
+    size_t height_;
+    std::unordered_map<system::hash_digest, tracked_transaction> tracked_;
+    std::vector<uint64_t> estimates_;
+    mutable system::shared_mutex mutex_;
+};
+
+} // namespace client
+} // namespace libbitcoin
+
+#endif
@@ -0,0 +1,72 @@
+/**
+ * Copyright (c) 2011-2019 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_CLIENT_HASH_BATCH_HPP
+#define LIBBITCOIN_CLIENT_HASH_BATCH_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <bitcoin/system.hpp>
+#include <bitcoin/client/define.hpp>
+
+namespace libbitcoin {
+namespace client {
+
+/// The transform used to hash a batch, automatic selects the fastest one the
+/// processor supports. The others are exposed so that each may be tested.
+enum class hash_implementation
+{
+    automatic,
+    portable,
+    shani,
+    avx2
+};
+
+/// True if the processor supports the implementation.
+BCC_API bool hash_supported(hash_implementation implementation);
+
+/// Compute the sha256 hash of each message.
+/// Messages are hashed several at a time using SHA-NI or AVX2 instructions
+/// when the processor supports them, with results equal to sha256_hash.
+BCC_API system::hash_list sha256_hash_batch(
+    const system::data_stack& messages);
+
+/// Compute the sha256 hash of each message using the given implementation,
+/// or the portable one if the processor does not support it.
+BCC_API system::hash_list sha256_hash_batch(
+    const system::data_stack& messages, hash_implementation implementation);
+
+/// Compute the bitcoin (double sha256) hash of each message, batched as above
+/// with results equal to bitcoin_hash.
+BCC_API system::hash_list bitcoin_hash_batch(
+    const system::data_stack& messages);
+
+/// Compute the bitcoin hash of each message using the given implementation,
+/// or the portable one if the processor does not support it.
+BCC_API system::hash_list bitcoin_hash_batch(
+    const system::data_stack& messages, hash_implementation implementation);
+
+/// Compute the bitcoin hash of each of count contiguous fixed size records,
+/// such as serialized headers or concatenated merkle node pairs.
+BCC_API system::hash_list bitcoin_hash_batch(const uint8_t* records,
+    size_t count, size_t record_size);
+
+} // namespace client
+} // namespace libbitcoin
+
+#endif
@@ -0,0 +1,71 @@
+/**
+ * Copyright (c) 2011-2019 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_CLIENT_HEADER_BUFFER_HPP
+#define LIBBITCOIN_CLIENT_HEADER_BUFFER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <bitcoin/system.hpp>
+#include <bitcoin/client/define.hpp>
+
+namespace libbitcoin {
+namespace client {
+
+/// A contiguous range of block headers, stored as serialized 80 byte
+/// records in height order. Headers are decoded only when accessed, and
+/// the records may be persisted or hashed in place.
+class BCC_API header_buffer
+{
+public:
+    static const size_t record_size = 80;
+
+    header_buffer();
+
+    /// Zero filled records for the given heights.
+    header_buffer(uint32_t start_height, size_t count);
+
+    /// The height of the first record.
+    uint32_t start_height() const;
+
+    /// The number of records.
+    size_t size() const;
+    bool empty() const;
+
+    /// The records, size() * record_size bytes.
+    const uint8_t* data() const;
+    uint8_t* data();
+
+    /// The serialized header at the index, which must be in range.
+    system::data_slice record(size_t index) const;
+
+    /// Decode the header at the index, which must be in range.
+    system::chain::header header(size_t index) const;
+
+    /// Set the record at the index, which must be in range.
+    void set(size_t index, const system::chain::header& header);
+
+private:
+    uint32_t start_height_;
+    system::data_chunk records_;
+};
+
+} // namespace client
+} // namespace libbitcoin
+
+#endif
@@ -0,0 +1,105 @@
+/**
+ * Copyright (c) 2011-2019 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_CLIENT_HISTORY_VERIFIER_HPP
+#define LIBBITCOIN_CLIENT_HISTORY_VERIFIER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <bitcoin/system.hpp>
+#include <bitcoin/client/define.hpp>
+#include <bitcoin/client/header_buffer.hpp>
+#include <bitcoin/client/history.hpp>
+#include <bitcoin/client/obelisk_client.hpp>
+
+namespace libbitcoin {
+namespace client {
+
+/// Verifies that the confirmed points of history rows are included in the
+/// blocks at their reported heights, against a locally verified header chain
+/// (simplified payment verification). The transaction hashes of each block
+/// are fetched once, verified against the merkle root of its header and
+/// cached, so that rows confirmed in the same block share the proof.
+class BCC_API history_verifier
+{
+public:
+    struct settings
+    {
+        /// Maximum number of block queries outstanding at once.
+        uint32_t concurrency;
+
+        /// Maximum time to wait on each round of queries.
+        uint32_t timeout_milliseconds;
+    };
+
+    static const settings default_settings;
+
+    /// The client must be connected and is not owned by the verifier.
+    history_verifier(obelisk_client& client,
+        const settings& settings=default_settings);
+
+    /// Adopt the headers against which rows are verified, clearing the cache.
+    /// The headers must link and satisfy their proof of work, otherwise none
+    /// are adopted and false is returned. The first header is trusted, so
+    /// the caller must anchor it (by checkpoint or a longer verified chain).
+    bool set_headers(const header_buffer& headers);
+
+    /// Verify the confirmed points of each row, setting a code per row:
+    /// not_found if a height is not covered by the headers or the block does
+    /// not contain the transaction, merkle_mismatch if the server's block
+    /// does not match its header, or the error of a failed query. Points
+    /// that are unconfirmed (height zero) are skipped, so a row without a
+    /// confirmed point succeeds. Returns success if every row is verified,
+    /// otherwise the first row failure.
+    system::code verify(const history::list& rows,
+        std::vector<system::code>& out_codes);
+
+    /// The number of blocks with cached verification results.
+    size_t cached_blocks() const;
+
+    /// Discard cached verification results.
+    void clear();
+
+private:
+    // The verified transaction hashes of a block.
+    struct block_entry
+    {
+        system::code ec;
+        std::unordered_set<system::hash_digest> hashes;
+    };
+
+    // Fetch and verify the blocks at the heights, in pipelined rounds.
+    system::code fetch_blocks(const std::vector<uint32_t>& heights);
+
+    // Verify the point of the transaction is confirmed at the height.
+    system::code verify_point(const system::hash_digest& tx_hash,
+        uint64_t height) const;
+
+    obelisk_client& client_;
+    const settings settings_;
+    header_buffer headers_;
+    std::unordered_map<uint32_t, block_entry> blocks_;
+};
+
+} // namespace client
+} // namespace libbitcoin
+
+#endif
@@ -0,0 +1,67 @@
+/**
+ * Copyright (c) 2011-2019 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_CLIENT_MEMORY_CACHE_HPP
+#define LIBBITCOIN_CLIENT_MEMORY_CACHE_HPP
+
+#include <cstddef>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <bitcoin/system.hpp>
+#include <bitcoin/client/define.hpp>
+#include <bitcoin/client/response_cache.hpp>
+
+namespace libbitcoin {
+namespace client {
+
+/// In-memory least recently used response cache, limited by payload bytes.
+class BCC_API memory_cache
+  : public response_cache
+{
+public:
+    /// Payloads larger than the capacity are not cached.
+    memory_cache(size_t capacity_bytes);
+
+    bool fetch(const system::hash_digest& key,
+        system::data_chunk& payload) override;
+    void store(const system::hash_digest& key,
+        const system::data_chunk& payload) override;
+    void clear() override;
+
+    /// The number of payload bytes currently cached.
+    size_t size() const;
+
+private:
+    typedef std::pair<system::hash_digest, system::data_chunk> entry;
+    typedef std::list<entry> entries;
+
+    const size_t capacity_;
+    size_t size_;
+
+    // Most recently used first.
+    entries entries_;
+    std::unordered_map<system::hash_digest, entries::iterator> index_;
+    mutable std::mutex mutex_;
+};
+
+} // namespace client
+} // namespace libbitcoin
+
+#endif
@@ -0,0 +1,146 @@
+/**
+ * Copyright (c) 2011-2019 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_CLIENT_MEMPOOL_MIRROR_HPP
+#define LIBBITCOIN_CLIENT_MEMPOOL_MIRROR_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+#include <bitcoin/system.hpp>
+#include <bitcoin/client/define.hpp>
+
+namespace libbitcoin {
+namespace client {
+
+/// A mirror of the server memory pool, maintained from the transaction and
+/// block notifications of obelisk_client::subscribe_transaction and
+/// subscribe_block (call store and confirm from those handlers). Indexes
+/// transactions by hash and the outpoints they spend by outpoint, so that
+/// conflicts and fee rates are known without a round trip.
+///
+/// Safe for use by multiple threads, the removal handler is invoked unlocked.
+class BCC_API mempool_mirror
+{
+public:
+    static const uint64_t unknown_fee = system::max_uint64;
+
+    /// A mirrored transaction.
+    struct entry
+    {
+        system::hash_digest hash;
+
+        /// Serialized size, including witness.
+        size_t size;
+
+        /// Weight divided by four, rounded up.
+        size_t virtual_size;
+
+        /// The fee, or unknown_fee if any previous output value is unknown.
+        uint64_t fee;
+
+        /// Seconds since the epoch at which the transaction was stored.
+        uint64_t time;
+
+        /// The previous outputs spent by the transaction.
+        system::chain::point::list spends;
+
+        /// The output values, from which the fees of children are computed.
+        std::vector<uint64_t> values;
+
+        /// The fee rate in satoshis per 1000 virtual bytes, zero if unknown.
+        uint64_t fee_rate() const;
+    };
+
+    typedef std::vector<entry> list;
+
+    /// Obtain the value of a previous output that is not mirrored, such as
+    /// from a cache of confirmed outputs, returning false if not known. It is
+    /// invoked by store before the mirror is locked, so it may block.
+    typedef std::function<bool(uint64_t&, const system::chain::point&)>
+        prevout_lookup;
+
+    /// Notified of each transaction removed other than by its confirmation,
+    /// as when replaced, conflicted by a block or expired, so that trackers
+    /// such as the fee estimator can forget it.
+    typedef std::function<void(const system::hash_digest&)> removal_handler;
+
+    mempool_mirror(prevout_lookup lookup=nullptr,
+        removal_handler on_remove=nullptr);
+
+    /// Mirror the transaction announced by the server, replacing (with their
+    /// descendants) any mirrored transactions that spend the same outputs.
+    /// Returns false if the transaction is a coinbase or already mirrored.
+    bool store(const system::chain::transaction& tx);
+
+    /// Remove the transactions confirmed by the block, and any (with their
+    /// descendants) that conflict with it. Returns the number removed.
+    size_t confirm(const system::chain::block& block);
+
+    /// Remove transactions stored more than the given seconds ago, with
+    /// their descendants, as the server may evict silently. Returns the
+    /// number removed.
+    size_t expire(uint64_t max_age_seconds);
+
+    /// Obtain the mirrored transaction, returning false if not mirrored.
+    bool find(entry& out, const system::hash_digest& tx_hash) const;
+
+    /// Obtain the hash of the mirrored spender of the outpoint, returning
+    /// false if there is none.
+    bool spender(system::hash_digest& out_hash,
+        const system::chain::point& outpoint) const;
+
+    /// The hashes of mirrored transactions, other than the transaction
+    /// itself, that spend any output spent by the transaction.
+    system::hash_list conflicts(const system::chain::transaction& tx) const;
+
+    /// The number of mirrored transactions.
+    size_t size() const;
+
+    /// A copy of the mirrored transactions, in no particular order.
+    list entries() const;
+
+private:
+    typedef std::unordered_map<system::hash_digest, entry> entry_map;
+    typedef std::unordered_map<system::chain::point, system::hash_digest>
+        spender_map;
+
+    // These require the exclusive lock.
+    void remove(system::hash_list& removed,
+        const system::hash_digest& tx_hash, bool descendants);
+    uint64_t compute_fee(const system::chain::transaction& tx,
+        const std::vector<uint64_t>& resolved) const;
+
+    // These require that no lock is held.
+    std::vector<uint64_t> resolve(
+        const system::chain::transaction& tx) const;
+    void notify(const system::hash_list& removed) const;
+
+    const prevout_lookup lookup_;
+    const removal_handler on_remove_;
+    entry_map entries_;
+    spender_map spenders_;
+    mutable system::shared_mutex mutex_;
+};
+
+} // namespace client
+} // namespace libbitcoin
+
+#endif
@@ -0,0 +1,118 @@
+/**
+ * Copyright (c) 2011-2019 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_CLIENT_NOTIFICATION_COALESCER_HPP
+#define LIBBITCOIN_CLIENT_NOTIFICATION_COALESCER_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <bitcoin/system.hpp>
+#include <bitcoin/client/define.hpp>
+#include <bitcoin/client/obelisk_client.hpp>
+
+namespace libbitcoin {
+namespace client {
+
+/// Collapses the key notifications of obelisk_client::subscribe_keys that
+/// arrive within a window of the first notification of each key into one
+/// update, optionally followed by a single incremental history fetch for the
+/// key. Updates are delivered by flush, which the caller invokes from its
+/// polling loop (never from a client handler).
+class BCC_API notification_coalescer
+{
+public:
+    /// The notifications of a key within a window.
+    struct update
+    {
+        system::code ec;
+        system::hash_digest key;
+
+        /// The distinct transaction hashes, in order of arrival.
+        system::hash_list tx_hashes;
+
+        /// The lowest confirmed height notified, zero if none.
+        size_t minimum_height;
+
+        /// True if any unconfirmed transaction was notified.
+        bool unconfirmed;
+
+        /// The sequence of the last notification.
+        uint16_t sequence;
+
+        /// The number of notifications coalesced.
+        size_t notifications;
+    };
+
+    typedef std::function<void(const update&)> update_handler;
+
+    notification_coalescer(uint32_t window_milliseconds,
+        update_handler on_update);
+
+    /// Fetch the history of each updated key once, from its minimum height
+    /// (or that of its last confirmed update if only unconfirmed transactions
+    /// were notified), after delivering the update. The client must outlive
+    /// the coalescer.
+    void set_history_fetch(obelisk_client& client,
+        obelisk_client::key_history_handler on_history);
+
+    /// The handler with which to subscribe keys. Subscription
+    /// acknowledgements are ignored and errors end the window of the key.
+    /// The handler may outlive the coalescer.
+    obelisk_client::key_update_handler handler() const;
+
+    /// Deliver the updates of windows that have elapsed, or of all windows,
+    /// returning the number delivered.
+    size_t flush(bool all=false);
+
+    /// The number of keys with notifications pending delivery.
+    size_t pending() const;
+
+private:
+    typedef std::chrono::steady_clock clock;
+
+    struct window
+    {
+        clock::time_point start;
+        update value;
+    };
+
+    // Shared with subscription handlers, which may outlive the coalescer.
+    struct state
+    {
+        std::mutex mutex;
+        std::unordered_map<system::hash_digest, window> windows;
+    };
+
+    const clock::duration window_;
+    const update_handler on_update_;
+    std::shared_ptr<state> state_;
+
+    obelisk_client* client_;
+    obelisk_client::key_history_handler on_history_;
+    std::unordered_map<system::hash_digest, size_t> confirmed_heights_;
+};
+
+} // namespace client
+} // namespace libbitcoin
+
+#endif
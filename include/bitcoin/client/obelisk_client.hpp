@@ -19,9 +19,22 @@
 #ifndef LIBBITCOIN_CLIENT_OBELISK_CLIENT_HPP
 #define LIBBITCOIN_CLIENT_OBELISK_CLIENT_HPP
 
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
 #include <bitcoin/system.hpp>
+#include <bitcoin/client/client_state.hpp>
 #include <bitcoin/client/define.hpp>
+#include <bitcoin/client/header_buffer.hpp>
 #include <bitcoin/client/history.hpp>
+#include <bitcoin/client/response_cache.hpp>
+#include <bitcoin/client/subscription_table.hpp>
+#include <bitcoin/client/traffic_recorder.hpp>
 #include <bitcoin/protocol.hpp>
 
 namespace libbitcoin {
@@ -55,6 +68,9 @@ public:
 
     typedef std::function<void(const system::code&, uint16_t, size_t,
         const system::hash_digest&)> update_handler;
+    typedef std::function<void(const system::code&,
+        const system::hash_digest&, uint16_t, size_t,
+        const system::hash_digest&)> key_update_handler;
     typedef std::function<void(const system::chain::block&)>
         block_update_handler;
     typedef std::function<void(const system::chain::transaction&)>
@@ -74,9 +90,25 @@ public:
     typedef std::function<void(const system::code&, const system::chain::transaction&)> transaction_handler;
     typedef std::function<void(const system::code&, const system::chain::points_value&)> points_value_handler;
     typedef std::function<void(const system::code&, const client::history::list&)> history_handler;
+    typedef std::function<void(const system::code&, const system::hash_digest&, const client::history::list&)> key_history_handler;
     typedef std::function<void(const system::code&, const system::hash_list&)> hash_list_handler;
     typedef std::function<void(const system::code&, const std::string&)> version_handler;
 
+    /// Features of the connected server, known once negotiated.
+    struct capabilities
+    {
+        /// The server version, empty if not negotiated.
+        std::string version;
+        uint32_t major;
+        uint32_t minor;
+
+        /// Accepts and serves witness transactions (v3.4).
+        bool witness;
+
+        /// Serves history by script hash and compact filters (v4.0).
+        bool script_hash;
+    };
+
     // Used for mapping specific requests to specific handlers
     // (allowing support for different handlers for different client
     // API calls on a per-client instance basis).
@@ -90,12 +122,11 @@ public:
     typedef std::unordered_map<uint32_t, compact_filter_headers_handler> compact_filter_headers_handler_map;
     typedef std::unordered_map<uint32_t, transaction_handler> transaction_handler_map;
     typedef std::unordered_map<uint32_t, history_handler> history_handler_map;
-    typedef std::unordered_map<uint32_t, std::pair<update_handler,
-        system::data_chunk>> subscription_handler_map;
     typedef std::unordered_map<uint32_t, std::pair<result_handler,
         uint32_t>> unsubscription_handler_map;
     typedef std::unordered_map<uint32_t, hash_list_handler> hash_list_handler_map;
     typedef std::unordered_map<uint32_t, version_handler> version_handler_map;
+    typedef std::map<std::string, size_t> timeout_map;
 
     /// Construct an instance of the client.
     obelisk_client(int32_t retries=5);
@@ -117,14 +148,51 @@ public:
     /// Wait for server to respond to queries, until timeout.
     void wait(uint32_t timeout_milliseconds=30000);
 
-    /// Monitor for subscription notifications, until timeout.
+    /// Process query responses that arrive within the timeout, without
+    /// expiring outstanding queries. Returns true if queries remain.
+    bool poll(uint32_t timeout_milliseconds=0);
+
+    /// Add the sockets read by poll to the poller, so that an application can
+    /// wait on them together with its own and then call poll without delay.
+    void add_sockets(protocol::zmq::poller& poller);
+
+    /// Number of queries expired by timeout, by handler family.
+    timeout_map timeouts() const;
+
+    /// Monitor for subscription notifications, until timeout. Subscriptions
+    /// end when monitor returns, their handlers invoked with the error. The
+    /// positions of ended subscriptions are retained, for save_subscriptions
+    /// and to continue from when the key is subscribed again.
     void monitor(uint32_t timeout_milliseconds=30000);
 
+    // Negotiation.
+    //-------------------------------------------------------------------------
+
+    /// Fetch the server version and cache its capabilities, until timeout.
+    /// Once negotiated, requests for commands that the server does not
+    /// support fail immediately with error::operation_failed, as do witness
+    /// transactions sent to a server without witness support. Must not be
+    /// called while requests are outstanding.
+    bool negotiate(uint32_t timeout_milliseconds=30000);
+
+    /// The capabilities of the server, default if not negotiated.
+    const capabilities& server_capabilities() const;
+
     // Fetchers.
     //-------------------------------------------------------------------------
 
     void server_version(version_handler handler);
 
+    /// Fetch a confirmed transaction by the best command the server supports,
+    /// including witness data if the negotiated server supports it.
+    void blockchain_fetch_best_transaction(transaction_handler handler,
+        const system::hash_digest& tx_hash);
+
+    /// Fetch a pool transaction by the best command the server supports,
+    /// including witness data if the negotiated server supports it.
+    void transaction_pool_fetch_best_transaction(transaction_handler handler,
+        const system::hash_digest& tx_hash);
+
     void transaction_pool_broadcast(result_handler handler,
         const system::chain::transaction& tx);
 
@@ -199,6 +267,10 @@ public:
     void blockchain_fetch_history4(history_handler handler,
         const system::hash_digest& key, uint32_t from_height=0);
 
+    // Fetch the history of each key, pipelined over the connection.
+    void blockchain_fetch_history4(key_history_handler handler,
+        const system::hash_list& keys, uint32_t from_height=0);
+
     void blockchain_fetch_unspent_outputs(points_value_handler handler,
         const system::hash_digest& key, uint64_t satoshi,
         system::wallet::select_outputs::algorithm algorithm);
@@ -210,25 +282,221 @@ public:
     uint32_t subscribe_key(update_handler handler,
         const system::hash_digest& key);
 
+    // Subscribe to each payment key, return values can be used to unsubscribe.
+    std::vector<uint32_t> subscribe_keys(key_update_handler handler,
+        const system::hash_list& keys);
+
     bool subscribe_block(const system::config::endpoint& address,
         block_update_handler on_update);
 
     bool subscribe_transaction(const system::config::endpoint& address,
         transaction_update_handler on_update);
 
+    // Caching.
+    //-------------------------------------------------------------------------
+
+    /// Serve immutable fetches (block headers, confirmed transactions, blocks,
+    /// block transaction hashes and compact filters) through the cache.
+    /// Results requested by height are cached only once buried by reorg_depth
+    /// blocks below the last height observed by the client. Must not be
+    /// called while requests are outstanding.
+    void set_cache(response_cache::ptr cache, uint32_t reorg_depth=6);
+
+    /// Cache counters since the cache was set.
+    response_cache::metrics cache_metrics() const;
+
+    // Durable state.
+    //-------------------------------------------------------------------------
+
+    /// Record the subscribed keys, with their last notification, to the state.
+    /// Keys whose subscriptions ended on the return of monitor, and that have
+    /// not been subscribed again, are recorded as of their end. Must not be
+    /// called from a handler invoked as subscriptions end.
+    void save_subscriptions(client_state& state);
+
+    /// Resubscribe to each key of the state and fetch its history from the
+    /// last notified height. Handlers fire as monitor and wait are called.
+    std::vector<uint32_t> restore_subscriptions(const client_state& state,
+        key_update_handler on_update, key_history_handler on_history);
+
+    // Bulk fetchers.
+    //-------------------------------------------------------------------------
+
+    /// Fetch count headers from the start height into one contiguous buffer,
+    /// keeping up to window requests outstanding, and block until complete.
+    /// Fails if any header fails, or if no header arrives within the timeout
+    /// (which also expires any other outstanding queries). With verification
+    /// enabled the headers must also link and satisfy their proof of work.
+    system::code fetch_headers(header_buffer& out, uint32_t start_height,
+        uint32_t count, uint32_t window=1000,
+        uint32_t timeout_milliseconds=30000);
+
+    // Batching.
+    //-------------------------------------------------------------------------
+
+    /// A query or reply carried within a server.batch envelope.
+    struct batched_message
+    {
+        typedef std::vector<batched_message> list;
+
+        std::string command;
+        uint32_t id;
+        system::data_chunk payload;
+    };
+
+    /// Pack up to max_batch queries issued between polls into one envelope
+    /// message, for a server or proxy that supports the server.batch command.
+    /// If the server rejects an envelope, or does not reply to an envelope
+    /// within first_reply_milliseconds, the queries of the envelope are sent
+    /// individually. Batching is then disabled, unless the server has
+    /// replied to an envelope (a server that does not batch may never reply).
+    /// Queries missing from a reply, such as after a truncated reply, fail
+    /// with bad_stream. Zero disables batching.
+    void set_batching(size_t max_batch,
+        uint32_t first_reply_milliseconds=1000);
+
+    /// The payload of a server.batch request carrying the queries.
+    static system::data_chunk encode_batch(
+        const batched_message::list& queries);
+
+    /// Decode the replies of a server.batch response, false if the server
+    /// rejected the envelope. Replies after a truncated reply are lost.
+    static bool decode_batch(const system::data_chunk& payload,
+        batched_message::list& replies);
+
+    // Verification.
+    //-------------------------------------------------------------------------
+
+    /// Verify that transactions, blocks and headers fetched by hash match the
+    /// requested hash (else bad_stream) and that fetched blocks match the
+    /// merkle root of their headers (else merkle_mismatch). Applies to
+    /// queries issued after the call. Disabled by default.
+    void set_verification(bool verify);
+
+    // Recording.
+    //-------------------------------------------------------------------------
+
+    /// Record every request sent and response received from the network
+    /// (excluding those served by the cache, played back or replayed), or
+    /// stop recording if null.
+    void set_recorder(traffic_recorder::ptr recorder);
+
+    /// Dispatch the recorded responses through the response path as if
+    /// received from the server, each under a new request id with a discarding
+    /// handler, returning the number dispatched. Outstanding requests and
+    /// subscriptions are unaffected, though heights observed in responses are
+    /// retained as for any response.
+    size_t replay(const traffic_record::list& records);
+
+    /// Answer requests from recorded traffic instead of the network, such as
+    /// to run queries offline. A request is answered with the responses
+    /// recorded for the earliest unused recorded request of the same command
+    /// and payload (including the notifications of a subscription), which are
+    /// delivered through the response path by wait, poll and monitor. Other
+    /// requests are not answered. Empty records stop playback. For use by a
+    /// single thread, not while requests are outstanding.
+    void set_playback(const traffic_record::list& records);
+
     // Unsubscribers.
     //-------------------------------------------------------------------------
 
     bool unsubscribe_key(result_handler handler, uint32_t subscription);
 
+    /// Unsubscribe from the key of each subscription, removing them from the
+    /// client together rather than as each is acknowledged, so that removing
+    /// many subscriptions publishes the subscriptions once. The handler is
+    /// invoked with the result of each request. Returns the number sent.
+    size_t unsubscribe_keys(result_handler handler,
+        const std::vector<uint32_t>& subscriptions);
+
 private:
+    // A cacheable request awaiting its response, which is referenced while
+    // its handler runs so that it may be admitted once decoded.
+    struct cache_entry
+    {
+        system::hash_digest key;
+        bool by_height;
+        uint32_t height;
+        const system::data_chunk* payload;
+    };
+
+    typedef batched_message::list request_list;
+
+    // An envelope awaiting its reply, with the requests that it carries.
+    struct pending_batch
+    {
+        std::chrono::steady_clock::time_point sent;
+        request_list requests;
+    };
+
+    // A family of pending request handlers, keyed by request id.
+    struct pending_family
+    {
+        std::string name;
+        std::function<size_t()> size;
+        std::function<void(const system::code&)> expire;
+        std::function<void(uint32_t)> discard;
+    };
+
+    // A response from the cache or playback, pending delivery.
+    struct queued_response
+    {
+        std::string command;
+        uint32_t id;
+        system::data_chunk payload;
+    };
+
     // Attach handlers for all supported client-server operations.
     void attach_handlers();
 
+    // Registers the handler map as a family of pending requests, once.
+    template <typename Handlers>
+    size_t register_family(const std::string& name, Handlers& handlers);
+
+    // Queues the cached response to the request if there is one, otherwise
+    // retains the request so that its response may be cached.
+    bool fetch_cached(const std::string& command, uint32_t id,
+        const system::data_chunk& payload);
+
+    // Caches the response being handled if its request was retained and it is
+    // admissible. Called once the response is decoded (and verified).
+    void admit_cached(uint32_t id);
+
+    // Wrap the handler to admit its response to the cache on success.
+    template <typename... Args>
+    std::function<void(const system::code&, Args...)> admitted(
+        std::function<void(const system::code&, Args...)> handler, uint32_t id);
+
+    // Fires the handlers of queued cached responses.
+    void dispatch_cached();
+
+    // Queues the recorded responses to the request, if playing back.
+    bool play(const std::string& command, uint32_t id,
+        const system::data_chunk& payload, bool subscription);
+
+    // Delivers the queued playback responses through the response path.
+    void dispatch_played(std::vector<queued_response>& responses);
+
+    // Track the chain height for admission of results requested by height.
+    void observe_height(const std::string& command,
+        const system::data_chunk& payload);
+
     // Used to handle a request immediately, on early detection of error.
     void handle_immediate(const std::string& command, uint32_t id,
         const system::code& ec);
 
+    // Wrap the handler to verify its result if verification is enabled.
+    transaction_handler verified(transaction_handler handler,
+        const system::hash_digest& tx_hash) const;
+    block_header_handler verified(block_header_handler handler,
+        const system::hash_digest& block_hash) const;
+    block_handler verified(block_handler handler,
+        const system::hash_digest& block_hash) const;
+    block_handler verified(block_handler handler) const;
+
+    // Determines if the negotiated server supports the command.
+    bool supported(const std::string& command) const;
+
     // Determines if any requests have not been handled.
     bool requests_outstanding();
 
@@ -242,10 +510,28 @@ private:
     // error.
     void clear_outstanding_subscribe_requests(const system::code& ec);
 
-    // Sends an outgoing request via the internal router.
+    // Sends an outgoing request via the internal router. If it cannot be sent
+    // its handler is fired immediately and false is returned.
     bool send_request(const std::string& command, uint32_t id,
         const system::data_chunk& payload, bool subscription=false);
 
+    // Sends a message via the internal router.
+    bool send_message(const std::string& command, uint32_t id,
+        const system::data_chunk& payload, bool subscription);
+
+    // Sends queued requests, in an envelope if there are several.
+    void flush_batch();
+
+    // Sends requests without an envelope.
+    void send_individually(const request_list& requests);
+
+    // Dispatches the replies of an envelope.
+    void handle_batch(uint32_t id, const system::data_chunk& payload);
+
+    // Falls back to individual requests for envelopes without a reply by the
+    // first reply deadline.
+    void expire_batches();
+
     // Forward incoming client router requests to the server.
     void forward_message(protocol::zmq::socket& source,
         protocol::zmq::socket& sink);
@@ -253,6 +539,44 @@ private:
     // Process server responses.
     void process_response(protocol::zmq::socket& socket);
 
+    // Fire the handler of a server response.
+    void handle_response(const std::string& command, uint32_t id,
+        const system::data_chunk& payload);
+
+    // Record traffic to the recorder, unless played or replayed.
+    void record(bool response, const std::string& command, uint32_t id,
+        const system::data_chunk& payload);
+
+    // Register a discarding handler for a replayed response.
+    bool register_replay(const std::string& command, uint32_t id);
+
+    // Subscribe the replayed notification ids with a discarding handler.
+    void add_replay_subscriptions(const std::vector<uint32_t>& ids);
+
+    // Subscribe to each key with the handler, null_subscription where the
+    // request could not be sent.
+    std::vector<uint32_t> subscribe(subscription_table::handler handler,
+        const system::hash_list& keys);
+
+    // Replace the published subscriptions, retiring the replaced table with
+    // the positions released by the replacement (subscription_lock_ held).
+    void publish(subscription_table&& subscriptions);
+
+    // Read the published subscriptions, which are not deleted until the
+    // reader slot is released.
+    const subscription_table& acquire_subscriptions(size_t& reader);
+    void release_subscriptions(size_t reader);
+
+    // Delete retired subscriptions older than the oldest reader, recycling
+    // the positions released with them (subscription_lock_ held).
+    void reclaim_subscriptions();
+
+    // Remove the subscription, false if not found.
+    bool remove_subscription(uint32_t id);
+
+    // Remove the subscriptions in one publish, returning the number found.
+    size_t remove_subscriptions(const std::vector<uint32_t>& ids);
+
     // After notifying the server of unsubscribe, this terminates any client
     // side monitoring state for the subscription.
     bool terminate_unsubscriber(uint32_t subscription);
@@ -293,13 +617,84 @@ private:
     compact_filter_headers_handler_map compact_filter_headers_handlers_;
     transaction_handler_map transaction_handlers_;
     history_handler_map history_handlers_;
-    subscription_handler_map subscription_handlers_;
+
+    // A reader's announced epoch, zero if idle, padded to a cache line.
+    struct subscription_reader
+    {
+        std::atomic<uint64_t> epoch;
+        uint8_t padding[64 - sizeof(std::atomic<uint64_t>)];
+    };
+
+    // A replaced table, with the epoch in which it was replaced and the
+    // positions released by its replacement.
+    struct retired_subscriptions
+    {
+        std::unique_ptr<const subscription_table> table;
+        uint64_t epoch;
+        subscription_table::position_list positions;
+    };
+
+    // Immutable subscriptions snapshot, read through an atomic pointer so
+    // that notification dispatch does not wait on writers, and replaced with
+    // a modified copy (which shares unmodified chunks), advancing the epoch.
+    // Each reader announces the epoch in its own slot, and a replaced table
+    // is deleted once no reader of its or an earlier epoch remains.
+    std::atomic<const subscription_table*> subscriptions_;
+    std::atomic<uint64_t> subscription_epoch_;
+    std::unique_ptr<subscription_reader[]> subscription_readers_;
+    std::deque<retired_subscriptions> retired_subscriptions_;
+
+    // Positions of subscriptions ended by monitor, until subscribed again.
+    std::unordered_map<system::hash_digest, client_state::subscription>
+        ended_subscriptions_;
+
     unsubscription_handler_map unsubscription_handlers_;
     hash_list_handler_map hash_list_handlers_;
     version_handler_map version_handlers_;
 
-    // Protects subscription_handlers_
+    // Request batching (request thread only).
+    static const std::string batch_command;
+    size_t max_batch_;
+    uint32_t first_reply_milliseconds_;
+    bool batch_replied_;
+    request_list batch_queue_;
+    std::unordered_map<uint32_t, pending_batch> batches_;
+
+    // Result verification (request thread only).
+    bool verify_;
+
+    // Negotiated server capabilities (request thread only).
+    bool negotiated_;
+    capabilities capabilities_;
+
+    // Pending request lifecycle, in registration order.
+    std::vector<pending_family> pending_families_;
+    std::unordered_map<std::string, size_t> command_families_;
+    timeout_map timeouts_;
+
+    // Serializes writers of subscriptions_, protects retired_subscriptions_,
+    // ended_subscriptions_ and unsubscription_handlers_.
     system::upgrade_mutex subscription_lock_;
+
+    // Response caching (request thread only, except tip_height_).
+    response_cache::ptr cache_;
+    uint32_t reorg_depth_;
+    response_cache::metrics cache_metrics_;
+    std::unordered_map<uint32_t, cache_entry> cache_pending_;
+    std::vector<queued_response> cached_responses_;
+    std::atomic<uint32_t> tip_height_;
+
+    // Traffic recording, safe for use by multiple threads.
+    traffic_recorder::ptr recorder_;
+
+    // Traffic playback, recorded ids by request and responses by recorded id.
+    bool playing_;
+    bool replaying_;
+    std::unordered_map<system::hash_digest, std::deque<uint32_t>>
+        playback_requests_;
+    std::unordered_map<uint32_t, traffic_record::list> playback_responses_;
+    std::vector<queued_response> played_responses_;
+    std::vector<queued_response> played_notifications_;
 };
 
 } // namespace client
@@ -0,0 +1,65 @@
+/**
+ * Copyright (c) 2011-2019 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_CLIENT_RESPONSE_CACHE_HPP
+#define LIBBITCOIN_CLIENT_RESPONSE_CACHE_HPP
+
+#include <cstddef>
+#include <memory>
+#include <bitcoin/system.hpp>
+#include <bitcoin/client/define.hpp>
+
+namespace libbitcoin {
+namespace client {
+
+/// Storage backend for immutable server responses, keyed by the hash of the
+/// request command and payload. Implementations must be thread safe.
+class BCC_API response_cache
+{
+public:
+    typedef std::shared_ptr<response_cache> ptr;
+
+    /// Cache effectiveness counters, as maintained by the client.
+    struct metrics
+    {
+        size_t hits;
+        size_t misses;
+        size_t admitted;
+        size_t rejected;
+    };
+
+    virtual ~response_cache()
+    {
+    }
+
+    /// Obtain the cached response payload, false if not cached.
+    virtual bool fetch(const system::hash_digest& key,
+        system::data_chunk& payload) = 0;
+
+    /// Cache the response payload, which the backend may decline or evict.
+    virtual void store(const system::hash_digest& key,
+        const system::data_chunk& payload) = 0;
+
+    /// Remove all cached responses.
+    virtual void clear() = 0;
+};
+
+} // namespace client
+} // namespace libbitcoin
+
+#endif
@@ -0,0 +1,43 @@
+/**
+ * Copyright (c) 2011-2019 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_CLIENT_SCRIPT_KEYS_HPP
+#define LIBBITCOIN_CLIENT_SCRIPT_KEYS_HPP
+
+#include <bitcoin/system.hpp>
+#include <bitcoin/client/define.hpp>
+
+namespace libbitcoin {
+namespace client {
+
+/// The key by which the server indexes an output script (v4.0), as accepted
+/// by blockchain_fetch_history4 and subscribe_key.
+BCC_API system::hash_digest script_key(const system::chain::script& script);
+
+/// The keys of the output scripts, hashed as a batch.
+BCC_API system::hash_list script_keys(
+    const system::chain::script::list& scripts);
+
+/// The keys of the output scripts of the addresses, hashed as a batch.
+BCC_API system::hash_list address_keys(
+    const system::wallet::payment_address::list& addresses);
+
+} // namespace client
+} // namespace libbitcoin
+
+#endif
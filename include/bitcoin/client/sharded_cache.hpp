@@ -0,0 +1,88 @@
+/**
+ * Copyright (c) 2011-2019 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_CLIENT_SHARDED_CACHE_HPP
+#define LIBBITCOIN_CLIENT_SHARDED_CACHE_HPP
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <bitcoin/system.hpp>
+#include <bitcoin/client/define.hpp>
+#include <bitcoin/client/response_cache.hpp>
+
+namespace libbitcoin {
+namespace client {
+
+/// In-memory response cache for clients shared across threads.
+/// Keys are striped over independently locked shards, each evicting by the
+/// CLOCK (second chance) policy within an equal share of the byte capacity.
+/// Payloads are shared so that readers copy them outside of the shard lock.
+class BCC_API sharded_cache
+  : public response_cache
+{
+public:
+    static const size_t default_shards;
+
+    /// The shard count is rounded up to a power of two.
+    sharded_cache(size_t capacity_bytes, size_t shards=default_shards);
+
+    bool fetch(const system::hash_digest& key,
+        system::data_chunk& payload) override;
+    void store(const system::hash_digest& key,
+        const system::data_chunk& payload) override;
+    void clear() override;
+
+    /// The number of payload bytes currently cached.
+    size_t size() const;
+
+private:
+    typedef std::shared_ptr<const system::data_chunk> payload_ptr;
+
+    struct slot
+    {
+        system::hash_digest key;
+        payload_ptr payload;
+        bool referenced;
+    };
+
+    struct shard
+    {
+        std::vector<slot> slots;
+        std::vector<size_t> free;
+        std::unordered_map<system::hash_digest, size_t> index;
+        size_t hand;
+        size_t size;
+        mutable std::mutex mutex;
+    };
+
+    shard& get_shard(const system::hash_digest& key);
+
+    // Frees slots until the payload size fits, shard must be locked.
+    void evict(shard& shard, size_t payload_size);
+
+    const size_t shard_capacity_;
+    std::vector<std::unique_ptr<shard>> shards_;
+};
+
+} // namespace client
+} // namespace libbitcoin
+
+#endif
@@ -0,0 +1,168 @@
+/**
+ * Copyright (c) 2011-2019 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_CLIENT_SUBSCRIPTION_TABLE_HPP
+#define LIBBITCOIN_CLIENT_SUBSCRIPTION_TABLE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+#include <bitcoin/system.hpp>
+#include <bitcoin/client/define.hpp>
+
+namespace libbitcoin {
+namespace client {
+
+/// Key subscriptions by request id, stored compactly for large numbers of
+/// subscriptions. Keys, handler indexes and position indexes are held in
+/// dense parallel arrays, handlers are held once in a registry shared by the
+/// subscriptions that use them, and ids are resolved to array slots by a
+/// flat open addressing index. Removal moves the last slot into the hole.
+///
+/// The arrays, registry and index are held in fixed size chunks that copies
+/// share until written, so that a copy costs its chunk directories and each
+/// modification of a copy costs only the chunks it touches. Copies also
+/// share handlers and one array of notification positions, so that a copy
+/// may be modified and published while readers use an earlier copy.
+/// The positions of removed subscriptions are reused only once released and
+/// then recycled, when no earlier copy remains in use. Positions are atomic
+/// and may be set on a const table, otherwise not thread safe.
+class BCC_API subscription_table
+{
+public:
+    /// Invoked with the key of the subscription (obelisk_client's
+    /// key_update_handler).
+    typedef std::function<void(const system::code&,
+        const system::hash_digest&, uint16_t, size_t,
+        const system::hash_digest&)> handler;
+
+    typedef std::vector<uint32_t> position_list;
+
+    static const size_t not_found = system::max_size_t;
+
+    subscription_table();
+
+    /// Register a handler, held by the caller until released.
+    uint32_t register_handler(handler handler);
+
+    /// Release the caller's hold of a handler, which is destroyed once no
+    /// subscription refers to it.
+    void release_handler(uint32_t handler);
+
+    /// Add a subscription using the registered handler, false if the id is
+    /// in use.
+    bool add(uint32_t id, const system::hash_digest& key, uint32_t handler,
+        uint16_t sequence=0, uint32_t height=0);
+
+    /// Remove the subscription, false if not found.
+    bool remove(uint32_t id);
+
+    /// The slot of the subscription, or not_found.
+    size_t find(uint32_t id) const;
+
+    /// Accessors by slot, which must be less than size().
+    uint32_t id(size_t slot) const;
+    const system::hash_digest& key(size_t slot) const;
+    const handler& get_handler(size_t slot) const;
+    uint16_t sequence(size_t slot) const;
+    uint32_t height(size_t slot) const;
+
+    /// Record the notification position of the slot, shared by all copies.
+    void set_position(size_t slot, uint16_t sequence, uint32_t height) const;
+
+    /// Record the notification sequence of the slot, retaining the greater
+    /// of the recorded and notified heights.
+    void update_position(size_t slot, uint16_t sequence,
+        uint32_t height) const;
+
+    /// Take the positions of subscriptions removed (from any copy) since the
+    /// last release, which are not reused until recycled.
+    position_list release_positions() const;
+
+    /// Allow released positions to be reused by all copies. Call only once
+    /// no copy made before their removal is in use, as a reader of such a
+    /// copy may still record a position.
+    void recycle_positions(const position_list& positions) const;
+
+    size_t size() const;
+    bool empty() const;
+    void clear();
+
+private:
+    struct position_array;
+    struct slot_chunk;
+    struct registry_chunk;
+    struct index_chunk;
+
+    struct registered
+    {
+        std::shared_ptr<const handler> value;
+        uint32_t references;
+
+        // The next free entry, while this entry is free.
+        uint32_t next_free;
+    };
+
+    struct index_entry
+    {
+        uint32_t id;
+        uint32_t slot;
+    };
+
+    // Chunk readers.
+    const slot_chunk& slots(size_t slot) const;
+    const registered& entry(uint32_t handler) const;
+    const index_entry& index(size_t position) const;
+
+    // Chunk writers, which first copy a chunk shared with another table.
+    slot_chunk& write_slots(size_t slot);
+    registered& write_entry(uint32_t handler);
+    index_entry& write_index(size_t position);
+
+    size_t index_size() const;
+    size_t bucket(uint32_t id) const;
+    size_t locate(uint32_t id) const;
+    void reserve_index(size_t count);
+    void erase_index(size_t position);
+    void release(uint32_t handler);
+    std::atomic<uint64_t>& position(size_t slot) const;
+
+    // Dense subscription arrays of ids, keys, handlers and positions, in
+    // chunks by slot.
+    size_t size_;
+    std::vector<std::shared_ptr<slot_chunk>> slots_;
+
+    // Notification positions by position index, shared by copies.
+    std::shared_ptr<position_array> shared_positions_;
+
+    // Shared handlers with their reference counts, and the first free entry.
+    uint32_t registry_size_;
+    uint32_t free_handler_;
+    std::vector<std::shared_ptr<registry_chunk>> registry_;
+
+    // Linear probing index from id to slot, a power of two in size.
+    std::vector<std::shared_ptr<index_chunk>> index_;
+};
+
+} // namespace client
+} // namespace libbitcoin
+
+#endif
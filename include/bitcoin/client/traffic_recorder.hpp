@@ -0,0 +1,88 @@
+/**
+ * Copyright (c) 2011-2019 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_CLIENT_TRAFFIC_RECORDER_HPP
+#define LIBBITCOIN_CLIENT_TRAFFIC_RECORDER_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <bitcoin/system.hpp>
+#include <bitcoin/client/define.hpp>
+
+namespace libbitcoin {
+namespace client {
+
+/// A request sent to or response received from the server.
+struct BCC_API traffic_record
+{
+    typedef std::vector<traffic_record> list;
+
+    /// Read a record of at most remaining bytes, which is reduced by the size
+    /// of the record. False if the record is invalid or does not fit.
+    bool from_data(system::istream_reader& source, size_t& remaining);
+    void to_data(system::ostream_writer& sink) const;
+
+    bool response;
+
+    /// Microseconds since recording started.
+    uint64_t timestamp;
+
+    std::string command;
+    uint32_t id;
+    system::data_chunk payload;
+};
+
+/// Writes client traffic to a compact binary log, for replay without a
+/// network by obelisk_client::replay. Safe for use by multiple threads.
+class BCC_API traffic_recorder
+{
+public:
+    typedef std::shared_ptr<traffic_recorder> ptr;
+
+    static const uint32_t version;
+
+    /// The stream must remain valid for the lifetime of the recorder.
+    traffic_recorder(std::ostream& stream);
+
+    /// Append a record timestamped with the current time.
+    void record(bool response, const std::string& command, uint32_t id,
+        const system::data_chunk& payload);
+
+    void flush();
+
+    /// Read all records of a log, false if the log is invalid.
+    static bool load(std::istream& stream, traffic_record::list& out);
+
+private:
+    std::ostream& stream_;
+    system::ostream_writer sink_;
+    const std::chrono::steady_clock::time_point start_;
+    std::mutex mutex_;
+};
+
+} // namespace client
+} // namespace libbitcoin
+
+#endif
@@ -0,0 +1,57 @@
+/**
+ * Copyright (c) 2011-2019 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_CLIENT_VERIFICATION_HPP
+#define LIBBITCOIN_CLIENT_VERIFICATION_HPP
+
+#include <cstdint>
+#include <bitcoin/system.hpp>
+#include <bitcoin/client/define.hpp>
+#include <bitcoin/client/header_buffer.hpp>
+
+namespace libbitcoin {
+namespace client {
+
+/// Compute the transaction hashes (excluding witness) in a batch.
+BCC_API system::hash_list transaction_hashes(
+    const system::chain::transaction::list& transactions);
+
+/// Compute the hashes of the buffered headers in a batch.
+BCC_API system::hash_list header_hashes(const header_buffer& headers);
+
+/// Compute the merkle root of the hashes, or null_hash if there are none.
+/// Each level of the tree is hashed in a batch.
+BCC_API system::hash_digest merkle_root(const system::hash_list& hashes);
+
+/// True if the hash satisfies the target encoded in the compact bits.
+BCC_API bool verify_proof_of_work(uint32_t bits,
+    const system::hash_digest& hash);
+
+/// True if each buffered header satisfies its own proof of work and links to
+/// its predecessor, the first to the given previous block hash. Difficulty
+/// retargeting is not validated. The header hashes are returned in order.
+BCC_API bool verify_header_chain(system::hash_list& out_hashes,
+    const header_buffer& headers, const system::hash_digest& previous_hash);
+
+/// True if the merkle root of the block transactions matches its header.
+BCC_API bool verify_merkle_root(const system::chain::block& block);
+
+} // namespace client
+} // namespace libbitcoin
+
+#endif
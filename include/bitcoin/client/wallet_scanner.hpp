@@ -0,0 +1,100 @@
+/**
+ * Copyright (c) 2011-2019 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_CLIENT_WALLET_SCANNER_HPP
+#define LIBBITCOIN_CLIENT_WALLET_SCANNER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <bitcoin/system.hpp>
+#include <bitcoin/client/define.hpp>
+#include <bitcoin/client/history.hpp>
+#include <bitcoin/client/obelisk_client.hpp>
+
+namespace libbitcoin {
+namespace client {
+
+/// Scans one chain of a deterministic wallet (such as m/0 or m/1 of an
+/// account) for history, deriving keys from its extended public key and
+/// extending the scan window beyond every used key by the gap limit.
+class BCC_API wallet_scanner
+{
+public:
+    /// Resumable position of a scan, persist to continue an interrupted scan.
+    struct checkpoint
+    {
+        /// The next child index to be queried.
+        uint32_t next_index;
+
+        /// One past the highest child index found with history (zero if none).
+        uint32_t used_count;
+
+        /// The height from which history is fetched.
+        uint32_t from_height;
+    };
+
+    struct settings
+    {
+        /// Number of consecutive unused keys that terminates the scan.
+        uint32_t gap_limit;
+
+        /// Maximum number of history queries outstanding at once.
+        uint32_t concurrency;
+
+        /// Payment address version used to derive the output scripts.
+        uint8_t address_version;
+
+        /// Maximum time to wait on each round of queries.
+        uint32_t timeout_milliseconds;
+    };
+
+    /// Invoked for each child index with non-empty history.
+    typedef std::function<void(uint32_t, const system::hash_digest&,
+        const history::list&)> found_handler;
+
+    /// Invoked after each completed round of queries.
+    typedef std::function<void(const checkpoint&)> progress_handler;
+
+    static const settings default_settings;
+
+    /// The client must be connected and is not owned by the scanner.
+    wallet_scanner(obelisk_client& client,
+        const system::wallet::hd_public& chain_key,
+        const settings& settings=default_settings);
+
+    /// Derive the payment address of the given child index.
+    system::wallet::payment_address derive_address(uint32_t index) const;
+
+    /// Scan from the given position until the gap limit is exhausted.
+    /// The position is updated as the scan progresses. On failure it is left
+    /// at the first unresolved index so that the scan may be resumed, in
+    /// which case keys found after that index may be reported again.
+    system::code scan(checkpoint& position, found_handler on_found,
+        progress_handler on_progress=nullptr);
+
+private:
+    obelisk_client& client_;
+    const system::wallet::hd_public chain_key_;
+    const settings settings_;
+};
+
+} // namespace client
+} // namespace libbitcoin
+
+#endif
@@ -0,0 +1,183 @@
+/**
+ * Copyright (c) 2011-2019 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_CLIENT_WATCH_WALLET_HPP
+#define LIBBITCOIN_CLIENT_WATCH_WALLET_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <bitcoin/system.hpp>
+#include <bitcoin/client/define.hpp>
+#include <bitcoin/client/history.hpp>
+#include <bitcoin/client/obelisk_client.hpp>
+
+namespace libbitcoin {
+namespace client {
+
+/// A watch-only wallet over the receive (m/0) and change (m/1) chains of an
+/// account extended public key. Keys are derived in parallel and retained,
+/// subscribed as they are derived, and each chain is extended so that at
+/// least the gap limit of unused keys follows its last used key. A chain is
+/// extended by no fewer keys than the query concurrency. The unspent outputs
+/// and balance are indexed from the history of each key, which is refetched
+/// when the key is notified. Subscriptions that end, as they do when the
+/// client's monitor returns, are renewed and their keys refetched by the next
+/// load or refresh.
+///
+/// Not thread safe, use on the thread that waits on or polls the client.
+class BCC_API watch_wallet
+  : system::noncopyable
+{
+public:
+    static const uint32_t receive_chain = 0;
+    static const uint32_t change_chain = 1;
+
+    struct settings
+    {
+        /// Number of consecutive unused keys that follow the last used key.
+        uint32_t gap_limit;
+
+        /// Payment address version used to derive the output scripts.
+        uint8_t address_version;
+
+        /// Number of derivation threads, zero for the hardware concurrency.
+        uint32_t threads;
+
+        /// Maximum number of history queries outstanding at once.
+        uint32_t concurrency;
+
+        /// Maximum time to wait on each round of queries.
+        uint32_t timeout_milliseconds;
+    };
+
+    /// An unspent output of the wallet.
+    struct unspent
+    {
+        system::chain::output_point point;
+        uint64_t value;
+        uint64_t height;
+        system::hash_digest key;
+    };
+
+    typedef std::vector<unspent> unspent_list;
+
+    static const settings default_settings;
+
+    /// Derive the script hash keys of count children of the chain key,
+    /// starting at first, divided between the given number of threads.
+    static system::hash_list derive_keys(
+        const system::wallet::hd_public& chain_key, uint32_t first,
+        uint32_t count, uint8_t address_version, uint32_t threads);
+
+    /// The client must be connected and is not owned by the wallet.
+    watch_wallet(obelisk_client& client,
+        const system::wallet::hd_public& account_key,
+        const settings& settings=default_settings);
+
+    /// Unsubscribe the keys of the wallet, must not be called in a handler.
+    ~watch_wallet();
+
+    /// Derive and subscribe the initial keys of each chain and fetch their
+    /// history, extending the chains until the gap limits are satisfied.
+    system::code load();
+
+    /// Renew ended subscriptions and refetch the history of their keys and
+    /// of keys notified since the last refresh (or load), extending the
+    /// chains as keys become used. On failure the keys remain pending so that
+    /// the refresh may be repeated.
+    system::code refresh();
+
+    /// The number of keys notified and not yet refreshed.
+    size_t pending() const;
+
+    /// True if a subscription has ended since the last refresh (or load), so
+    /// that its key is not notified until the next refresh.
+    bool stale() const;
+
+    /// The number of keys derived on the chain.
+    uint32_t derived_count(uint32_t chain) const;
+
+    /// One past the highest index of the chain with history (zero if none).
+    uint32_t used_count(uint32_t chain) const;
+
+    /// The derived key of the chain at the index, which must be in range.
+    const system::hash_digest& key(uint32_t chain, uint32_t index) const;
+
+    /// The total value of the unspent outputs.
+    uint64_t balance() const;
+
+    /// The unspent outputs, in no particular order.
+    unspent_list unspent_outputs() const;
+
+private:
+    struct chain_state
+    {
+        system::wallet::hd_public key;
+        system::hash_list keys;
+        std::vector<uint32_t> subscriptions;
+        uint32_t used_count;
+    };
+
+    struct location
+    {
+        uint32_t chain;
+        uint32_t index;
+    };
+
+    // Derive and subscribe keys of the chain up to the count.
+    void extend(uint32_t chain, uint32_t count);
+
+    // Subscribe the keys, returning their subscriptions.
+    std::vector<uint32_t> subscribe(const system::hash_list& keys);
+
+    // Subscribe the keys of ended subscriptions again and mark them pending.
+    void resubscribe();
+
+    // Fetch pending history until pending is empty and the gaps satisfied.
+    system::code synchronize();
+
+    // Fetch the history of the keys in pipelined rounds, applying each.
+    system::code fetch(const system::hash_list& keys);
+
+    // Replace the unspent outputs of the key with those of the history.
+    void apply(const system::hash_digest& key, const history::list& rows);
+
+    obelisk_client& client_;
+    const settings settings_;
+    chain_state chains_[2];
+    std::unordered_map<system::hash_digest, location> locations_;
+
+    // Shared with subscription handlers, which may outlive the wallet.
+    std::shared_ptr<std::unordered_set<system::hash_digest>> pending_;
+    std::shared_ptr<std::unordered_set<system::hash_digest>> ended_;
+
+    // Unspent outputs, indexed by point and by key.
+    uint64_t balance_;
+    std::unordered_map<system::chain::point, unspent> unspent_;
+    std::unordered_map<system::hash_digest,
+        std::vector<system::chain::point>> key_unspent_;
+};
+
+} // namespace client
+} // namespace libbitcoin
+
+#endif
@@ -0,0 +1,251 @@
+/**
+ * Copyright (c) 2011-2019 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/client/client_state.hpp>
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+
+#ifdef _WIN32
+    #include <io.h>
+    #include <fcntl.h>
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+using namespace bc::system;
+using namespace bc::system::chain;
+
+namespace libbitcoin {
+namespace client {
+
+// Increment when the serialization changes, older files are then rejected.
+const uint32_t client_state::version = 1;
+
+client_state::client_state()
+{
+    reset();
+}
+
+// Deserialization.
+//-----------------------------------------------------------------------------
+
+bool client_state::from_data(const data_chunk& data)
+{
+    data_source istream(data);
+    return from_data(istream);
+}
+
+bool client_state::from_data(std::istream& stream)
+{
+    istream_reader source(stream);
+    return from_data(source);
+}
+
+// [ version:4 ]
+// [ tip_height:4 ]
+// [ header_count:var ] ([ header:80 ])
+// [ watermark_count:var ] ([ name:var-string ][ height:4 ])
+// [ subscription_count:var ] ([ key:32 ][ sequence:2 ][ height:4 ])
+bool client_state::from_data(istream_reader& source)
+{
+    reset();
+
+    if (source.read_4_bytes_little_endian() != version)
+        source.invalidate();
+
+    tip_height = source.read_4_bytes_little_endian();
+
+    const auto headers = source.read_size_little_endian();
+    for (size_t index = 0; index < headers && source; ++index)
+    {
+        header header;
+        header.from_data(source);
+        tip_headers.push_back(header);
+    }
+
+    const auto watermark_count = source.read_size_little_endian();
+    for (size_t index = 0; index < watermark_count && source; ++index)
+    {
+        const auto name = source.read_string();
+        watermarks[name] = source.read_4_bytes_little_endian();
+    }
+
+    const auto subscription_count = source.read_size_little_endian();
+    for (size_t index = 0; index < subscription_count && source; ++index)
+    {
+        subscription entry;
+        entry.key = source.read_hash();
+        entry.sequence = source.read_2_bytes_little_endian();
+        entry.height = source.read_4_bytes_little_endian();
+        subscriptions.push_back(entry);
+    }
+
+    if (!source)
+        reset();
+
+    return source;
+}
+
+// Serialization.
+//-----------------------------------------------------------------------------
+
+data_chunk client_state::to_data() const
+{
+    data_chunk data;
+    data_sink ostream(data);
+    to_data(ostream);
+    ostream.flush();
+    return data;
+}
+
+void client_state::to_data(std::ostream& stream) const
+{
+    ostream_writer sink(stream);
+    to_data(sink);
+}
+
+void client_state::to_data(ostream_writer& sink) const
+{
+    sink.write_4_bytes_little_endian(version);
+    sink.write_4_bytes_little_endian(tip_height);
+
+    sink.write_size_little_endian(tip_headers.size());
+    for (const auto& header: tip_headers)
+        sink.write_bytes(header.to_data());
+
+    sink.write_size_little_endian(watermarks.size());
+    for (const auto& watermark: watermarks)
+    {
+        sink.write_string(watermark.first);
+        sink.write_4_bytes_little_endian(watermark.second);
+    }
+
+    sink.write_size_little_endian(subscriptions.size());
+    for (const auto& entry: subscriptions)
+    {
+        sink.write_hash(entry.key);
+        sink.write_2_bytes_little_endian(entry.sequence);
+        sink.write_4_bytes_little_endian(entry.height);
+    }
+}
+
+// Files.
+//-----------------------------------------------------------------------------
+
+bool client_state::load(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+
+    const data_chunk data((std::istreambuf_iterator<char>(file)),
+        std::istreambuf_iterator<char>());
+
+    return from_data(data);
+}
+
+// Write the file and flush it to storage, so that it is complete on disk
+// before it replaces the previous file.
+static bool write_synchronized(const std::string& path, const data_chunk& data)
+{
+#ifdef _WIN32
+    const auto file = _open(path.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC |
+        _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+    const auto file = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+#endif
+    if (file < 0)
+        return false;
+
+    auto written = true;
+    for (size_t offset = 0; written && offset < data.size();)
+    {
+#ifdef _WIN32
+        const auto count = _write(file, data.data() + offset,
+            static_cast<unsigned>(data.size() - offset));
+#else
+        const auto count = write(file, data.data() + offset,
+            data.size() - offset);
+#endif
+        written = count > 0;
+        offset += written ? static_cast<size_t>(count) : 0;
+    }
+
+#ifdef _WIN32
+    const auto synchronized = written && _commit(file) == 0;
+    return (_close(file) == 0) && synchronized;
+#else
+    const auto synchronized = written && fsync(file) == 0;
+    return (close(file) == 0) && synchronized;
+#endif
+}
+
+// Replace the file in one step, which never leaves the path without a file.
+static bool replace(const std::string& from, const std::string& to)
+{
+#ifdef _WIN32
+    return MoveFileExA(from.c_str(), to.c_str(),
+        MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    if (std::rename(from.c_str(), to.c_str()) != 0)
+        return false;
+
+    // The rename is durable once the directory entry is flushed.
+    const auto separator = to.find_last_of('/');
+    const auto directory = separator == std::string::npos ? std::string(".") :
+        to.substr(0, separator + 1);
+
+    const auto file = open(directory.c_str(), O_RDONLY);
+    if (file < 0)
+        return true;
+
+    fsync(file);
+    close(file);
+    return true;
+#endif
+}
+
+bool client_state::save(const std::string& path) const
+{
+    // Write aside and rename so that a crash never leaves a partial file.
+    const auto temporary = path + ".tmp";
+
+    if (!write_synchronized(temporary, to_data()) ||
+        !replace(temporary, path))
+    {
+        std::remove(temporary.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+void client_state::reset()
+{
+    tip_height = 0;
+    tip_headers.clear();
+    watermarks.clear();
+    subscriptions.clear();
+}
+
+} // namespace client
+} // namespace libbitcoin
@@ -0,0 +1,192 @@
+/**
+ * Copyright (c) 2011-2019 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/client/conflict_detector.hpp>
+
+#include <utility>
+
+using namespace bc::system;
+using namespace bc::system::chain;
+
+namespace libbitcoin {
+namespace client {
+
+static point::list spends(const transaction& tx)
+{
+    point::list outpoints;
+    outpoints.reserve(tx.inputs().size());
+
+    for (const auto& input: tx.inputs())
+        outpoints.push_back(input.previous_output());
+
+    return outpoints;
+}
+
+conflict_detector::conflict_detector(conflict_handler handler)
+  : handler_(handler)
+{
+}
+
+bool conflict_detector::watch(const transaction& tx)
+{
+    const auto tx_hash = tx.hash();
+    auto outpoints = spends(tx);
+
+    // Critical Section.
+    ///////////////////////////////////////////////////////////////////////////
+    unique_lock lock(mutex_);
+
+    if (watched_.find(tx_hash) != watched_.end())
+        return false;
+
+    // An outpoint may be watched by several transactions, such as a wallet
+    // transaction and its own replacement.
+    for (const auto& outpoint: outpoints)
+        outpoints_.emplace(outpoint, tx_hash);
+
+    watched_.emplace(tx_hash, std::move(outpoints));
+    return true;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+bool conflict_detector::unwatch(const hash_digest& tx_hash)
+{
+    // Critical Section.
+    ///////////////////////////////////////////////////////////////////////////
+    unique_lock lock(mutex_);
+    return remove(tx_hash);
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+conflict_detector::list conflict_detector::check(const transaction& tx)
+{
+    list conflicts;
+    const auto outpoints = spends(tx);
+
+    // Critical Section.
+    ///////////////////////////////////////////////////////////////////////////
+    mutex_.lock_shared();
+    find(conflicts, tx.hash(), outpoints, false);
+    mutex_.unlock_shared();
+    ///////////////////////////////////////////////////////////////////////////
+
+    notify(conflicts);
+    return conflicts;
+}
+
+bool conflict_detector::check(list& out, const hash_digest& tx_hash,
+    const mempool_mirror& mirror)
+{
+    out.clear();
+
+    mempool_mirror::entry entry;
+    if (!mirror.find(entry, tx_hash))
+        return false;
+
+    // Critical Section.
+    ///////////////////////////////////////////////////////////////////////////
+    mutex_.lock_shared();
+    find(out, tx_hash, entry.spends, false);
+    mutex_.unlock_shared();
+    ///////////////////////////////////////////////////////////////////////////
+
+    notify(out);
+    return true;
+}
+
+conflict_detector::list conflict_detector::confirm(const block& block)
+{
+    list conflicts;
+
+    // Critical Section.
+    ///////////////////////////////////////////////////////////////////////////
+    mutex_.lock();
+
+    for (const auto& tx: block.transactions())
+    {
+        const auto tx_hash = tx.hash();
+        remove(tx_hash);
+
+        // A confirmed watched transaction conflicts with the remaining
+        // watchers of its outpoints.
+        if (!tx.is_coinbase())
+            find(conflicts, tx_hash, spends(tx), true);
+    }
+
+    mutex_.unlock();
+    ///////////////////////////////////////////////////////////////////////////
+
+    notify(conflicts);
+    return conflicts;
+}
+
+size_t conflict_detector::size() const
+{
+    // Critical Section.
+    ///////////////////////////////////////////////////////////////////////////
+    shared_lock lock(mutex_);
+    return watched_.size();
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+void conflict_detector::find(list& out, const hash_digest& tx_hash,
+    const point::list& spends, bool confirmed) const
+{
+    for (const auto& outpoint: spends)
+    {
+        const auto watchers = outpoints_.equal_range(outpoint);
+        for (auto it = watchers.first; it != watchers.second; ++it)
+            if (it->second != tx_hash)
+                out.push_back({ outpoint, it->second, tx_hash, confirmed });
+    }
+}
+
+bool conflict_detector::remove(const hash_digest& tx_hash)
+{
+    const auto it = watched_.find(tx_hash);
+    if (it == watched_.end())
+        return false;
+
+    for (const auto& outpoint: it->second)
+    {
+        const auto watchers = outpoints_.equal_range(outpoint);
+        for (auto spent = watchers.first; spent != watchers.second; ++spent)
+        {
+            if (spent->second == tx_hash)
+            {
+                outpoints_.erase(spent);
+                break;
+            }
+        }
+    }
+
+    watched_.erase(it);
+    return true;
+}
+
+void conflict_detector::notify(const list& conflicts) const
+{
+    if (!handler_)
+        return;
+
+    for (const auto& conflict: conflicts)
+        handler_(conflict);
+}
+
+} // namespace client
+} // namespace libbitcoin
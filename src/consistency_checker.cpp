@@ -0,0 +1,276 @@
+/**
+ * Copyright (c) 2011-2019 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/client/consistency_checker.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <tuple>
+#include <bitcoin/protocol.hpp>
+
+using namespace bc::protocol;
+using namespace bc::system;
+using namespace bc::system::chain;
+using namespace std::chrono;
+
+namespace libbitcoin {
+namespace client {
+
+bool consistency_checker::report::consistent() const
+{
+    const auto failed = [](const code& ec) { return bool(ec); };
+
+    return std::none_of(codes.begin(), codes.end(), failed) &&
+        divergent().empty();
+}
+
+std::vector<size_t> consistency_checker::report::divergent() const
+{
+    std::vector<size_t> indexes;
+    const auto first = std::find(codes.begin(), codes.end(), error::success);
+    if (first == codes.end())
+        return indexes;
+
+    const auto& reference = digests[first - codes.begin()];
+
+    for (size_t index = 0; index < codes.size(); ++index)
+        if (!codes[index] && digests[index] != reference)
+            indexes.push_back(index);
+
+    return indexes;
+}
+
+consistency_checker::consistency_checker(const client_list& clients,
+    uint32_t timeout_milliseconds)
+  : clients_(clients),
+    timeout_milliseconds_(timeout_milliseconds)
+{
+}
+
+consistency_checker::report consistency_checker::make_report(
+    size_t height) const
+{
+    return
+    {
+        height,
+        std::vector<code>(clients_.size(), error::success),
+        hash_list(clients_.size(), null_hash)
+    };
+}
+
+void consistency_checker::wait()
+{
+    const auto deadline = steady_clock::now() +
+        milliseconds(timeout_milliseconds_);
+
+    // The clients are waited on together, so that responses from every
+    // server are handled as they arrive, until none remains or time is up.
+    auto now = steady_clock::now();
+    while (now < deadline)
+    {
+        zmq::poller poller;
+        auto pending = false;
+        for (const auto client: clients_)
+        {
+            if (client->poll())
+            {
+                client->add_sockets(poller);
+                pending = true;
+            }
+        }
+
+        if (!pending)
+            return;
+
+        const auto remaining = duration_cast<milliseconds>(deadline - now);
+        poller.wait(static_cast<int32_t>(remaining.count()));
+        if (poller.terminated())
+            break;
+
+        now = steady_clock::now();
+    }
+
+    // Zero wait fails the queries that remain with a timeout.
+    for (const auto client: clients_)
+        client->wait(0);
+}
+
+consistency_checker::report consistency_checker::check_tip()
+{
+    auto result = make_report(0);
+    std::vector<size_t> heights(clients_.size(), 0);
+
+    for (size_t index = 0; index < clients_.size(); ++index)
+    {
+        auto handler = [&result, &heights, index](const code& ec,
+            size_t height)
+        {
+            result.codes[index] = ec;
+            heights[index] = height;
+        };
+
+        clients_[index]->blockchain_fetch_last_height(handler);
+    }
+
+    wait();
+
+    auto common = max_size_t;
+    for (size_t index = 0; index < clients_.size(); ++index)
+        if (!result.codes[index])
+            common = std::min(common, heights[index]);
+
+    // The tip may lag briefly, so compare at the lowest common height.
+    if (common == max_size_t)
+        return result;
+
+    return check_header(common);
+}
+
+consistency_checker::report consistency_checker::check_header(size_t height)
+{
+    auto result = make_report(height);
+
+    for (size_t index = 0; index < clients_.size(); ++index)
+    {
+        auto handler = [&result, index](const code& ec, const header& header)
+        {
+            result.codes[index] = ec;
+            result.digests[index] = header.hash();
+        };
+
+        clients_[index]->blockchain_fetch_block_header(handler,
+            static_cast<uint32_t>(height));
+    }
+
+    wait();
+    return result;
+}
+
+consistency_checker::report consistency_checker::check_block(size_t height)
+{
+    auto result = make_report(height);
+    std::vector<hash_digest> headers(clients_.size(), null_hash);
+    std::vector<hash_digest> hashes(clients_.size(), null_hash);
+
+    // Both queries are issued together. A server may return transaction
+    // hashes that its header does not commit to, so both are compared.
+    for (size_t index = 0; index < clients_.size(); ++index)
+    {
+        auto on_header = [&result, &headers, index](const code& ec,
+            const header& header)
+        {
+            if (ec)
+                result.codes[index] = ec;
+            else
+                headers[index] = header.hash();
+        };
+
+        auto on_hashes = [&result, &hashes, index](const code& ec,
+            const hash_list& tx_hashes)
+        {
+            if (ec)
+                result.codes[index] = ec;
+            else
+                hashes[index] = hashes_digest(tx_hashes);
+        };
+
+        const auto block_height = static_cast<uint32_t>(height);
+        clients_[index]->blockchain_fetch_block_header(on_header,
+            block_height);
+        clients_[index]->blockchain_fetch_block_transaction_hashes(on_hashes,
+            block_height);
+    }
+
+    wait();
+
+    for (size_t index = 0; index < clients_.size(); ++index)
+        result.digests[index] = sha256_hash(
+            build_chunk({ headers[index], hashes[index] }));
+
+    return result;
+}
+
+consistency_checker::report consistency_checker::check_history(
+    const hash_digest& key, uint32_t from_height)
+{
+    auto result = make_report(from_height);
+
+    for (size_t index = 0; index < clients_.size(); ++index)
+    {
+        auto handler = [&result, index](const code& ec,
+            const history::list& rows)
+        {
+            result.codes[index] = ec;
+            result.digests[index] = history_digest(rows);
+        };
+
+        clients_[index]->blockchain_fetch_history4(handler, key, from_height);
+    }
+
+    wait();
+    return result;
+}
+
+hash_digest consistency_checker::hashes_digest(const hash_list& hashes)
+{
+    data_chunk data;
+    data.reserve(hashes.size() * hash_size);
+
+    for (const auto& hash: hashes)
+        extend_data(data, hash);
+
+    return sha256_hash(data);
+}
+
+hash_digest consistency_checker::history_digest(const history::list& rows)
+{
+    // Servers are not required to order rows consistently.
+    const auto key = [](const history& row)
+    {
+        return std::make_tuple(row.output_height, row.output.hash(),
+            row.output.index(), row.spend.hash(), row.spend.index());
+    };
+
+    auto sorted = rows;
+    std::sort(sorted.begin(), sorted.end(),
+        [&key](const history& left, const history& right)
+        {
+            return key(left) < key(right);
+        });
+
+    data_chunk data;
+    data_sink ostream(data);
+    ostream_writer sink(ostream);
+
+    for (const auto& row: sorted)
+    {
+        sink.write_hash(row.output.hash());
+        sink.write_4_bytes_little_endian(row.output.index());
+        sink.write_8_bytes_little_endian(row.output_height);
+        sink.write_8_bytes_little_endian(row.value);
+        sink.write_hash(row.spend.hash());
+        sink.write_4_bytes_little_endian(row.spend.index());
+        sink.write_8_bytes_little_endian(row.spend_height);
+    }
+
+    ostream.flush();
+    return sha256_hash(data);
+}
+
+} // namespace client
+} // namespace libbitcoin
@@ -0,0 +1,207 @@
+/**
+ * Copyright (c) 2011-2019 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/client/fee_estimator.hpp>
+
+#include <algorithm>
+#include <iterator>
+
+using namespace bc::system;
+using namespace bc::system::chain;
+
+namespace libbitcoin {
+namespace client {
+
+const fee_estimator::settings fee_estimator::default_settings
+{
+    1000,
+    1.1,
+    100,
+    48,
+    0.85,
+    0.998,
+    10.0
+};
+
+fee_estimator::fee_estimator(const settings& settings)
+  : settings_(settings),
+    valid_(settings.buckets != 0 && settings.maximum_target != 0),
+    totals_(settings.buckets, 0.0),
+    confirmed_(settings.buckets * settings.maximum_target, 0.0),
+    height_(0),
+    estimates_(settings.maximum_target + 1, 0)
+{
+    bounds_.reserve(settings_.buckets);
+    auto bound = static_cast<double>(settings_.minimum_rate);
+
+    for (size_t index = 0; index < settings_.buckets; ++index)
+    {
+        bounds_.push_back(static_cast<uint64_t>(bound));
+        bound *= settings_.spacing;
+    }
+}
+
+bool fee_estimator::track(const mempool_mirror::entry& entry)
+{
+    if (!valid_ || entry.fee == mempool_mirror::unknown_fee)
+        return false;
+
+    // Critical Section.
+    ///////////////////////////////////////////////////////////////////////////
+    unique_lock lock(mutex_);
+    return tracked_.emplace(entry.hash,
+        tracked_transaction{ bucket(entry.fee_rate()), height_ }).second;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+bool fee_estimator::untrack(const hash_digest& tx_hash)
+{
+    // Critical Section.
+    ///////////////////////////////////////////////////////////////////////////
+    unique_lock lock(mutex_);
+    return tracked_.erase(tx_hash) != 0;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+void fee_estimator::confirm(const block& block)
+{
+    // Critical Section.
+    ///////////////////////////////////////////////////////////////////////////
+    unique_lock lock(mutex_);
+    ++height_;
+
+    for (auto& total: totals_)
+        total *= settings_.decay;
+
+    for (auto& count: confirmed_)
+        count *= settings_.decay;
+
+    for (const auto& tx: block.transactions())
+    {
+        const auto it = tracked_.find(tx.hash());
+        if (it == tracked_.end())
+            continue;
+
+        // Announced in the prior block interval confirms in one block.
+        record(it->second.bucket, height_ - it->second.height);
+        tracked_.erase(it);
+    }
+
+    for (auto it = tracked_.begin(); it != tracked_.end();)
+    {
+        if (height_ - it->second.height < settings_.maximum_target)
+        {
+            ++it;
+            continue;
+        }
+
+        // Zero blocks records a failure at every target.
+        record(it->second.bucket, 0);
+        it = tracked_.erase(it);
+    }
+
+    compute_estimates();
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+uint64_t fee_estimator::estimate(size_t target) const
+{
+    if (!valid_)
+        return 0;
+
+    target = std::max(std::min(target, settings_.maximum_target), size_t(1));
+
+    // Critical Section.
+    ///////////////////////////////////////////////////////////////////////////
+    shared_lock lock(mutex_);
+    return estimates_[target];
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+fee_estimator::operator bool() const
+{
+    return valid_;
+}
+
+size_t fee_estimator::tracked() const
+{
+    // Critical Section.
+    ///////////////////////////////////////////////////////////////////////////
+    shared_lock lock(mutex_);
+    return tracked_.size();
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+// Private (exclusive lock required).
+//-----------------------------------------------------------------------------
+
+size_t fee_estimator::bucket(uint64_t fee_rate) const
+{
+    // Rates below the lowest bound are counted in the lowest bucket.
+    const auto it = std::upper_bound(bounds_.begin(), bounds_.end(),
+        fee_rate);
+
+    return it == bounds_.begin() ? 0 :
+        static_cast<size_t>(std::distance(bounds_.begin(), it)) - 1;
+}
+
+void fee_estimator::record(size_t bucket, size_t blocks)
+{
+    totals_[bucket] += 1.0;
+
+    if (blocks == 0)
+        return;
+
+    const auto row = bucket * settings_.maximum_target;
+    for (auto target = blocks; target <= settings_.maximum_target; ++target)
+        confirmed_[row + target - 1] += 1.0;
+}
+
+void fee_estimator::compute_estimates()
+{
+    for (size_t target = 1; target <= settings_.maximum_target; ++target)
+    {
+        uint64_t estimate = 0;
+        auto total = 0.0;
+        auto confirmed = 0.0;
+
+        // Buckets are grouped from the highest rate down until sufficient
+        // samples are accumulated, and each passing group lowers the estimate.
+        for (auto index = settings_.buckets; index-- > 0;)
+        {
+            total += totals_[index];
+            confirmed += confirmed_[index * settings_.maximum_target +
+                target - 1];
+
+            if (total < settings_.minimum_samples)
+                continue;
+
+            if (confirmed < settings_.success_ratio * total)
+                break;
+
+            estimate = bounds_[index];
+            total = 0.0;
+            confirmed = 0.0;
+        }
+
+        estimates_[target] = estimate;
+    }
+}
+
+} // namespace client
+} // namespace libbitcoin
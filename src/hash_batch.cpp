@@ -0,0 +1,580 @@
+/**
+ * Copyright (c) 2011-2019 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/client/hash_batch.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Vectorized transforms are compiled for x86 with GCC/Clang function
+// targets and selected at runtime, so no build flags are required.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    #define BCC_HASH_X86
+    #include <cpuid.h>
+    #include <immintrin.h>
+#endif
+
+using namespace bc::system;
+
+namespace libbitcoin {
+namespace client {
+
+static constexpr size_t block_size = 64;
+static constexpr size_t lanes = 8;
+
+static const uint32_t initial_state[8] =
+{
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+static const uint32_t round_constants[64] =
+{
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+    0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+    0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+    0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+    0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+    0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+// A message to be hashed, with its progress through the padded blocks.
+struct job
+{
+    const uint8_t* data;
+    size_t size;
+    size_t blocks;
+    hash_digest* digest;
+};
+
+static inline uint32_t load_big_endian(const uint8_t* bytes)
+{
+    return
+        (static_cast<uint32_t>(bytes[0]) << 24) |
+        (static_cast<uint32_t>(bytes[1]) << 16) |
+        (static_cast<uint32_t>(bytes[2]) << 8) |
+        (static_cast<uint32_t>(bytes[3]));
+}
+
+static inline void store_big_endian(uint8_t* bytes, uint32_t value)
+{
+    bytes[0] = static_cast<uint8_t>(value >> 24);
+    bytes[1] = static_cast<uint8_t>(value >> 16);
+    bytes[2] = static_cast<uint8_t>(value >> 8);
+    bytes[3] = static_cast<uint8_t>(value);
+}
+
+static inline size_t padded_blocks(size_t size)
+{
+    // Message, 0x80 terminator and 64 bit length, rounded up to blocks.
+    return (size + 1 + sizeof(uint64_t) + block_size - 1) / block_size;
+}
+
+static inline job make_job(const uint8_t* data, size_t size,
+    hash_digest& digest)
+{
+    return { data, size, padded_blocks(size), &digest };
+}
+
+// Returns a pointer to the indexed block of the padded message, which is
+// either within the message or assembled in the provided buffer.
+static const uint8_t* get_block(const job& job, size_t index,
+    uint8_t buffer[block_size])
+{
+    const auto offset = index * block_size;
+    if (offset + block_size <= job.size)
+        return job.data + offset;
+
+    std::memset(buffer, 0, block_size);
+    const auto remaining = offset < job.size ? job.size - offset : 0;
+    if (remaining != 0)
+        std::memcpy(buffer, job.data + offset, remaining);
+
+    // The terminator follows the message, possibly in the prior block.
+    if (offset <= job.size)
+        buffer[job.size - offset] = 0x80;
+
+    if (index + 1 == job.blocks)
+    {
+        const uint64_t bits = static_cast<uint64_t>(job.size) * 8;
+        store_big_endian(buffer + 56, static_cast<uint32_t>(bits >> 32));
+        store_big_endian(buffer + 60, static_cast<uint32_t>(bits));
+    }
+
+    return buffer;
+}
+
+static inline void store_digest(hash_digest& digest, const uint32_t state[8])
+{
+    for (size_t word = 0; word < 8; ++word)
+        store_big_endian(digest.data() + word * 4, state[word]);
+}
+
+// Portable single buffer transform.
+//-----------------------------------------------------------------------------
+
+static inline uint32_t rotate(uint32_t value, uint32_t bits)
+{
+    return (value >> bits) | (value << (32 - bits));
+}
+
+static void transform(uint32_t state[8], const uint8_t* block)
+{
+    uint32_t w[64];
+    for (size_t t = 0; t < 16; ++t)
+        w[t] = load_big_endian(block + t * 4);
+
+    for (size_t t = 16; t < 64; ++t)
+    {
+        const auto s0 = rotate(w[t - 15], 7) ^ rotate(w[t - 15], 18) ^
+            (w[t - 15] >> 3);
+        const auto s1 = rotate(w[t - 2], 17) ^ rotate(w[t - 2], 19) ^
+            (w[t - 2] >> 10);
+        w[t] = w[t - 16] + s0 + w[t - 7] + s1;
+    }
+
+    auto a = state[0], b = state[1], c = state[2], d = state[3];
+    auto e = state[4], f = state[5], g = state[6], h = state[7];
+
+    for (size_t t = 0; t < 64; ++t)
+    {
+        const auto s1 = rotate(e, 6) ^ rotate(e, 11) ^ rotate(e, 25);
+        const auto choice = (e & f) ^ (~e & g);
+        const auto temp1 = h + s1 + choice + round_constants[t] + w[t];
+        const auto s0 = rotate(a, 2) ^ rotate(a, 13) ^ rotate(a, 22);
+        const auto majority = (a & b) ^ (a & c) ^ (b & c);
+        const auto temp2 = s0 + majority;
+        h = g;
+        g = f;
+        f = e;
+        e = d + temp1;
+        d = c;
+        c = b;
+        b = a;
+        a = temp1 + temp2;
+    }
+
+    state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+    state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
+
+#ifdef BCC_HASH_X86
+
+// SHA-NI single buffer transform.
+//-----------------------------------------------------------------------------
+
+__attribute__((target("sha,sse4.1")))
+static void transform_shani(uint32_t state[8], const uint8_t* block)
+{
+    const auto mask = _mm_set_epi64x(0x0c0d0e0f08090a0bull,
+        0x0405060700010203ull);
+
+    // Reorder the state words into the ABEF/CDGH layout of the instructions.
+    auto temp = _mm_loadu_si128(reinterpret_cast<const __m128i*>(state));
+    auto state1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(state + 4));
+    temp = _mm_shuffle_epi32(temp, 0xb1);
+    state1 = _mm_shuffle_epi32(state1, 0x1b);
+    auto state0 = _mm_alignr_epi8(temp, state1, 8);
+    state1 = _mm_blend_epi16(state1, temp, 0xf0);
+
+    const auto save0 = state0;
+    const auto save1 = state1;
+
+    __m128i schedule[4];
+    for (size_t group = 0; group < 16; ++group)
+    {
+        auto& words = schedule[group % 4];
+
+        if (group < 4)
+        {
+            words = _mm_shuffle_epi8(_mm_loadu_si128(
+                reinterpret_cast<const __m128i*>(block + group * 16)), mask);
+        }
+        else
+        {
+            const auto& next = schedule[(group + 1) % 4];
+            const auto& later = schedule[(group + 2) % 4];
+            const auto& last = schedule[(group + 3) % 4];
+            words = _mm_sha256msg1_epu32(words, next);
+            words = _mm_add_epi32(words, _mm_alignr_epi8(last, later, 4));
+            words = _mm_sha256msg2_epu32(words, last);
+        }
+
+        auto message = _mm_add_epi32(words, _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(round_constants + group * 4)));
+        state1 = _mm_sha256rnds2_epu32(state1, state0, message);
+        message = _mm_shuffle_epi32(message, 0x0e);
+        state0 = _mm_sha256rnds2_epu32(state0, state1, message);
+    }
+
+    state0 = _mm_add_epi32(state0, save0);
+    state1 = _mm_add_epi32(state1, save1);
+
+    // Restore the state word order.
+    temp = _mm_shuffle_epi32(state0, 0x1b);
+    state1 = _mm_shuffle_epi32(state1, 0xb1);
+    state0 = _mm_blend_epi16(temp, state1, 0xf0);
+    state1 = _mm_alignr_epi8(state1, temp, 8);
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(state), state0);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(state + 4), state1);
+}
+
+// AVX2 eight buffer transform.
+//-----------------------------------------------------------------------------
+
+#define ROTATE8(value, bits) _mm256_or_si256(_mm256_srli_epi32(value, bits), \
+    _mm256_slli_epi32(value, 32 - (bits)))
+#define XOR3(first, second, third) _mm256_xor_si256(first, \
+    _mm256_xor_si256(second, third))
+
+// State and words are word-major, with one lane per message.
+__attribute__((target("avx2")))
+static void transform_avx2(uint32_t state[8][lanes],
+    const uint32_t words[16][lanes])
+{
+    __m256i w[16];
+    for (size_t t = 0; t < 16; ++t)
+        w[t] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(words[t]));
+
+    __m256i s[8];
+    for (size_t word = 0; word < 8; ++word)
+        s[word] = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(state[word]));
+
+    auto a = s[0], b = s[1], c = s[2], d = s[3];
+    auto e = s[4], f = s[5], g = s[6], h = s[7];
+
+    for (size_t t = 0; t < 64; ++t)
+    {
+        // The schedule is kept as a rolling window of sixteen words.
+        if (t >= 16)
+        {
+            const auto w15 = w[(t - 15) % 16];
+            const auto w2 = w[(t - 2) % 16];
+            const auto s0 = XOR3(ROTATE8(w15, 7), ROTATE8(w15, 18),
+                _mm256_srli_epi32(w15, 3));
+            const auto s1 = XOR3(ROTATE8(w2, 17), ROTATE8(w2, 19),
+                _mm256_srli_epi32(w2, 10));
+            w[t % 16] = _mm256_add_epi32(_mm256_add_epi32(w[t % 16], s0),
+                _mm256_add_epi32(w[(t - 7) % 16], s1));
+        }
+
+        const auto s1 = XOR3(ROTATE8(e, 6), ROTATE8(e, 11), ROTATE8(e, 25));
+        const auto choice = _mm256_xor_si256(_mm256_and_si256(e, f),
+            _mm256_andnot_si256(e, g));
+        const auto constant = _mm256_set1_epi32(
+            static_cast<int>(round_constants[t]));
+        const auto temp1 = _mm256_add_epi32(_mm256_add_epi32(h, s1),
+            _mm256_add_epi32(_mm256_add_epi32(choice, constant), w[t % 16]));
+        const auto s0 = XOR3(ROTATE8(a, 2), ROTATE8(a, 13), ROTATE8(a, 22));
+        const auto majority = XOR3(_mm256_and_si256(a, b),
+            _mm256_and_si256(a, c), _mm256_and_si256(b, c));
+        const auto temp2 = _mm256_add_epi32(s0, majority);
+        h = g;
+        g = f;
+        f = e;
+        e = _mm256_add_epi32(d, temp1);
+        d = c;
+        c = b;
+        b = a;
+        a = _mm256_add_epi32(temp1, temp2);
+    }
+
+    s[0] = _mm256_add_epi32(s[0], a); s[1] = _mm256_add_epi32(s[1], b);
+    s[2] = _mm256_add_epi32(s[2], c); s[3] = _mm256_add_epi32(s[3], d);
+    s[4] = _mm256_add_epi32(s[4], e); s[5] = _mm256_add_epi32(s[5], f);
+    s[6] = _mm256_add_epi32(s[6], g); s[7] = _mm256_add_epi32(s[7], h);
+
+    for (size_t word = 0; word < 8; ++word)
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(state[word]), s[word]);
+}
+
+#undef ROTATE8
+#undef XOR3
+
+static bool has_shani()
+{
+    uint32_t eax, ebx, ecx, edx;
+    if (__get_cpuid_max(0, nullptr) < 7)
+        return false;
+
+    __cpuid(1, eax, ebx, ecx, edx);
+    const auto sse41 = (ecx & (1u << 19)) != 0;
+    const auto ssse3 = (ecx & (1u << 9)) != 0;
+
+    __cpuid_count(7, 0, eax, ebx, ecx, edx);
+    return sse41 && ssse3 && (ebx & (1u << 29)) != 0;
+}
+
+static bool has_avx2()
+{
+    uint32_t eax, ebx, ecx, edx;
+    if (__get_cpuid_max(0, nullptr) < 7)
+        return false;
+
+    // The operating system must preserve the ymm registers (xgetbv).
+    __cpuid(1, eax, ebx, ecx, edx);
+    if ((ecx & (1u << 27)) == 0 || (ecx & (1u << 28)) == 0)
+        return false;
+
+    uint32_t xcr0_low, xcr0_high;
+    __asm__("xgetbv" : "=a"(xcr0_low), "=d"(xcr0_high) : "c"(0));
+    if ((xcr0_low & 0x6) != 0x6)
+        return false;
+
+    __cpuid_count(7, 0, eax, ebx, ecx, edx);
+    return (ebx & (1u << 5)) != 0;
+}
+
+#endif // BCC_HASH_X86
+
+// Schedulers.
+//-----------------------------------------------------------------------------
+
+typedef void(*single_transform)(uint32_t state[8], const uint8_t* block);
+
+static void hash_serial(const std::vector<job>& jobs, single_transform apply)
+{
+    uint8_t buffer[block_size];
+
+    for (const auto& job: jobs)
+    {
+        uint32_t state[8];
+        std::copy(initial_state, initial_state + 8, state);
+
+        for (size_t block = 0; block < job.blocks; ++block)
+            apply(state, get_block(job, block, buffer));
+
+        store_digest(*job.digest, state);
+    }
+}
+
+#ifdef BCC_HASH_X86
+
+// Each lane takes the next message as soon as its current one completes, so
+// messages of differing length are processed together without stalls.
+static void hash_parallel(const std::vector<job>& jobs)
+{
+    uint32_t state[8][lanes];
+    uint32_t words[16][lanes];
+    uint8_t buffer[block_size];
+
+    const job* lane_jobs[lanes] = {};
+    size_t lane_blocks[lanes] = {};
+    size_t next = 0;
+
+    auto assign = [&](size_t lane)
+    {
+        lane_jobs[lane] = next < jobs.size() ? &jobs[next++] : nullptr;
+        lane_blocks[lane] = 0;
+        for (size_t word = 0; word < 8; ++word)
+            state[word][lane] = initial_state[word];
+    };
+
+    for (size_t lane = 0; lane < lanes; ++lane)
+        assign(lane);
+
+    while (true)
+    {
+        size_t active = 0;
+        for (size_t lane = 0; lane < lanes; ++lane)
+        {
+            const auto job = lane_jobs[lane];
+            if (job == nullptr)
+            {
+                // Idle lanes process zeros and their results are discarded.
+                for (size_t t = 0; t < 16; ++t)
+                    words[t][lane] = 0;
+
+                continue;
+            }
+
+            ++active;
+            const auto block = get_block(*job, lane_blocks[lane], buffer);
+            for (size_t t = 0; t < 16; ++t)
+                words[t][lane] = load_big_endian(block + t * 4);
+        }
+
+        if (active == 0)
+            break;
+
+        transform_avx2(state, words);
+
+        for (size_t lane = 0; lane < lanes; ++lane)
+        {
+            const auto job = lane_jobs[lane];
+            if (job == nullptr || ++lane_blocks[lane] < job->blocks)
+                continue;
+
+            uint32_t result[8];
+            for (size_t word = 0; word < 8; ++word)
+                result[word] = state[word][lane];
+
+            store_digest(*job->digest, result);
+            assign(lane);
+        }
+    }
+}
+
+#endif // BCC_HASH_X86
+
+bool hash_supported(hash_implementation implementation)
+{
+    switch (implementation)
+    {
+        case hash_implementation::automatic:
+        case hash_implementation::portable:
+            return true;
+#ifdef BCC_HASH_X86
+        case hash_implementation::shani:
+        {
+            static const auto shani = has_shani();
+            return shani;
+        }
+        case hash_implementation::avx2:
+        {
+            static const auto avx2 = has_avx2();
+            return avx2;
+        }
+#endif
+        default:
+            return false;
+    }
+}
+
+// An unsupported implementation falls back to the portable transform.
+static void hash_jobs(const std::vector<job>& jobs,
+    hash_implementation implementation)
+{
+    if (!hash_supported(implementation))
+        implementation = hash_implementation::portable;
+
+#ifdef BCC_HASH_X86
+    if (implementation == hash_implementation::automatic)
+    {
+        // SHA-NI matches eight AVX2 lanes without the cost of transposition.
+        if (hash_supported(hash_implementation::shani))
+            implementation = hash_implementation::shani;
+        else if (hash_supported(hash_implementation::avx2) && jobs.size() > 1)
+            implementation = hash_implementation::avx2;
+    }
+
+    if (implementation == hash_implementation::shani)
+    {
+        hash_serial(jobs, transform_shani);
+        return;
+    }
+
+    if (implementation == hash_implementation::avx2)
+    {
+        hash_parallel(jobs);
+        return;
+    }
+#endif
+
+    hash_serial(jobs, transform);
+}
+
+hash_list sha256_hash_batch(const data_stack& messages)
+{
+    return sha256_hash_batch(messages, hash_implementation::automatic);
+}
+
+hash_list sha256_hash_batch(const data_stack& messages,
+    hash_implementation implementation)
+{
+    hash_list digests(messages.size());
+
+    std::vector<job> jobs;
+    jobs.reserve(messages.size());
+
+    for (size_t index = 0; index < messages.size(); ++index)
+        jobs.push_back(make_job(messages[index].data(),
+            messages[index].size(), digests[index]));
+
+    hash_jobs(jobs, implementation);
+    return digests;
+}
+
+// The jobs are hashed twice, the second round over the first round digests.
+static hash_list double_hash_jobs(std::vector<job>& jobs,
+    hash_implementation implementation)
+{
+    hash_list first(jobs.size());
+    hash_list digests(jobs.size());
+
+    for (size_t index = 0; index < jobs.size(); ++index)
+        jobs[index].digest = &first[index];
+
+    hash_jobs(jobs, implementation);
+
+    for (size_t index = 0; index < jobs.size(); ++index)
+        jobs[index] = make_job(first[index].data(), hash_size,
+            digests[index]);
+
+    hash_jobs(jobs, implementation);
+    return digests;
+}
+
+hash_list bitcoin_hash_batch(const data_stack& messages)
+{
+    return bitcoin_hash_batch(messages, hash_implementation::automatic);
+}
+
+hash_list bitcoin_hash_batch(const data_stack& messages,
+    hash_implementation implementation)
+{
+    std::vector<job> jobs;
+    jobs.reserve(messages.size());
+
+    for (const auto& message: messages)
+        jobs.push_back({ message.data(), message.size(),
+            padded_blocks(message.size()), nullptr });
+
+    return double_hash_jobs(jobs, implementation);
+}
+
+hash_list bitcoin_hash_batch(const uint8_t* records, size_t count,
+    size_t record_size)
+{
+    std::vector<job> jobs;
+    jobs.reserve(count);
+
+    for (size_t index = 0; index < count; ++index)
+        jobs.push_back({ records + index * record_size, record_size,
+            padded_blocks(record_size), nullptr });
+
+    return double_hash_jobs(jobs, hash_implementation::automatic);
+}
+
+} // namespace client
+} // namespace libbitcoin
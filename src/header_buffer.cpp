@@ -0,0 +1,89 @@
+/**
+ * Copyright (c) 2011-2019 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/client/header_buffer.hpp>
+
+#include <algorithm>
+
+using namespace bc::system;
+
+namespace libbitcoin {
+namespace client {
+
+const size_t header_buffer::record_size;
+
+header_buffer::header_buffer()
+  : start_height_(0)
+{
+}
+
+header_buffer::header_buffer(uint32_t start_height, size_t count)
+  : start_height_(start_height),
+    records_(count * record_size, 0)
+{
+}
+
+uint32_t header_buffer::start_height() const
+{
+    return start_height_;
+}
+
+size_t header_buffer::size() const
+{
+    return records_.size() / record_size;
+}
+
+bool header_buffer::empty() const
+{
+    return records_.empty();
+}
+
+const uint8_t* header_buffer::data() const
+{
+    return records_.data();
+}
+
+uint8_t* header_buffer::data()
+{
+    return records_.data();
+}
+
+data_slice header_buffer::record(size_t index) const
+{
+    const auto begin = records_.data() + index * record_size;
+    return { begin, begin + record_size };
+}
+
+chain::header header_buffer::header(size_t index) const
+{
+    const auto begin = records_.begin() + index * record_size;
+
+    chain::header out;
+    out.from_data(data_chunk(begin, begin + record_size));
+    return out;
+}
+
+void header_buffer::set(size_t index, const chain::header& header)
+{
+    const auto data = header.to_data();
+    BITCOIN_ASSERT(data.size() == record_size);
+    std::copy(data.begin(), data.end(), records_.begin() + index * record_size);
+}
+
+} // namespace client
+} // namespace libbitcoin
@@ -0,0 +1,223 @@
+/**
+ * Copyright (c) 2011-2019 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/client/history_verifier.hpp>
+
+#include <algorithm>
+#include <bitcoin/client/verification.hpp>
+
+using namespace bc::system;
+using namespace bc::system::chain;
+
+namespace libbitcoin {
+namespace client {
+
+// Unconfirmed points are reported at height zero.
+static bool unconfirmed(uint64_t height)
+{
+    return height == 0;
+}
+
+const history_verifier::settings history_verifier::default_settings
+{
+    100,
+    30000
+};
+
+history_verifier::history_verifier(obelisk_client& client,
+    const settings& settings)
+  : client_(client),
+    settings_(settings)
+{
+}
+
+bool history_verifier::set_headers(const header_buffer& headers)
+{
+    if (headers.empty())
+        return false;
+
+    hash_list hashes;
+    if (!verify_header_chain(hashes, headers,
+        headers.header(0).previous_block_hash()))
+        return false;
+
+    headers_ = headers;
+    blocks_.clear();
+    return true;
+}
+
+size_t history_verifier::cached_blocks() const
+{
+    return blocks_.size();
+}
+
+void history_verifier::clear()
+{
+    blocks_.clear();
+}
+
+code history_verifier::verify(const history::list& rows,
+    std::vector<code>& out_codes)
+{
+    out_codes.assign(rows.size(), error::success);
+
+    const auto start = headers_.start_height();
+    const auto end = start + headers_.size();
+    const auto covered = [&](uint64_t height)
+    {
+        return height >= start && height < end;
+    };
+
+    // Each block is queried once, however many rows it confirms.
+    std::vector<uint32_t> heights;
+    const auto require = [&](const point& point, uint64_t height)
+    {
+        const auto block = static_cast<uint32_t>(height);
+        if (!point.is_null() && !unconfirmed(height) && covered(height) &&
+            blocks_.find(block) == blocks_.end())
+            heights.push_back(block);
+    };
+
+    for (const auto& row: rows)
+    {
+        require(row.output, row.output_height);
+        require(row.spend, row.spend_height);
+    }
+
+    std::sort(heights.begin(), heights.end());
+    heights.erase(std::unique(heights.begin(), heights.end()), heights.end());
+
+    const auto ec = fetch_blocks(heights);
+
+    code result(error::success);
+    for (size_t index = 0; index < rows.size(); ++index)
+    {
+        const auto& row = rows[index];
+        auto& row_ec = out_codes[index];
+
+        // Unconfirmed points have no block to verify against.
+        if (!row.output.is_null() && !unconfirmed(row.output_height))
+            row_ec = verify_point(row.output.hash(), row.output_height);
+
+        if (!row_ec && !row.spend.is_null() && !unconfirmed(row.spend_height))
+            row_ec = verify_point(row.spend.hash(), row.spend_height);
+
+        // A height left unfetched by a failed round reports that failure.
+        if (row_ec == error::not_found && ec)
+            row_ec = ec;
+
+        if (row_ec && !result)
+            result = row_ec;
+    }
+
+    return result;
+}
+
+code history_verifier::fetch_blocks(const std::vector<uint32_t>& heights)
+{
+    if (settings_.concurrency == 0)
+        return error::operation_failed;
+
+    struct query
+    {
+        uint32_t height;
+        code ec;
+        hash_list hashes;
+    };
+
+    std::vector<query> round;
+    round.reserve(settings_.concurrency);
+
+    for (size_t next = 0; next < heights.size();)
+    {
+        const auto end = std::min(heights.size(),
+            next + settings_.concurrency);
+
+        round.clear();
+        for (auto index = next; index < end; ++index)
+            round.push_back({ heights[index], error::success, {} });
+
+        // The round is fully allocated, so handlers may retain references.
+        for (auto& entry: round)
+        {
+            auto handler = [&entry](const code& ec, const hash_list& hashes)
+            {
+                entry.ec = ec;
+                entry.hashes = hashes;
+            };
+
+            client_.blockchain_fetch_block_transaction_hashes(handler,
+                entry.height);
+        }
+
+        // Queries are pipelined over the connection and resolved together.
+        client_.wait(settings_.timeout_milliseconds);
+
+        code result(error::success);
+        for (const auto& entry: round)
+        {
+            // Failed queries are not cached, so that they may be retried,
+            // but the results of the others in the round are retained.
+            if (entry.ec)
+            {
+                if (!result)
+                    result = entry.ec;
+
+                continue;
+            }
+
+            const auto& header = headers_.header(entry.height -
+                headers_.start_height());
+
+            auto& block = blocks_[entry.height];
+            if (merkle_root(entry.hashes) != header.merkle_root())
+            {
+                block.ec = error::merkle_mismatch;
+                continue;
+            }
+
+            block.ec = error::success;
+            block.hashes.insert(entry.hashes.begin(), entry.hashes.end());
+        }
+
+        if (result)
+            return result;
+
+        next = end;
+    }
+
+    return error::success;
+}
+
+code history_verifier::verify_point(const hash_digest& tx_hash,
+    uint64_t height) const
+{
+    const auto block = blocks_.find(static_cast<uint32_t>(height));
+    if (height > max_uint32 || block == blocks_.end())
+        return error::not_found;
+
+    if (block->second.ec)
+        return block->second.ec;
+
+    const auto& hashes = block->second.hashes;
+    return hashes.find(tx_hash) == hashes.end() ? error::not_found :
+        error::success;
+}
+
+} // namespace client
+} // namespace libbitcoin
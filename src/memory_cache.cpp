@@ -0,0 +1,93 @@
+/**
+ * Copyright (c) 2011-2019 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/client/memory_cache.hpp>
+
+using namespace bc::system;
+
+namespace libbitcoin {
+namespace client {
+
+memory_cache::memory_cache(size_t capacity_bytes)
+  : capacity_(capacity_bytes),
+    size_(0)
+{
+}
+
+bool memory_cache::fetch(const hash_digest& key, data_chunk& payload)
+{
+    // Critical Section.
+    ///////////////////////////////////////////////////////////////////////////
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto it = index_.find(key);
+    if (it == index_.end())
+        return false;
+
+    entries_.splice(entries_.begin(), entries_, it->second);
+    payload = it->second->second;
+    return true;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+void memory_cache::store(const hash_digest& key, const data_chunk& payload)
+{
+    if (payload.size() > capacity_)
+        return;
+
+    // Critical Section.
+    ///////////////////////////////////////////////////////////////////////////
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (index_.find(key) != index_.end())
+        return;
+
+    // Evict least recently used payloads until the new payload fits.
+    while (!entries_.empty() && size_ + payload.size() > capacity_)
+    {
+        size_ -= entries_.back().second.size();
+        index_.erase(entries_.back().first);
+        entries_.pop_back();
+    }
+
+    entries_.emplace_front(key, payload);
+    index_.emplace(key, entries_.begin());
+    size_ += payload.size();
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+void memory_cache::clear()
+{
+    // Critical Section.
+    ///////////////////////////////////////////////////////////////////////////
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.clear();
+    index_.clear();
+    size_ = 0;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+size_t memory_cache::size() const
+{
+    // Critical Section.
+    ///////////////////////////////////////////////////////////////////////////
+    std::lock_guard<std::mutex> lock(mutex_);
+    return size_;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+} // namespace client
+} // namespace libbitcoin
@@ -0,0 +1,359 @@
+/**
+ * Copyright (c) 2011-2019 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/client/mempool_mirror.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <utility>
+#include <vector>
+
+using namespace bc::system;
+using namespace bc::system::chain;
+using namespace std::chrono;
+
+namespace libbitcoin {
+namespace client {
+
+static uint64_t now_seconds()
+{
+    return duration_cast<seconds>(
+        system_clock::now().time_since_epoch()).count();
+}
+
+const uint64_t mempool_mirror::unknown_fee;
+
+uint64_t mempool_mirror::entry::fee_rate() const
+{
+    if (fee == unknown_fee || virtual_size == 0)
+        return 0;
+
+    return fee * 1000u / virtual_size;
+}
+
+mempool_mirror::mempool_mirror(prevout_lookup lookup,
+    removal_handler on_remove)
+  : lookup_(lookup),
+    on_remove_(on_remove)
+{
+}
+
+bool mempool_mirror::store(const transaction& tx)
+{
+    if (tx.is_coinbase())
+        return false;
+
+    const auto tx_hash = tx.hash();
+    entry item
+    {
+        tx_hash,
+        tx.serialized_size(true, true),
+        (tx.weight() + 3u) / 4u,
+        unknown_fee,
+        now_seconds(),
+        {},
+        {}
+    };
+
+    item.spends.reserve(tx.inputs().size());
+    for (const auto& input: tx.inputs())
+        item.spends.push_back(input.previous_output());
+
+    item.values.reserve(tx.outputs().size());
+    for (const auto& output: tx.outputs())
+        item.values.push_back(output.value());
+
+    // Previous outputs are looked up before the mutex is locked.
+    const auto resolved = resolve(tx);
+    hash_list replaced;
+
+    // Critical Section.
+    ///////////////////////////////////////////////////////////////////////////
+    mutex_.lock();
+
+    if (entries_.find(tx_hash) != entries_.end())
+    {
+        mutex_.unlock();
+        return false;
+    }
+
+    // The server announces only accepted transactions, so a conflict has
+    // been replaced.
+    for (const auto& outpoint: item.spends)
+    {
+        const auto it = spenders_.find(outpoint);
+        if (it != spenders_.end())
+            remove(replaced, hash_digest(it->second), true);
+    }
+
+    item.fee = compute_fee(tx, resolved);
+
+    for (const auto& outpoint: item.spends)
+        spenders_[outpoint] = tx_hash;
+
+    entries_.emplace(tx_hash, std::move(item));
+
+    mutex_.unlock();
+    ///////////////////////////////////////////////////////////////////////////
+
+    notify(replaced);
+    return true;
+}
+
+size_t mempool_mirror::confirm(const block& block)
+{
+    hash_list confirmed;
+    hash_list conflicted;
+
+    // Critical Section.
+    ///////////////////////////////////////////////////////////////////////////
+    mutex_.lock();
+
+    for (const auto& tx: block.transactions())
+    {
+        const auto tx_hash = tx.hash();
+        remove(confirmed, tx_hash, false);
+
+        if (tx.is_coinbase())
+            continue;
+
+        // Mirrored spenders of confirmed spends are now invalid.
+        for (const auto& input: tx.inputs())
+        {
+            const auto it = spenders_.find(input.previous_output());
+            if (it != spenders_.end() && it->second != tx_hash)
+                remove(conflicted, hash_digest(it->second), true);
+        }
+    }
+
+    mutex_.unlock();
+    ///////////////////////////////////////////////////////////////////////////
+
+    notify(conflicted);
+    return confirmed.size() + conflicted.size();
+}
+
+size_t mempool_mirror::expire(uint64_t max_age_seconds)
+{
+    const auto now = now_seconds();
+    const auto cutoff = now > max_age_seconds ? now - max_age_seconds : 0;
+    hash_list removed;
+
+    // Critical Section.
+    ///////////////////////////////////////////////////////////////////////////
+    mutex_.lock();
+
+    hash_list expired;
+    for (const auto& item: entries_)
+        if (item.second.time < cutoff)
+            expired.push_back(item.first);
+
+    // Expired descendants may already have been removed with a parent.
+    for (const auto& tx_hash: expired)
+        remove(removed, tx_hash, true);
+
+    mutex_.unlock();
+    ///////////////////////////////////////////////////////////////////////////
+
+    notify(removed);
+    return removed.size();
+}
+
+bool mempool_mirror::find(entry& out, const hash_digest& tx_hash) const
+{
+    // Critical Section.
+    ///////////////////////////////////////////////////////////////////////////
+    shared_lock lock(mutex_);
+
+    const auto it = entries_.find(tx_hash);
+    if (it == entries_.end())
+        return false;
+
+    out = it->second;
+    return true;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+bool mempool_mirror::spender(hash_digest& out_hash,
+    const point& outpoint) const
+{
+    // Critical Section.
+    ///////////////////////////////////////////////////////////////////////////
+    shared_lock lock(mutex_);
+
+    const auto it = spenders_.find(outpoint);
+    if (it == spenders_.end())
+        return false;
+
+    out_hash = it->second;
+    return true;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+hash_list mempool_mirror::conflicts(const transaction& tx) const
+{
+    const auto tx_hash = tx.hash();
+    hash_list hashes;
+
+    // Critical Section.
+    ///////////////////////////////////////////////////////////////////////////
+    shared_lock lock(mutex_);
+
+    for (const auto& input: tx.inputs())
+    {
+        const auto it = spenders_.find(input.previous_output());
+        if (it != spenders_.end() && it->second != tx_hash &&
+            std::find(hashes.begin(), hashes.end(), it->second) ==
+                hashes.end())
+            hashes.push_back(it->second);
+    }
+
+    return hashes;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+size_t mempool_mirror::size() const
+{
+    // Critical Section.
+    ///////////////////////////////////////////////////////////////////////////
+    shared_lock lock(mutex_);
+    return entries_.size();
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+mempool_mirror::list mempool_mirror::entries() const
+{
+    list out;
+
+    // Critical Section.
+    ///////////////////////////////////////////////////////////////////////////
+    shared_lock lock(mutex_);
+    out.reserve(entries_.size());
+
+    for (const auto& item: entries_)
+        out.push_back(item.second);
+
+    return out;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+// Private (exclusive lock required).
+//-----------------------------------------------------------------------------
+
+void mempool_mirror::remove(hash_list& removed, const hash_digest& tx_hash,
+    bool descendants)
+{
+    const auto it = entries_.find(tx_hash);
+    if (it == entries_.end())
+        return;
+
+    const auto item = std::move(it->second);
+    entries_.erase(it);
+    removed.push_back(tx_hash);
+
+    for (const auto& outpoint: item.spends)
+    {
+        const auto spent = spenders_.find(outpoint);
+        if (spent != spenders_.end() && spent->second == tx_hash)
+            spenders_.erase(spent);
+    }
+
+    if (!descendants)
+        return;
+
+    for (uint32_t index = 0; index < item.values.size(); ++index)
+    {
+        const auto child = spenders_.find({ tx_hash, index });
+        if (child != spenders_.end())
+            remove(removed, hash_digest(child->second), true);
+    }
+}
+
+uint64_t mempool_mirror::compute_fee(const transaction& tx,
+    const std::vector<uint64_t>& resolved) const
+{
+    uint64_t value_in = 0;
+    const auto& inputs = tx.inputs();
+
+    for (size_t index = 0; index < inputs.size(); ++index)
+    {
+        const auto& outpoint = inputs[index].previous_output();
+        const auto parent = entries_.find(outpoint.hash());
+
+        uint64_t value;
+        if (parent != entries_.end() &&
+            outpoint.index() < parent->second.values.size())
+            value = parent->second.values[outpoint.index()];
+        else if (resolved[index] != unknown_fee)
+            value = resolved[index];
+        else
+            return unknown_fee;
+
+        value_in += value;
+    }
+
+    const auto value_out = tx.total_output_value();
+    return value_in < value_out ? unknown_fee : value_in - value_out;
+}
+
+// Private (unlocked).
+//-----------------------------------------------------------------------------
+
+std::vector<uint64_t> mempool_mirror::resolve(const transaction& tx) const
+{
+    const auto& inputs = tx.inputs();
+    std::vector<uint64_t> values(inputs.size(), unknown_fee);
+    if (!lookup_)
+        return values;
+
+    std::vector<bool> mirrored(inputs.size(), false);
+
+    // Critical Section.
+    ///////////////////////////////////////////////////////////////////////////
+    mutex_.lock_shared();
+
+    for (size_t index = 0; index < inputs.size(); ++index)
+        mirrored[index] = entries_.find(
+            inputs[index].previous_output().hash()) != entries_.end();
+
+    mutex_.unlock_shared();
+    ///////////////////////////////////////////////////////////////////////////
+
+    // The lookup may block, or query the mirror, as no lock is held.
+    for (size_t index = 0; index < inputs.size(); ++index)
+    {
+        uint64_t value;
+        if (!mirrored[index] &&
+            lookup_(value, inputs[index].previous_output()))
+            values[index] = value;
+    }
+
+    return values;
+}
+
+void mempool_mirror::notify(const hash_list& removed) const
+{
+    if (!on_remove_)
+        return;
+
+    for (const auto& tx_hash: removed)
+        on_remove_(tx_hash);
+}
+
+} // namespace client
+} // namespace libbitcoin
@@ -0,0 +1,158 @@
+/**
+ * Copyright (c) 2011-2019 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/client/notification_coalescer.hpp>
+
+#include <algorithm>
+#include <vector>
+
+using namespace bc::system;
+using namespace std::chrono;
+
+namespace libbitcoin {
+namespace client {
+
+notification_coalescer::notification_coalescer(uint32_t window_milliseconds,
+    update_handler on_update)
+  : window_(milliseconds(window_milliseconds)),
+    on_update_(on_update),
+    state_(std::make_shared<state>()),
+    client_(nullptr)
+{
+}
+
+void notification_coalescer::set_history_fetch(obelisk_client& client,
+    obelisk_client::key_history_handler on_history)
+{
+    client_ = &client;
+    on_history_ = on_history;
+}
+
+obelisk_client::key_update_handler notification_coalescer::handler() const
+{
+    const auto shared = state_;
+
+    return [shared](const code& ec, const hash_digest& key, uint16_t sequence,
+        size_t height, const hash_digest& tx_hash)
+    {
+        if (!ec && tx_hash == null_hash)
+            return;
+
+        // Critical Section.
+        ///////////////////////////////////////////////////////////////////////
+        std::lock_guard<std::mutex> lock(shared->mutex);
+
+        auto it = shared->windows.find(key);
+        if (it == shared->windows.end())
+            it = shared->windows.emplace(key, window
+            {
+                clock::now(),
+                { error::success, key, {}, 0, false, 0, 0 }
+            }).first;
+
+        auto& value = it->second.value;
+        ++value.notifications;
+
+        if (ec)
+        {
+            value.ec = ec;
+            return;
+        }
+
+        value.sequence = sequence;
+
+        // Unconfirmed transactions are notified at height zero.
+        if (height == 0)
+            value.unconfirmed = true;
+        else if (value.minimum_height == 0 || height < value.minimum_height)
+            value.minimum_height = height;
+
+        auto& hashes = value.tx_hashes;
+        if (std::find(hashes.begin(), hashes.end(), tx_hash) == hashes.end())
+            hashes.push_back(tx_hash);
+        ///////////////////////////////////////////////////////////////////////
+    };
+}
+
+size_t notification_coalescer::flush(bool all)
+{
+    const auto now = clock::now();
+    std::vector<update> updates;
+
+    // Critical Section.
+    ///////////////////////////////////////////////////////////////////////////
+    state_->mutex.lock();
+
+    for (auto it = state_->windows.begin(); it != state_->windows.end();)
+    {
+        if (!all && !it->second.value.ec && now - it->second.start < window_)
+        {
+            ++it;
+            continue;
+        }
+
+        updates.push_back(std::move(it->second.value));
+        it = state_->windows.erase(it);
+    }
+
+    state_->mutex.unlock();
+    ///////////////////////////////////////////////////////////////////////////
+
+    for (const auto& value: updates)
+    {
+        if (on_update_)
+            on_update_(value);
+
+        if (client_ == nullptr || value.ec)
+            continue;
+
+        // Confirmed rows below the minimum height are already known.
+        auto& confirmed_height = confirmed_heights_[value.key];
+        const auto from_height = value.minimum_height == 0 ?
+            confirmed_height : value.minimum_height;
+
+        if (value.minimum_height != 0)
+            confirmed_height = value.minimum_height;
+
+        const auto key = value.key;
+        const auto on_history = on_history_;
+        auto handler = [on_history, key](const code& ec,
+            const history::list& rows)
+        {
+            if (on_history)
+                on_history(ec, key, rows);
+        };
+
+        client_->blockchain_fetch_history4(handler, key,
+            static_cast<uint32_t>(from_height));
+    }
+
+    return updates.size();
+}
+
+size_t notification_coalescer::pending() const
+{
+    // Critical Section.
+    ///////////////////////////////////////////////////////////////////////////
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    return state_->windows.size();
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+} // namespace client
+} // namespace libbitcoin
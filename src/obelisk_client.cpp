@@ -19,9 +19,17 @@
 #include <bitcoin/client/obelisk_client.hpp>
 
 #include <algorithm>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <sstream>
 #include <thread>
+#include <type_traits>
+#include <unordered_set>
+#include <utility>
 
 #include <bitcoin/protocol/zmq/message.hpp>
+#include <bitcoin/client/verification.hpp>
 
 using namespace bc::protocol;
 using namespace bc::system;
@@ -43,6 +51,21 @@ static const config::endpoint public_subscribe_worker(
 static const config::endpoint secure_subscribe_worker(
     "inproc://secure_subscribe_client");
 
+// The number of concurrent readers of the subscriptions without waiting.
+static constexpr size_t subscription_reader_slots = 64;
+
+// The command is delimited so that no two requests share a key.
+static hash_digest request_key(const std::string& command,
+    const data_chunk& payload)
+{
+    return sha256_hash(build_chunk(
+    {
+        to_chunk(command),
+        to_array(0x00),
+        payload
+    }));
+}
+
 obelisk_client::obelisk_client(int32_t retries)
   : socket_(context_, zmq::socket::role::dealer),
     subscribe_socket_(context_, zmq::socket::role::dealer),
@@ -53,10 +76,25 @@ obelisk_client::obelisk_client(int32_t retries)
     subscribe_dealer_(context_, zmq::socket::role::dealer),
     subscribe_router_(context_, zmq::socket::role::router),
     retries_(retries),
-    last_request_index_(0),
     secure_(false),
     worker_(public_worker),
-    subscribe_worker_(public_subscribe_worker)
+    subscribe_worker_(public_subscribe_worker),
+    last_request_index_(0),
+    subscriptions_(new subscription_table()),
+    subscription_epoch_(1),
+    subscription_readers_(
+        new subscription_reader[subscription_reader_slots]()),
+    max_batch_(0),
+    first_reply_milliseconds_(0),
+    batch_replied_(false),
+    verify_(false),
+    negotiated_(false),
+    capabilities_{},
+    reorg_depth_(0),
+    cache_metrics_{},
+    tip_height_(0),
+    playing_(false),
+    replaying_(false)
 {
     attach_handlers();
 }
@@ -71,6 +109,7 @@ obelisk_client::~obelisk_client()
     subscribe_socket_.stop();
     block_socket_.stop();
     transaction_socket_.stop();
+    delete subscriptions_.load();
 }
 
 bool obelisk_client::connect(const connection_settings& settings)
@@ -187,9 +226,31 @@ void obelisk_client::process_response(zmq::socket& socket)
     message.dequeue(id);
     message.dequeue(payload);
 
+    handle_response(command, id, payload);
+}
+
+void obelisk_client::handle_response(const std::string& command, uint32_t id,
+    const data_chunk& payload)
+{
+    if (command == batch_command)
+    {
+        handle_batch(id, payload);
+        return;
+    }
+
+    record(true, command, id, payload);
+    observe_height(command, payload);
+
+    // A retained response is admitted only once its handler has decoded it.
+    const auto pending = cache_pending_.find(id);
+    if (pending != cache_pending_.end())
+        pending->second.payload = &payload;
+
     const auto handler = command_handlers_.find(command);
     if (handler != command_handlers_.end())
         handler->second(command, id, payload);
+
+    cache_pending_.erase(id);
 }
 
 // Used by query commands and fires handlers as needed.
@@ -205,6 +266,15 @@ void obelisk_client::wait(uint32_t timeout_milliseconds)
     while (!poller.terminated() && requests_outstanding() &&
         steady_clock::now() < deadline)
     {
+        // Responses from the cache and playback are delivered without polling.
+        dispatch_cached();
+        dispatch_played(played_responses_);
+        if (!requests_outstanding())
+            break;
+
+        flush_batch();
+        expire_batches();
+
         const auto identifiers = poller.wait(poll_timeout_milliseconds);
 
         // Forward incoming client router requests to the server.
@@ -222,6 +292,50 @@ void obelisk_client::wait(uint32_t timeout_milliseconds)
             error::channel_timeout : error::operation_failed);
 }
 
+// Used by event loops that interleave queries with other work.
+bool obelisk_client::poll(uint32_t timeout_milliseconds)
+{
+    zmq::poller poller;
+    poller.add(socket_);
+    poller.add(router_);
+
+    // Responses from the cache and playback are delivered without polling.
+    dispatch_cached();
+    dispatch_played(played_responses_);
+    flush_batch();
+    expire_batches();
+
+    // Wait only for the first event, then drain whatever else is ready.
+    auto identifiers = poller.wait(timeout_milliseconds);
+    while (!poller.terminated() && !identifiers.empty())
+    {
+        // Forward incoming client router requests to the server.
+        if (identifiers.contains(router_.id()))
+            forward_message(router_, socket_);
+
+        // Process server responses.
+        if (identifiers.contains(socket_.id()))
+            process_response(socket_);
+
+        dispatch_cached();
+        dispatch_played(played_responses_);
+        identifiers = poller.wait(0);
+    }
+
+    return requests_outstanding();
+}
+
+void obelisk_client::add_sockets(zmq::poller& poller)
+{
+    poller.add(socket_);
+    poller.add(router_);
+}
+
+obelisk_client::timeout_map obelisk_client::timeouts() const
+{
+    return timeouts_;
+}
+
 bool obelisk_client::subscribe_block(const config::endpoint& address,
     block_update_handler on_update)
 {
@@ -262,6 +376,8 @@ void obelisk_client::monitor(uint32_t timeout_milliseconds)
     // A timeout of 0 will still have a chance to complete.
     do
     {
+        dispatch_played(played_notifications_);
+
         const auto identifiers = poller.wait(timeout_milliseconds);
         if (identifiers.contains(block_socket_.id()))
         {
@@ -279,6 +395,9 @@ void obelisk_client::monitor(uint32_t timeout_milliseconds)
             chain::block block;
             block.from_data(data, true);
 
+            if (height > tip_height_)
+                tip_height_ = height;
+
             on_block_update_(block);
         }
 
@@ -319,6 +438,43 @@ void obelisk_client::monitor(uint32_t timeout_milliseconds)
 bool obelisk_client::send_request(const std::string& command,
     uint32_t id, const data_chunk& payload, bool subscription)
 {
+    // Avoid the round trip for a command the server is known not to support,
+    // which is not a network failure.
+    if (!supported(command))
+    {
+        handle_immediate(command, id, error::operation_failed);
+        return false;
+    }
+
+    if (cache_ && !subscription && fetch_cached(command, id, payload))
+        return true;
+
+    record(false, command, id, payload);
+
+    if (max_batch_ != 0 && !subscription)
+    {
+        batch_queue_.push_back({ command, id, payload });
+        if (batch_queue_.size() >= max_batch_)
+            flush_batch();
+
+        return true;
+    }
+
+    if (!send_message(command, id, payload, subscription))
+    {
+        handle_immediate(command, id, error::network_unreachable);
+        return false;
+    }
+
+    return true;
+}
+
+bool obelisk_client::send_message(const std::string& command, uint32_t id,
+    const data_chunk& payload, bool subscription)
+{
+    if (playing_)
+        return play(command, id, payload, subscription);
+
     zmq::message message;
     // First, add the required delimiter since we're sending to our
     // internal router socket.
@@ -327,12 +483,657 @@ bool obelisk_client::send_request(const std::string& command,
     message.enqueue(to_chunk(to_little_endian(id)));
     message.enqueue(payload);
 
-    return subscription ? !subscribe_dealer_.send(message) :
-        !dealer_.send(message);
-}
+    return subscription ? !subscribe_dealer_.send(message) :
+        !dealer_.send(message);
+}
+
+// Bulk fetchers.
+//-----------------------------------------------------------------------------
+
+code obelisk_client::fetch_headers(header_buffer& out, uint32_t start_height,
+    uint32_t count, uint32_t window, uint32_t timeout_milliseconds)
+{
+    static constexpr auto poll_timeout_milliseconds = 100;
+    const auto timeout = milliseconds(timeout_milliseconds);
+
+    out = header_buffer(start_height, count);
+    window = std::max(window, 1u);
+
+    code result(error::success);
+    uint32_t next = 0;
+    uint32_t pending = 0;
+    auto deadline = steady_clock::now() + timeout;
+
+    // Handlers reference this frame, so all must fire before returning.
+    while (pending != 0 || (!result && next < count))
+    {
+        // Requests are topped up outside of handlers, which must not issue.
+        while (!result && pending < window && next < count)
+        {
+            const auto index = next++;
+            auto handler = [&, index](const code& ec,
+                const chain::header& header)
+            {
+                --pending;
+
+                if (ec)
+                {
+                    if (!result)
+                        result = ec;
+
+                    return;
+                }
+
+                out.set(index, header);
+                deadline = steady_clock::now() + timeout;
+            };
+
+            ++pending;
+            blockchain_fetch_block_header(handler, start_height + index);
+        }
+
+        if (pending == 0)
+            continue;
+
+        poll(poll_timeout_milliseconds);
+
+        // Zero wait fails the queries that remain with a timeout.
+        if (pending != 0 && steady_clock::now() >= deadline)
+            wait(0);
+    }
+
+    if (!result && verify_ && !out.empty())
+    {
+        // The first header is linked to its own previous block hash.
+        hash_list hashes;
+        if (!verify_header_chain(hashes, out,
+            out.header(0).previous_block_hash()))
+            result = error::bad_stream;
+    }
+
+    return result;
+}
+
+// Batching.
+//-----------------------------------------------------------------------------
+
+// [ count:varint ] [ [ command ][ id:4 ][ payload ] ]...
+// The reply is prefixed by [ code:4 ], nonzero if batching is unsupported.
+// Strings and payloads are prefixed by their varint size.
+const std::string obelisk_client::batch_command = "server.batch";
+
+void obelisk_client::set_batching(size_t max_batch,
+    uint32_t first_reply_milliseconds)
+{
+    flush_batch();
+    max_batch_ = max_batch;
+    first_reply_milliseconds_ = first_reply_milliseconds;
+}
+
+data_chunk obelisk_client::encode_batch(const batched_message::list& queries)
+{
+    data_chunk payload;
+    data_sink ostream(payload);
+    ostream_writer sink(ostream);
+    sink.write_size_little_endian(queries.size());
+
+    for (const auto& query: queries)
+    {
+        sink.write_string(query.command);
+        sink.write_4_bytes_little_endian(query.id);
+        sink.write_size_little_endian(query.payload.size());
+        sink.write_bytes(query.payload);
+    }
+
+    ostream.flush();
+    return payload;
+}
+
+bool obelisk_client::decode_batch(const data_chunk& payload,
+    batched_message::list& replies)
+{
+    data_source istream(payload);
+    istream_reader source(istream);
+    if (source.read_error_code() || !source)
+        return false;
+
+    const auto count = source.read_size_little_endian();
+    for (size_t reply = 0; reply < count && source; ++reply)
+    {
+        auto command = source.read_string();
+        const auto id = source.read_4_bytes_little_endian();
+        auto reply_payload = source.read_bytes(
+            source.read_size_little_endian());
+
+        if (source)
+            replies.push_back({ std::move(command), id,
+                std::move(reply_payload) });
+    }
+
+    return true;
+}
+
+void obelisk_client::flush_batch()
+{
+    if (batch_queue_.empty())
+        return;
+
+    request_list requests;
+    requests.swap(batch_queue_);
+
+    // Batching is disabled once the server is found not to support it.
+    if (requests.size() == 1 || max_batch_ == 0)
+    {
+        send_individually(requests);
+        return;
+    }
+
+    const auto id = ++last_request_index_;
+    if (!send_message(batch_command, id, encode_batch(requests), false))
+    {
+        for (const auto& request: requests)
+            handle_immediate(request.command, request.id,
+                error::network_unreachable);
+
+        return;
+    }
+
+    // Retained so that they can be sent individually if the batch fails.
+    batches_[id] = { steady_clock::now(), std::move(requests) };
+}
+
+void obelisk_client::send_individually(const request_list& requests)
+{
+    for (const auto& request: requests)
+        if (!send_message(request.command, request.id, request.payload, false))
+            handle_immediate(request.command, request.id,
+                error::network_unreachable);
+}
+
+void obelisk_client::handle_batch(uint32_t id, const data_chunk& payload)
+{
+    const auto batch = batches_.find(id);
+    if (batch == batches_.end())
+        return;
+
+    const auto requests = std::move(batch->second.requests);
+    batches_.erase(batch);
+
+    // Fall back to individual requests for a server that does not batch.
+    batched_message::list replies;
+    if (!decode_batch(payload, replies))
+    {
+        max_batch_ = 0;
+        send_individually(requests);
+        return;
+    }
+
+    batch_replied_ = true;
+    std::unordered_set<uint32_t> replied;
+    for (const auto& reply: replies)
+    {
+        replied.insert(reply.id);
+        handle_response(reply.command, reply.id, reply.payload);
+    }
+
+    // Queries without a reply, such as those after a truncated reply, fail.
+    for (const auto& request: requests)
+        if (replied.find(request.id) == replied.end())
+            handle_immediate(request.command, request.id, error::bad_stream);
+}
+
+void obelisk_client::expire_batches()
+{
+    if (batches_.empty())
+        return;
+
+    const auto cutoff = steady_clock::now() -
+        milliseconds(first_reply_milliseconds_);
+
+    request_list expired;
+    for (auto batch = batches_.begin(); batch != batches_.end();)
+    {
+        if (batch->second.sent > cutoff)
+        {
+            ++batch;
+            continue;
+        }
+
+        auto& requests = batch->second.requests;
+        std::move(requests.begin(), requests.end(),
+            std::back_inserter(expired));
+        batch = batches_.erase(batch);
+    }
+
+    if (expired.empty())
+        return;
+
+    // A server that does not support batching may not reply at all.
+    if (!batch_replied_)
+        max_batch_ = 0;
+
+    send_individually(expired);
+}
+
+// Verification.
+//-----------------------------------------------------------------------------
+// Hashes are computed by the decoded objects once and retained, and block
+// transactions are hashed in a batch for the merkle root.
+
+void obelisk_client::set_verification(bool verify)
+{
+    verify_ = verify;
+}
+
+obelisk_client::transaction_handler obelisk_client::verified(
+    transaction_handler handler, const hash_digest& tx_hash) const
+{
+    if (!verify_)
+        return handler;
+
+    return [handler, tx_hash](const code& ec, const chain::transaction& tx)
+    {
+        if (!ec && tx.hash() != tx_hash)
+            handler(error::bad_stream, {});
+        else
+            handler(ec, tx);
+    };
+}
+
+obelisk_client::block_header_handler obelisk_client::verified(
+    block_header_handler handler, const hash_digest& block_hash) const
+{
+    if (!verify_)
+        return handler;
+
+    return [handler, block_hash](const code& ec, const chain::header& header)
+    {
+        if (!ec && header.hash() != block_hash)
+            handler(error::bad_stream, {});
+        else
+            handler(ec, header);
+    };
+}
+
+obelisk_client::block_handler obelisk_client::verified(block_handler handler,
+    const hash_digest& block_hash) const
+{
+    if (!verify_)
+        return handler;
+
+    const auto merkle_verified = verified(handler);
+    return [handler, merkle_verified, block_hash](const code& ec,
+        const chain::block& block)
+    {
+        if (!ec && block.hash() != block_hash)
+            handler(error::bad_stream, {});
+        else
+            merkle_verified(ec, block);
+    };
+}
+
+obelisk_client::block_handler obelisk_client::verified(
+    block_handler handler) const
+{
+    if (!verify_)
+        return handler;
+
+    return [handler](const code& ec, const chain::block& block)
+    {
+        if (!ec && !verify_merkle_root(block))
+            handler(error::merkle_mismatch, {});
+        else
+            handler(ec, block);
+    };
+}
+
+// Recording.
+//-----------------------------------------------------------------------------
+
+void obelisk_client::set_recorder(traffic_recorder::ptr recorder)
+{
+    recorder_ = recorder;
+}
+
+void obelisk_client::record(bool response, const std::string& command,
+    uint32_t id, const data_chunk& payload)
+{
+    // Played and replayed traffic is not recorded again.
+    if (recorder_ && !playing_ && !replaying_)
+        recorder_->record(response, command, id, payload);
+}
+
+size_t obelisk_client::replay(const traffic_record::list& records)
+{
+    static const auto subscription = [](const std::string& command)
+    {
+        return command == "subscribe.key" || command == "notification.key";
+    };
+
+    // New ids are used, so that live requests are never affected.
+    std::vector<uint32_t> ids;
+    std::vector<uint32_t> subscriptions;
+    ids.reserve(records.size());
+
+    for (const auto& record: records)
+    {
+        ids.push_back(++last_request_index_);
+        if (record.response && subscription(record.command))
+            subscriptions.push_back(ids.back());
+    }
+
+    // Notifications are dispatched through subscriptions published together.
+    if (!subscriptions.empty())
+        add_replay_subscriptions(subscriptions);
+
+    size_t dispatched = 0;
+    replaying_ = true;
+
+    for (size_t index = 0; index < records.size(); ++index)
+    {
+        const auto& record = records[index];
+        if (!record.response || (!subscription(record.command) &&
+            !register_replay(record.command, ids[index])))
+            continue;
+
+        handle_response(record.command, ids[index], record.payload);
+        ++dispatched;
+    }
+
+    replaying_ = false;
+
+    // Notifications do not consume their subscription.
+    if (!subscriptions.empty())
+        remove_subscriptions(subscriptions);
+
+    return dispatched;
+}
+
+bool obelisk_client::register_replay(const std::string& command, uint32_t id)
+{
+    const auto family = command_families_.find(command);
+    if (family == command_families_.end())
+        return false;
+
+    pending_families_[family->second].discard(id);
+    return true;
+}
+
+void obelisk_client::add_replay_subscriptions(const std::vector<uint32_t>& ids)
+{
+    // Critical Section.
+    ///////////////////////////////////////////////////////////////////////////
+    subscription_lock_.lock();
+    auto subscriptions = *subscriptions_.load();
+    const auto handler = subscriptions.register_handler(
+        [](const code&, const hash_digest&, uint16_t, size_t,
+            const hash_digest&) {});
+
+    for (const auto id: ids)
+        subscriptions.add(id, null_hash, handler);
+
+    subscriptions.release_handler(handler);
+    publish(std::move(subscriptions));
+    subscription_lock_.unlock();
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+void obelisk_client::set_playback(const traffic_record::list& records)
+{
+    playing_ = !records.empty();
+    playback_requests_.clear();
+    playback_responses_.clear();
+    played_responses_.clear();
+    played_notifications_.clear();
+
+    for (const auto& record: records)
+    {
+        if (record.response)
+            playback_responses_[record.id].push_back(record);
+        else
+            playback_requests_[request_key(record.command, record.payload)]
+                .push_back(record.id);
+    }
+}
+
+bool obelisk_client::play(const std::string& command, uint32_t id,
+    const data_chunk& payload, bool subscription)
+{
+    // Unrecorded requests are not answered, as by an unresponsive server.
+    const auto requests = playback_requests_.find(request_key(command,
+        payload));
+    if (requests == playback_requests_.end() || requests->second.empty())
+        return true;
+
+    const auto recorded = requests->second.front();
+    requests->second.pop_front();
+
+    const auto responses = playback_responses_.find(recorded);
+    if (responses == playback_responses_.end())
+        return true;
+
+    // Notifications are delivered with the subscription responses.
+    auto& queue = subscription ? played_notifications_ : played_responses_;
+    for (const auto& response: responses->second)
+        queue.push_back({ response.command, id, response.payload });
+
+    return true;
+}
+
+void obelisk_client::dispatch_played(std::vector<queued_response>& responses)
+{
+    if (responses.empty())
+        return;
+
+    // Handlers may issue requests that are answered by playback.
+    std::vector<queued_response> played;
+    played.swap(responses);
+
+    for (const auto& response: played)
+        handle_response(response.command, response.id, response.payload);
+}
+
+// Caching.
+//-----------------------------------------------------------------------------
+
+// Commands with immutable results. Those of requests by height are admitted
+// only when buried, and are identified by their payload size. The height is
+// at the given offset of the payload.
+struct cache_rule
+{
+    size_t by_height_size;
+    size_t height_offset;
+};
+
+static const std::unordered_map<std::string, cache_rule> cache_rules
+{
+    { "blockchain.fetch_transaction", { 0, 0 } },
+    { "blockchain.fetch_transaction2", { 0, 0 } },
+    { "blockchain.fetch_block", { 4, 0 } },
+    { "blockchain.fetch_block_header", { 4, 0 } },
+    { "blockchain.fetch_block_transaction_hashes", { 4, 0 } },
+    { "blockchain.fetch_compact_filter", { 5, 1 } },
+    { "blockchain.fetch_compact_filter_headers", { 9, 5 } },
+    { "blockchain.fetch_compact_filter_checkpoint", { 0, 0 } }
+};
+
+void obelisk_client::set_cache(response_cache::ptr cache, uint32_t reorg_depth)
+{
+    cache_ = cache;
+    reorg_depth_ = reorg_depth;
+    cache_metrics_ = {};
+    cache_pending_.clear();
+    cached_responses_.clear();
+}
+
+response_cache::metrics obelisk_client::cache_metrics() const
+{
+    return cache_metrics_;
+}
+
+bool obelisk_client::fetch_cached(const std::string& command, uint32_t id,
+    const data_chunk& payload)
+{
+    const auto rule = cache_rules.find(command);
+    if (rule == cache_rules.end())
+        return false;
+
+    const auto key = request_key(command, payload);
+
+    data_chunk cached;
+    if (cache_->fetch(key, cached))
+    {
+        ++cache_metrics_.hits;
+        cached_responses_.push_back({ command, id, std::move(cached) });
+        return true;
+    }
+
+    ++cache_metrics_.misses;
+    const auto& height_rule = rule->second;
+    const auto by_height = payload.size() == height_rule.by_height_size;
+    const auto height = by_height ? from_little_endian_unsafe<uint32_t>(
+        payload.begin() + height_rule.height_offset) : 0u;
+
+    cache_pending_[id] = { key, by_height, height, nullptr };
+    return false;
+}
+
+void obelisk_client::admit_cached(uint32_t id)
+{
+    const auto it = cache_pending_.find(id);
+    if (it == cache_pending_.end() || it->second.payload == nullptr)
+        return;
+
+    const auto entry = it->second;
+    const auto& payload = *entry.payload;
+    cache_pending_.erase(it);
+
+    // Only successful results are cached, which lead with a zero error code.
+    static const uint32_t success = 0;
+    if (payload.size() < sizeof(uint32_t) ||
+        from_little_endian_unsafe<uint32_t>(payload.begin()) != success)
+        return;
+
+    // A result by height may change in a reorganization until it is buried.
+    if (entry.by_height &&
+        (entry.height > tip_height_ || tip_height_ - entry.height < reorg_depth_))
+    {
+        ++cache_metrics_.rejected;
+        return;
+    }
+
+    ++cache_metrics_.admitted;
+    cache_->store(entry.key, payload);
+}
+
+template <typename... Args>
+std::function<void(const code&, Args...)> obelisk_client::admitted(
+    std::function<void(const code&, Args...)> handler, uint32_t id)
+{
+    if (!cache_)
+        return handler;
+
+    return [this, handler, id](const code& ec, Args... args)
+    {
+        if (!ec)
+            admit_cached(id);
+
+        handler(ec, std::forward<Args>(args)...);
+    };
+}
+
+void obelisk_client::dispatch_cached()
+{
+    if (cached_responses_.empty())
+        return;
+
+    // Handlers may issue requests that are satisfied from the cache.
+    std::vector<queued_response> responses;
+    responses.swap(cached_responses_);
+
+    for (const auto& response: responses)
+    {
+        const auto handler = command_handlers_.find(response.command);
+        if (handler != command_handlers_.end())
+            handler->second(response.command, response.id, response.payload);
+    }
+}
+
+void obelisk_client::observe_height(const std::string& command,
+    const data_chunk& payload)
+{
+    // [ code:4 ][ height:4 ]
+    static const size_t height_size = 2 * sizeof(uint32_t);
+
+    if (command != "blockchain.fetch_last_height" ||
+        payload.size() != height_size)
+        return;
+
+    const auto height = from_little_endian_unsafe<uint32_t>(
+        payload.begin() + sizeof(uint32_t));
+
+    if (height > tip_height_)
+        tip_height_ = height;
+}
+
+// Handlers.
+//-----------------------------------------------------------------------------
+
+// Fires the handler with the error code and default values.
+template <typename... Args>
+static void expire_handler(
+    const std::function<void(const code&, Args...)>& handler, const code& ec)
+{
+    handler(ec, typename std::decay<Args>::type()...);
+}
+
+// A handler that discards its arguments.
+struct discard_handler
+{
+    template <typename... Args>
+    void operator()(Args&&...) const
+    {
+    }
+};
+
+template <typename Handlers>
+size_t obelisk_client::register_family(const std::string& name,
+    Handlers& handlers)
+{
+    const auto named = [&name](const pending_family& family)
+    {
+        return family.name == name;
+    };
+
+    const auto it = std::find_if(pending_families_.begin(),
+        pending_families_.end(), named);
+
+    if (it != pending_families_.end())
+        return std::distance(pending_families_.begin(), it);
 
-// Handlers.
-//-----------------------------------------------------------------------------
+    auto size = [&handlers]()
+    {
+        return handlers.size();
+    };
+
+    auto expire = [&handlers](const code& ec)
+    {
+        // Detached first, so that expired handlers may issue requests.
+        Handlers expired;
+        expired.swap(handlers);
+
+        for (const auto& handler: expired)
+            expire_handler(handler.second, ec);
+    };
+
+    auto discard = [&handlers](uint32_t id)
+    {
+        handlers[id] = discard_handler();
+    };
+
+    pending_families_.push_back({ name, size, expire, discard });
+    return pending_families_.size() - 1;
+}
 
 void obelisk_client::attach_handlers()
 {
@@ -404,6 +1205,15 @@ void obelisk_client::attach_handlers()
         istream_reader source(istream);
         const auto ec = source.read_error_code();
         const size_t height = source.read_4_bytes_little_endian();
+
+        // The height may be omitted on error.
+        if (!ec && (!source || !source.is_exhausted()))
+        {
+            handler->second(error::bad_stream, {});
+            height_handlers_.erase(handler);
+            return;
+        }
+
         handler->second(ec, height);
         height_handlers_.erase(handler);
     };
@@ -567,6 +1377,15 @@ void obelisk_client::attach_handlers()
         const auto ec = source.read_error_code();
         const auto block_height = source.read_4_bytes_little_endian();
         const auto index = source.read_4_bytes_little_endian();
+
+        // The position may be omitted on error.
+        if (!ec && (!source || !source.is_exhausted()))
+        {
+            handler->second(error::bad_stream, {}, {});
+            transaction_index_handlers_.erase(handler);
+            return;
+        }
+
         handler->second(ec, block_height, index);
         transaction_index_handlers_.erase(handler);
     };
@@ -588,7 +1407,7 @@ void obelisk_client::attach_handlers()
         {
             if (!payment.from_data(source, true))
             {
-                handler->second(ec, {});
+                handler->second(error::bad_stream, {});
                 history_handlers_.erase(handler);
                 return;
             }
@@ -596,6 +1415,14 @@ void obelisk_client::attach_handlers()
             records.push_back(payment);
         }
 
+        // A truncated code invalidates the source.
+        if (!source)
+        {
+            handler->second(error::bad_stream, {});
+            history_handlers_.erase(handler);
+            return;
+        }
+
         history::list result;
         result.reserve(records.size());
         std::unordered_multimap<uint64_t, size_t> output_checksums;
@@ -676,23 +1503,23 @@ void obelisk_client::attach_handlers()
         history_handlers_.erase(handler);
     };
 
-    // This handler locks subscription_handlers_ while running to avoid
-    // subscription handler state from changing while running (called from
-    // process_response).
+    // This handler takes no lock, the acquired subscriptions snapshot retains
+    // the handler while it runs and positions are recorded atomically (called
+    // from process_response).
     auto notification_handler = [this](const std::string&, uint32_t id,
         const data_chunk& payload)
     {
-        // Critical Section.
-        ///////////////////////////////////////////////////////////////////////////
-        subscription_lock_.lock_upgrade();
-        auto it = subscription_handlers_.find(id);
-        if (it == subscription_handlers_.end())
+        size_t reader;
+        const auto& subscriptions = acquire_subscriptions(reader);
+        const auto slot = subscriptions.find(id);
+        if (slot == subscription_table::not_found)
         {
-            subscription_lock_.unlock_upgrade();
+            release_subscriptions(reader);
             return;
         }
 
-        auto& handler = it->second.first;
+        const auto& handler = subscriptions.get_handler(slot);
+        const auto& key = subscriptions.key(slot);
         // [ code:4 ]     <- if this is nonzero then rest may be empty.
         // [ sequence:2 ] <- if out of order there was a lost message.
         // [ height:4 ]   <- 0 for unconfirmed or error tx (cannot notify genesis).
@@ -703,34 +1530,40 @@ void obelisk_client::attach_handlers()
         const auto ec = source.read_error_code();
         if (ec)
         {
-            handler(ec, {}, {}, {});
-            subscription_lock_.unlock_upgrade_and_lock();
-            subscription_handlers_.erase(it);
-            subscription_lock_.unlock();
+            handler(ec, key, {}, {}, {});
+            release_subscriptions(reader);
+            remove_subscription(id);
+            return;
+        }
+
+        // The subscribe response acknowledges with the code alone.
+        if (payload.size() == sizeof(uint32_t))
+        {
+            handler(ec, key, {}, {}, {});
+            release_subscriptions(reader);
             return;
         }
 
         const auto sequence = source.read_2_bytes_little_endian();
-        const size_t height = source.read_4_bytes_little_endian();
+        const auto height = source.read_4_bytes_little_endian();
         const auto tx_hash = source.read_hash();
 
-        if (!source.is_exhausted())
+        if (!source || !source.is_exhausted())
         {
-            handler(error::bad_stream, {}, {}, {});
-            subscription_lock_.unlock_upgrade_and_lock();
-            subscription_handlers_.erase(it);
-            subscription_lock_.unlock();
+            handler(error::bad_stream, key, {}, {}, {});
+            release_subscriptions(reader);
+            remove_subscription(id);
             return;
         }
 
-        subscription_lock_.unlock_upgrade();
-        ///////////////////////////////////////////////////////////////////////////
+        // Retain the notification position for durable state.
+        subscriptions.update_position(slot, sequence, height);
 
-        // Caller must differentiate type of update if subscribed to multiple.
-        handler(ec, sequence, height, tx_hash);
+        handler(ec, key, sequence, height, tx_hash);
+        release_subscriptions(reader);
     };
 
-    // This handler locks subscription_handlers_ while running to avoid
+    // This handler locks subscriptions_ while running to avoid
     // (un)subscription handler state from changing while running (called from
     // process_response).
     auto unsubscribe_handler = [this](const std::string&, uint32_t id,
@@ -781,12 +1614,23 @@ void obelisk_client::attach_handlers()
         while (!source.is_exhausted())
             hashes.push_back(source.read_hash());
 
+        // A truncated hash invalidates the source.
+        if (!source)
+        {
+            handler->second(error::bad_stream, {});
+            hash_list_handlers_.erase(handler);
+            return;
+        }
+
         handler->second(ec, hashes);
         hash_list_handlers_.erase(handler);
     };
 
+    // Each family of pending request handlers is registered with the
+    // commands that it serves, so that it is expired and replayed.
 #define REGISTER_HANDLER(command, handler) \
-    command_handlers_[command] = handler
+    command_handlers_[command] = handler; \
+    command_families_[command] = register_family(#handler, handler##s_)
 
     REGISTER_HANDLER("transaction_pool.broadcast", result_handler);
     REGISTER_HANDLER("transaction_pool.validate2", result_handler);
@@ -808,9 +1652,9 @@ void obelisk_client::attach_handlers()
         transaction_index_handler);
     REGISTER_HANDLER("blockchain.fetch_history4", history_handler);
     REGISTER_HANDLER("blockchain.fetch_block_transaction_hashes", hash_list_handler);
-    REGISTER_HANDLER("subscribe.key", notification_handler);
-    REGISTER_HANDLER("notification.key", notification_handler);
-    REGISTER_HANDLER("unsubscribe.key", unsubscribe_handler);
+    command_handlers_["subscribe.key"] = notification_handler;
+    command_handlers_["notification.key"] = notification_handler;
+    command_handlers_["unsubscribe.key"] = unsubscribe_handler;
     REGISTER_HANDLER("server.version", version_handler);
 
 #undef REGISTER_HANDLER
@@ -819,6 +1663,8 @@ void obelisk_client::attach_handlers()
 void obelisk_client::handle_immediate(const std::string& command, uint32_t id,
     const code& ec)
 {
+    cache_pending_.erase(id);
+
     auto command_handler = command_handlers_.find(command);
     if (command_handler == command_handlers_.end())
         return;
@@ -835,19 +1681,11 @@ bool obelisk_client::requests_outstanding()
 {
     // We have requests outstanding if any of the handler maps are not
     // empty, except update/notification handlers.
-    return
-        !result_handlers_.empty() ||
-        !height_handlers_.empty() ||
-        !transaction_index_handlers_.empty() ||
-        !block_handlers_.empty() ||
-        !block_header_handlers_.empty() ||
-        !transaction_handlers_.empty() ||
-        !hash_list_handlers_.empty() ||
-        !history_handlers_.empty() ||
-        !version_handlers_.empty() ||
-        !compact_filter_handlers_.empty() ||
-        !compact_filter_checkpoint_handlers_.empty() ||
-        !compact_filter_headers_handlers_.empty();
+    for (const auto& family: pending_families_)
+        if (family.size() != 0)
+            return true;
+
+    return false;
 }
 
 // We have subscribe requests outstanding if the subscription handler map is not
@@ -857,37 +1695,29 @@ bool obelisk_client::subscribe_requests_outstanding()
     // Critical Section.
     ///////////////////////////////////////////////////////////////////////////
     system::unique_lock lock(subscription_lock_);
-    return !subscription_handlers_.empty() || !unsubscription_handlers_.empty();
+    return !subscriptions_.load()->empty() ||
+        !unsubscription_handlers_.empty();
     ///////////////////////////////////////////////////////////////////////////
 }
 
 void obelisk_client::clear_outstanding_requests(const code& ec)
 {
-#define INVOKE_HANDLER_0 handler.second(ec)
-#define INVOKE_HANDLER_1 handler.second(ec, {})
-#define INVOKE_HANDLER_2 handler.second(ec, {}, {})
-
-#define CLEAR_OUTSTANDING(handlers, ec, handler_version) \
-    for (auto& handler: handlers) \
-        INVOKE_HANDLER_##handler_version; \
-    handlers.clear()
+    // Requests and responses of expired handlers are no longer needed.
+    cache_pending_.clear();
+    cached_responses_.clear();
+    played_responses_.clear();
+    batch_queue_.clear();
+    batches_.clear();
 
     // Clear the handler maps, but first fire the handlers with the
     // specified error.
-    CLEAR_OUTSTANDING(result_handlers_, ec, 0);
-    CLEAR_OUTSTANDING(height_handlers_, ec, 1);
-    CLEAR_OUTSTANDING(transaction_index_handlers_, ec, 2);
-    CLEAR_OUTSTANDING(block_handlers_, ec, 1);
-    CLEAR_OUTSTANDING(block_header_handlers_, ec, 1);
-    CLEAR_OUTSTANDING(transaction_handlers_, ec, 1);
-    CLEAR_OUTSTANDING(hash_list_handlers_, ec, 1);
-    CLEAR_OUTSTANDING(history_handlers_, ec, 1);
-    CLEAR_OUTSTANDING(version_handlers_, ec, 1);
-
-#undef CLEAR_OUTSTANDING
-#undef INVOKE_HANDLER_0
-#undef INVOKE_HANDLER_1
-#undef INVOKE_HANDLER_2
+    for (const auto& family: pending_families_)
+    {
+        if (ec == error::channel_timeout)
+            timeouts_[family.name] += family.size();
+
+        family.expire(ec);
+    }
 }
 
 void obelisk_client::clear_outstanding_subscribe_requests(const code& ec)
@@ -895,17 +1725,111 @@ void obelisk_client::clear_outstanding_subscribe_requests(const code& ec)
     // Critical Section.
     ///////////////////////////////////////////////////////////////////////////
     system::unique_lock lock(subscription_lock_);
+    size_t reader;
+    const auto& subscriptions = acquire_subscriptions(reader);
+    publish({});
+
+    // Positions are retained for saving and for resubscription of the key.
+    for (size_t slot = 0; slot < subscriptions.size(); ++slot)
+    {
+        const auto& key = subscriptions.key(slot);
+        ended_subscriptions_[key] =
+        {
+            key, subscriptions.sequence(slot), subscriptions.height(slot)
+        };
+    }
 
-    for (auto& it: subscription_handlers_)
-        it.second.first(ec, {}, {}, {});
+    for (size_t slot = 0; slot < subscriptions.size(); ++slot)
+        subscriptions.get_handler(slot)(ec, subscriptions.key(slot), {}, {},
+            {});
     for (auto& it: unsubscription_handlers_)
         it.second.first(ec);
 
-    subscription_handlers_.clear();
     unsubscription_handlers_.clear();
+    release_subscriptions(reader);
+    reclaim_subscriptions();
     ///////////////////////////////////////////////////////////////////////////
 }
 
+// Negotiation.
+//-----------------------------------------------------------------------------
+
+// Minimum server version of commands introduced after v3.0.
+static const std::unordered_map<std::string, std::pair<uint32_t, uint32_t>>
+    command_versions
+{
+    { "transaction_pool.fetch_transaction2", { 3, 4 } },
+    { "blockchain.fetch_transaction2", { 3, 4 } },
+    { "blockchain.fetch_history4", { 4, 0 } },
+    { "blockchain.fetch_compact_filter", { 4, 0 } },
+    { "blockchain.fetch_compact_filter_checkpoint", { 4, 0 } },
+    { "blockchain.fetch_compact_filter_headers", { 4, 0 } },
+    { "subscribe.key", { 4, 0 } },
+    { "unsubscribe.key", { 4, 0 } }
+};
+
+bool obelisk_client::negotiate(uint32_t timeout_milliseconds)
+{
+    code result(error::channel_timeout);
+    std::string version;
+
+    auto handler = [&result, &version](const code& ec,
+        const std::string& value)
+    {
+        result = ec;
+        version = value;
+    };
+
+    negotiated_ = false;
+    capabilities_ = {};
+    server_version(handler);
+    wait(timeout_milliseconds);
+
+    if (result)
+        return false;
+
+    // The version is formatted as [v]major.minor[.patch][-suffix].
+    uint32_t major;
+    uint32_t minor;
+    char separator;
+    std::istringstream stream(version);
+    if (stream.peek() == 'v')
+        stream.ignore();
+
+    stream >> major >> separator >> minor;
+    if (!stream || separator != '.')
+        return false;
+
+    const auto release = std::make_pair(major, minor);
+    capabilities_ =
+    {
+        version,
+        major,
+        minor,
+        release >= std::make_pair(3u, 4u),
+        release >= std::make_pair(4u, 0u)
+    };
+
+    negotiated_ = true;
+    return true;
+}
+
+const obelisk_client::capabilities& obelisk_client::server_capabilities() const
+{
+    return capabilities_;
+}
+
+bool obelisk_client::supported(const std::string& command) const
+{
+    if (!negotiated_)
+        return true;
+
+    const auto minimum = command_versions.find(command);
+    return minimum == command_versions.end() ||
+        std::make_pair(capabilities_.major, capabilities_.minor) >=
+            minimum->second;
+}
+
 // Fetchers.
 //-----------------------------------------------------------------------------
 
@@ -915,30 +1839,43 @@ void obelisk_client::server_version(version_handler handler)
     static const data_chunk empty{};
     const auto id = ++last_request_index_;
     version_handlers_[id] = handler;
-    if (!send_request(command, id, empty))
-        handle_immediate(command, id, error::network_unreachable);
+    send_request(command, id, empty);
 }
 
-// This will fail if a witness tx is sent to a < v3.4 (pre-witness) server.
+// This will fail if a witness tx is sent to a < v3.4 (pre-witness) server,
+// immediately if the server version has been negotiated.
 void obelisk_client::transaction_pool_broadcast(result_handler handler,
     const chain::transaction& tx)
 {
     static const std::string command = "transaction_pool.broadcast";
     const auto id = ++last_request_index_;
     result_handlers_[id] = handler;
-    if (!send_request(command, id, tx.to_data(true, true)))
-        handle_immediate(command, id, error::network_unreachable);
+
+    if (negotiated_ && !capabilities_.witness && tx.is_segregated())
+    {
+        handle_immediate(command, id, error::operation_failed);
+        return;
+    }
+
+    send_request(command, id, tx.to_data(true, true));
 }
 
-// This will fail if a witness tx is sent to a < v3.4 (pre-witness) server.
+// This will fail if a witness tx is sent to a < v3.4 (pre-witness) server,
+// immediately if the server version has been negotiated.
 void obelisk_client::transaction_pool_validate2(result_handler handler,
     const chain::transaction& tx)
 {
     static const std::string command = "transaction_pool.validate2";
     const auto id = ++last_request_index_;
     result_handlers_[id] = handler;
-    if (!send_request(command, id, tx.to_data(true, true)))
-        handle_immediate(command, id, error::network_unreachable);
+
+    if (negotiated_ && !capabilities_.witness && tx.is_segregated())
+    {
+        handle_immediate(command, id, error::operation_failed);
+        return;
+    }
+
+    send_request(command, id, tx.to_data(true, true));
 }
 
 void obelisk_client::transaction_pool_fetch_transaction(
@@ -947,9 +1884,8 @@ void obelisk_client::transaction_pool_fetch_transaction(
     static const std::string command = "transaction_pool.fetch_transaction";
     const auto data = build_chunk({ tx_hash });
     const auto id = ++last_request_index_;
-    transaction_handlers_[id] = handler;
-    if (!send_request(command, id, data))
-        handle_immediate(command, id, error::network_unreachable);
+    transaction_handlers_[id] = verified(handler, tx_hash);
+    send_request(command, id, data);
 }
 
 void obelisk_client::transaction_pool_fetch_transaction2(
@@ -958,9 +1894,8 @@ void obelisk_client::transaction_pool_fetch_transaction2(
     static const std::string command = "transaction_pool.fetch_transaction2";
     const auto data = build_chunk({ tx_hash });
     const auto id = ++last_request_index_;
-    transaction_handlers_[id] = handler;
-    if (!send_request(command, id, data))
-        handle_immediate(command, id, error::network_unreachable);
+    transaction_handlers_[id] = verified(handler, tx_hash);
+    send_request(command, id, data);
 }
 
 void obelisk_client::blockchain_broadcast(result_handler handler,
@@ -969,8 +1904,7 @@ void obelisk_client::blockchain_broadcast(result_handler handler,
     static const std::string command = "blockchain.broadcast";
     const auto id = ++last_request_index_;
     result_handlers_[id] = handler;
-    if (!send_request(command, id, block.to_data()))
-        handle_immediate(command, id, error::network_unreachable);
+    send_request(command, id, block.to_data());
 }
 
 void obelisk_client::blockchain_validate(result_handler handler,
@@ -979,8 +1913,7 @@ void obelisk_client::blockchain_validate(result_handler handler,
     static const std::string command = "blockchain.validate";
     const auto id = ++last_request_index_;
     result_handlers_[id] = handler;
-    if (!send_request(command, id, block.to_data()))
-        handle_immediate(command, id, error::network_unreachable);
+    send_request(command, id, block.to_data());
 }
 
 void obelisk_client::blockchain_fetch_transaction(
@@ -989,9 +1922,8 @@ void obelisk_client::blockchain_fetch_transaction(
     static const std::string command = "blockchain.fetch_transaction";
     const auto data = build_chunk({ tx_hash });
     const auto id = ++last_request_index_;
-    transaction_handlers_[id] = handler;
-    if (!send_request(command, id, data))
-        handle_immediate(command, id, error::network_unreachable);
+    transaction_handlers_[id] = verified(admitted(handler, id), tx_hash);
+    send_request(command, id, data);
 }
 
 void obelisk_client::blockchain_fetch_transaction2(
@@ -1000,9 +1932,26 @@ void obelisk_client::blockchain_fetch_transaction2(
     static const std::string command = "blockchain.fetch_transaction2";
     const auto data = build_chunk({ tx_hash });
     const auto id = ++last_request_index_;
-    transaction_handlers_[id] = handler;
-    if (!send_request(command, id, data))
-        handle_immediate(command, id, error::network_unreachable);
+    transaction_handlers_[id] = verified(admitted(handler, id), tx_hash);
+    send_request(command, id, data);
+}
+
+void obelisk_client::blockchain_fetch_best_transaction(
+    transaction_handler handler, const hash_digest& tx_hash)
+{
+    if (capabilities_.witness)
+        blockchain_fetch_transaction2(handler, tx_hash);
+    else
+        blockchain_fetch_transaction(handler, tx_hash);
+}
+
+void obelisk_client::transaction_pool_fetch_best_transaction(
+    transaction_handler handler, const hash_digest& tx_hash)
+{
+    if (capabilities_.witness)
+        transaction_pool_fetch_transaction2(handler, tx_hash);
+    else
+        transaction_pool_fetch_transaction(handler, tx_hash);
 }
 
 void obelisk_client::blockchain_fetch_last_height(height_handler handler)
@@ -1011,8 +1960,7 @@ void obelisk_client::blockchain_fetch_last_height(height_handler handler)
     const data_chunk data{};
     const auto id = ++last_request_index_;
     height_handlers_[id] = handler;
-    if (!send_request(command, id, data))
-        handle_immediate(command, id, error::network_unreachable);
+    send_request(command, id, data);
 }
 
 void obelisk_client::blockchain_fetch_block(block_handler handler,
@@ -1021,9 +1969,8 @@ void obelisk_client::blockchain_fetch_block(block_handler handler,
     static const std::string command = "blockchain.fetch_block";
     const auto data = build_chunk({ to_little_endian<uint32_t>(height) });
     const auto id = ++last_request_index_;
-    block_handlers_[id] = handler;
-    if (!send_request(command, id, data))
-        handle_immediate(command, id, error::network_unreachable);
+    block_handlers_[id] = verified(admitted(handler, id));
+    send_request(command, id, data);
 }
 
 void obelisk_client::blockchain_fetch_block(block_handler handler,
@@ -1032,9 +1979,8 @@ void obelisk_client::blockchain_fetch_block(block_handler handler,
     static const std::string command = "blockchain.fetch_block";
     const auto data = build_chunk({ block_hash });
     const auto id = ++last_request_index_;
-    block_handlers_[id] = handler;
-    if (!send_request(command, id, data))
-        handle_immediate(command, id, error::network_unreachable);
+    block_handlers_[id] = verified(admitted(handler, id), block_hash);
+    send_request(command, id, data);
 }
 
 void obelisk_client::blockchain_fetch_block_header(
@@ -1043,9 +1989,8 @@ void obelisk_client::blockchain_fetch_block_header(
     static const std::string command = "blockchain.fetch_block_header";
     const auto data = build_chunk({ to_little_endian<uint32_t>(height) });
     const auto id = ++last_request_index_;
-    block_header_handlers_[id] = handler;
-    if (!send_request(command, id, data))
-        handle_immediate(command, id, error::network_unreachable);
+    block_header_handlers_[id] = admitted(handler, id);
+    send_request(command, id, data);
 }
 
 void obelisk_client::blockchain_fetch_block_header(block_header_handler handler,
@@ -1054,9 +1999,8 @@ void obelisk_client::blockchain_fetch_block_header(block_header_handler handler,
     static const std::string command = "blockchain.fetch_block_header";
     const auto data = build_chunk({ block_hash });
     const auto id = ++last_request_index_;
-    block_header_handlers_[id] = handler;
-    if (!send_request(command, id, data))
-        handle_immediate(command, id, error::network_unreachable);
+    block_header_handlers_[id] = verified(admitted(handler, id), block_hash);
+    send_request(command, id, data);
 }
 
 void obelisk_client::blockchain_fetch_transaction_index(
@@ -1066,8 +2010,7 @@ void obelisk_client::blockchain_fetch_transaction_index(
     const auto data = build_chunk({ tx_hash });
     const auto id = ++last_request_index_;
     transaction_index_handlers_[id] = handler;
-    if (!send_request(command, id, data))
-        handle_immediate(command, id, error::network_unreachable);
+    send_request(command, id, data);
 }
 
 // blockchain.fetch_history4 (v4.0) request accepts key instead of
@@ -1088,8 +2031,21 @@ void obelisk_client::blockchain_fetch_history4(history_handler handler,
 
     const auto id = ++last_request_index_;
     history_handlers_[id] = handler;
-    if (!send_request(command, id, data))
-        handle_immediate(command, id, error::network_unreachable);
+    send_request(command, id, data);
+}
+
+void obelisk_client::blockchain_fetch_history4(key_history_handler handler,
+    const hash_list& keys, uint32_t from_height)
+{
+    for (const auto& key: keys)
+    {
+        auto keyed = [handler, key](const code& ec, const history::list& rows)
+        {
+            handler(ec, key, rows);
+        };
+
+        blockchain_fetch_history4(keyed, key, from_height);
+    }
 }
 
 void obelisk_client::blockchain_fetch_unspent_outputs(
@@ -1123,8 +2079,7 @@ void obelisk_client::blockchain_fetch_unspent_outputs(
 
     const auto id = ++last_request_index_;
     history_handlers_[id] = select_from_history;
-    if (!send_request(command, id, data))
-        handle_immediate(command, id, error::network_unreachable);
+    send_request(command, id, data);
 }
 
 void obelisk_client::blockchain_fetch_block_height(height_handler handler,
@@ -1134,8 +2089,7 @@ void obelisk_client::blockchain_fetch_block_height(height_handler handler,
     const auto data = build_chunk({ block_hash });
     const auto id = ++last_request_index_;
     height_handlers_[id] = handler;
-    if (!send_request(command, id, data))
-        handle_immediate(command, id, error::network_unreachable);
+    send_request(command, id, data);
 }
 
 void obelisk_client::blockchain_fetch_block_transaction_hashes(
@@ -1144,9 +2098,8 @@ void obelisk_client::blockchain_fetch_block_transaction_hashes(
     static const std::string command = "blockchain.fetch_block_transaction_hashes";
     const auto data = build_chunk({ to_little_endian<uint32_t>(height) });
     const auto id = ++last_request_index_;
-    hash_list_handlers_[id] = handler;
-    if (!send_request(command, id, data))
-        handle_immediate(command, id, error::network_unreachable);
+    hash_list_handlers_[id] = admitted(handler, id);
+    send_request(command, id, data);
 }
 
 void obelisk_client::blockchain_fetch_block_transaction_hashes(
@@ -1155,9 +2108,8 @@ void obelisk_client::blockchain_fetch_block_transaction_hashes(
     static const std::string command = "blockchain.fetch_block_transaction_hashes";
     const auto data = build_chunk({ block_hash });
     const auto id = ++last_request_index_;
-    hash_list_handlers_[id] = handler;
-    if (!send_request(command, id, data))
-        handle_immediate(command, id, error::network_unreachable);
+    hash_list_handlers_[id] = admitted(handler, id);
+    send_request(command, id, data);
 }
 
 void obelisk_client::blockchain_fetch_compact_filter(
@@ -1170,9 +2122,8 @@ void obelisk_client::blockchain_fetch_compact_filter(
     });
 
     const auto id = ++last_request_index_;
-    compact_filter_handlers_[id] = handler;
-    if (!send_request(command, id, data))
-        handle_immediate(command, id, error::network_unreachable);
+    compact_filter_handlers_[id] = admitted(handler, id);
+    send_request(command, id, data);
 }
 
 void obelisk_client::blockchain_fetch_compact_filter(
@@ -1186,9 +2137,8 @@ void obelisk_client::blockchain_fetch_compact_filter(
     });
 
     const auto id = ++last_request_index_;
-    compact_filter_handlers_[id] = handler;
-    if (!send_request(command, id, data))
-        handle_immediate(command, id, error::network_unreachable);
+    compact_filter_handlers_[id] = admitted(handler, id);
+    send_request(command, id, data);
 }
 
 void obelisk_client::blockchain_fetch_compact_filter_headers(
@@ -1203,9 +2153,8 @@ void obelisk_client::blockchain_fetch_compact_filter_headers(
     });
 
     const auto id = ++last_request_index_;
-    compact_filter_headers_handlers_[id] = handler;
-    if (!send_request(command, id, data))
-        handle_immediate(command, id, error::network_unreachable);
+    compact_filter_headers_handlers_[id] = admitted(handler, id);
+    send_request(command, id, data);
 }
 
 void obelisk_client::blockchain_fetch_compact_filter_headers(
@@ -1220,9 +2169,8 @@ void obelisk_client::blockchain_fetch_compact_filter_headers(
     });
 
     const auto id = ++last_request_index_;
-    compact_filter_headers_handlers_[id] = handler;
-    if (!send_request(command, id, data))
-        handle_immediate(command, id, error::network_unreachable);
+    compact_filter_headers_handlers_[id] = admitted(handler, id);
+    send_request(command, id, data);
 }
 
 void obelisk_client::blockchain_fetch_compact_filter_checkpoint(
@@ -1236,9 +2184,8 @@ void obelisk_client::blockchain_fetch_compact_filter_checkpoint(
     });
 
     const auto id = ++last_request_index_;
-    compact_filter_checkpoint_handlers_[id] = handler;
-    if (!send_request(command, id, data))
-        handle_immediate(command, id, error::network_unreachable);
+    compact_filter_checkpoint_handlers_[id] = admitted(handler, id);
+    send_request(command, id, data);
 }
 
 //void obelisk_client::blockchain_fetch_compact_filter_checkpoint(
@@ -1253,8 +2200,7 @@ void obelisk_client::blockchain_fetch_compact_filter_checkpoint(
 //
 //    const auto id = ++last_request_index_;
 //    compact_filter_checkpoint_handlers_[id] = handler;
-//    if (!send_request(command, id, data))
-//        handle_immediate(command, id, error::network_unreachable);
+//    send_request(command, id, data);
 //}
 
 // Subscribers.
@@ -1263,27 +2209,249 @@ void obelisk_client::blockchain_fetch_compact_filter_checkpoint(
 // subscribe.address is renamed to subscribe.key (v4.0), input key differs.
 uint32_t obelisk_client::subscribe_key(update_handler handler,
     const hash_digest& key)
+{
+    auto keyless = [handler](const code& ec, const hash_digest&,
+        uint16_t sequence, size_t height, const hash_digest& tx_hash)
+    {
+        handler(ec, sequence, height, tx_hash);
+    };
+
+    const auto id = subscribe(keyless, { key }).front();
+
+    if (id != null_subscription)
+        handler(error::success, {}, {}, {});
+
+    return id;
+}
+
+// The handler is registered once and shared by the subscriptions.
+std::vector<uint32_t> obelisk_client::subscribe_keys(
+    key_update_handler handler, const hash_list& keys)
+{
+    const auto subscriptions = subscribe(handler, keys);
+
+    for (size_t index = 0; index < keys.size(); ++index)
+        if (subscriptions[index] != null_subscription)
+            handler(error::success, keys[index], {}, {}, {});
+
+    return subscriptions;
+}
+
+// The subscriptions are published together, before any request is sent.
+std::vector<uint32_t> obelisk_client::subscribe(
+    subscription_table::handler handler, const hash_list& keys)
 {
     static const std::string command = "subscribe.key";
-    // [ key:32 ]
-    const auto data = build_chunk({ key });
+    std::vector<uint32_t> ids;
+    ids.reserve(keys.size());
 
     // Critical Section.
     ///////////////////////////////////////////////////////////////////////////
     subscription_lock_.lock();
-    const auto id = ++last_request_index_;
-    subscription_handlers_[id] = { handler, data };
+    auto subscriptions = *subscriptions_.load();
+    const auto registered = subscriptions.register_handler(std::move(handler));
+
+    for (const auto& key: keys)
+    {
+        ids.push_back(++last_request_index_);
+
+        // A resubscribed key continues from the position at which it ended.
+        const auto ended = ended_subscriptions_.find(key);
+        if (ended == ended_subscriptions_.end())
+        {
+            subscriptions.add(ids.back(), key, registered);
+            continue;
+        }
+
+        subscriptions.add(ids.back(), key, registered,
+            ended->second.sequence, ended->second.height);
+        ended_subscriptions_.erase(ended);
+    }
+
+    subscriptions.release_handler(registered);
+    publish(std::move(subscriptions));
     subscription_lock_.unlock();
     ///////////////////////////////////////////////////////////////////////////
 
-    if (!send_request(command, id, data, true))
+    for (size_t index = 0; index < keys.size(); ++index)
     {
-        handle_immediate(command, id, error::network_unreachable);
-        return null_subscription;
+        // [ key:32 ]
+        const auto data = build_chunk({ keys[index] });
+
+        if (!send_request(command, ids[index], data, true))
+            ids[index] = null_subscription;
     }
 
-    handler(error::success, {}, {}, {});
-    return id;
+    return ids;
+}
+
+void obelisk_client::publish(subscription_table&& subscriptions)
+{
+    auto positions = subscriptions.release_positions();
+    const auto replaced = subscriptions_.exchange(
+        new subscription_table(std::move(subscriptions)));
+
+    // The replaced table may be read only by readers of an earlier epoch.
+    const auto epoch = subscription_epoch_++;
+    retired_subscriptions_.push_back(
+    {
+        std::unique_ptr<const subscription_table>(replaced), epoch,
+        std::move(positions)
+    });
+
+    reclaim_subscriptions();
+}
+
+const subscription_table& obelisk_client::acquire_subscriptions(
+    size_t& reader)
+{
+    // Threads start at different slots, so that readers on different threads
+    // do not contend for a cache line.
+    const auto start = std::hash<std::thread::id>()(
+        std::this_thread::get_id());
+
+    for (size_t probe = 0;; ++probe)
+    {
+        reader = (start + probe) % subscription_reader_slots;
+        auto& epoch = subscription_readers_[reader].epoch;
+        uint64_t idle = 0;
+
+        // The epoch is announced before the pointer is read, so a table
+        // replaced after the announcement is not deleted until released.
+        if (epoch.load() == idle &&
+            epoch.compare_exchange_strong(idle, subscription_epoch_.load()))
+            return *subscriptions_.load();
+
+        // More readers than slots wait for a slot to be released.
+        if (probe % subscription_reader_slots ==
+            subscription_reader_slots - 1)
+            std::this_thread::yield();
+    }
+}
+
+void obelisk_client::release_subscriptions(size_t reader)
+{
+    subscription_readers_[reader].epoch.store(0);
+}
+
+void obelisk_client::reclaim_subscriptions()
+{
+    auto oldest = max_uint64;
+    for (size_t reader = 0; reader < subscription_reader_slots; ++reader)
+    {
+        const auto epoch = subscription_readers_[reader].epoch.load();
+        if (epoch != 0)
+            oldest = std::min(oldest, epoch);
+    }
+
+    // A reader announced after this scan reads the published table, which is
+    // never retired while published. Tables are retired in epoch order.
+    while (!retired_subscriptions_.empty() &&
+        retired_subscriptions_.front().epoch < oldest)
+    {
+        // No copy from before the removal of the positions remains in use.
+        auto& retired = retired_subscriptions_.front();
+        retired.table->recycle_positions(retired.positions);
+        retired_subscriptions_.pop_front();
+    }
+}
+
+bool obelisk_client::remove_subscription(uint32_t id)
+{
+    return remove_subscriptions({ id }) != 0;
+}
+
+size_t obelisk_client::remove_subscriptions(const std::vector<uint32_t>& ids)
+{
+    // Critical Section.
+    ///////////////////////////////////////////////////////////////////////////
+    system::unique_lock lock(subscription_lock_);
+    const auto current = subscriptions_.load();
+    const auto found = std::count_if(ids.begin(), ids.end(),
+        [current](uint32_t id)
+        {
+            return current->find(id) != subscription_table::not_found;
+        });
+
+    if (found == 0)
+        return 0;
+
+    auto subscriptions = *current;
+    for (const auto id: ids)
+        subscriptions.remove(id);
+
+    publish(std::move(subscriptions));
+    return static_cast<size_t>(found);
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+// Durable state.
+//-----------------------------------------------------------------------------
+
+void obelisk_client::save_subscriptions(client_state& state)
+{
+    state.subscriptions.clear();
+
+    // Critical Section.
+    ///////////////////////////////////////////////////////////////////////////
+    subscription_lock_.lock_shared();
+    const auto& subscriptions = *subscriptions_.load();
+    state.subscriptions.reserve(subscriptions.size() +
+        ended_subscriptions_.size());
+
+    for (size_t slot = 0; slot < subscriptions.size(); ++slot)
+        state.subscriptions.push_back(
+        {
+            subscriptions.key(slot),
+            subscriptions.sequence(slot),
+            subscriptions.height(slot)
+        });
+
+    for (const auto& ended: ended_subscriptions_)
+        state.subscriptions.push_back(ended.second);
+
+    subscription_lock_.unlock_shared();
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+std::vector<uint32_t> obelisk_client::restore_subscriptions(
+    const client_state& state, key_update_handler on_update,
+    key_history_handler on_history)
+{
+    hash_list keys;
+    keys.reserve(state.subscriptions.size());
+
+    for (const auto& entry: state.subscriptions)
+        keys.push_back(entry.key);
+
+    const auto subscriptions = subscribe_keys(on_update, keys);
+    size_t reader;
+    const auto& table = acquire_subscriptions(reader);
+
+    for (size_t index = 0; index < subscriptions.size(); ++index)
+    {
+        const auto slot = table.find(subscriptions[index]);
+        if (slot != subscription_table::not_found)
+            table.set_position(slot, state.subscriptions[index].sequence,
+                state.subscriptions[index].height);
+    }
+
+    release_subscriptions(reader);
+
+    for (const auto& entry: state.subscriptions)
+    {
+        // Only the delta from the last notified height is fetched.
+        const auto key = entry.key;
+        auto keyed = [on_history, key](const code& ec,
+            const history::list& rows)
+        {
+            on_history(ec, key, rows);
+        };
+
+        blockchain_fetch_history4(keyed, key, entry.height);
+    }
+
+    return subscriptions;
 }
 
 // unsubscribe.address is renamed to unsubscribe.key (v4.0), input key differs.
@@ -1296,50 +2464,68 @@ bool obelisk_client::unsubscribe_key(result_handler handler,
 
     // Critical Section.
     ///////////////////////////////////////////////////////////////////////////
-    subscription_lock_.lock_upgrade();
-    auto it = subscription_handlers_.find(subscription);
-    if (it == subscription_handlers_.end())
+    subscription_lock_.lock();
+    const auto subscriptions = subscriptions_.load();
+    const auto slot = subscriptions->find(subscription);
+    if (slot == subscription_table::not_found)
     {
-        subscription_lock_.unlock_upgrade();
+        subscription_lock_.unlock();
         return false;
     }
 
-    subscription_lock_.unlock_upgrade_and_lock();
     const auto id = ++last_request_index_;
     unsubscription_handlers_[id] = { handler, subscription };
-    data = it->second.second;
+    data = build_chunk({ subscriptions->key(slot) });
     subscription_lock_.unlock();
     ///////////////////////////////////////////////////////////////////////////
 
-    if (!send_request(command, id, data, true))
-    {
-        handle_immediate(command, id, error::network_unreachable);
-        return false;
-    }
-
-    return true;
+    return send_request(command, id, data, true);
 }
 
-// Must be called with subscription_lock_ locked (called from
-// unsubscription_handler).
-bool obelisk_client::terminate_unsubscriber(uint32_t subscription)
+// The subscriptions are removed together, before any request is sent.
+size_t obelisk_client::unsubscribe_keys(result_handler handler,
+    const std::vector<uint32_t>& subscriptions)
 {
+    static const std::string command = "unsubscribe.key";
+    std::vector<std::pair<uint32_t, data_chunk>> requests;
+    requests.reserve(subscriptions.size());
+
     // Critical Section.
     ///////////////////////////////////////////////////////////////////////////
-    subscription_lock_.lock_upgrade();
-    auto it = subscription_handlers_.find(subscription);
-    if (it == subscription_handlers_.end())
+    subscription_lock_.lock();
+    auto table = *subscriptions_.load();
+
+    for (const auto subscription: subscriptions)
     {
-        subscription_lock_.unlock_upgrade();
-        return false;
+        const auto slot = table.find(subscription);
+        if (slot == subscription_table::not_found)
+            continue;
+
+        // Already removed, so the acknowledgement terminates nothing.
+        const auto id = ++last_request_index_;
+        unsubscription_handlers_[id] = { handler, null_subscription };
+        requests.push_back({ id, build_chunk({ table.key(slot) }) });
+        table.remove(subscription);
     }
 
-    subscription_lock_.unlock_upgrade_and_lock();
-    subscription_handlers_.erase(it);
+    if (!requests.empty())
+        publish(std::move(table));
+
     subscription_lock_.unlock();
     ///////////////////////////////////////////////////////////////////////////
 
-    return true;
+    size_t sent = 0;
+    for (const auto& request: requests)
+        if (send_request(command, request.first, request.second, true))
+            ++sent;
+
+    return sent;
+}
+
+// Called from unsubscription_handler.
+bool obelisk_client::terminate_unsubscriber(uint32_t subscription)
+{
+    return remove_subscription(subscription);
 }
 
 
@@ -0,0 +1,58 @@
+/**
+ * Copyright (c) 2011-2019 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/client/script_keys.hpp>
+
+#include <bitcoin/client/hash_batch.hpp>
+
+using namespace bc::system;
+using namespace bc::system::chain;
+using namespace bc::system::wallet;
+
+namespace libbitcoin {
+namespace client {
+
+hash_digest script_key(const script& script)
+{
+    return sha256_hash(script.to_data(false));
+}
+
+hash_list script_keys(const script::list& scripts)
+{
+    data_stack serialized;
+    serialized.reserve(scripts.size());
+
+    for (const auto& script: scripts)
+        serialized.push_back(script.to_data(false));
+
+    return sha256_hash_batch(serialized);
+}
+
+hash_list address_keys(const payment_address::list& addresses)
+{
+    data_stack serialized;
+    serialized.reserve(addresses.size());
+
+    for (const auto& address: addresses)
+        serialized.push_back(address.output_script().to_data(false));
+
+    return sha256_hash_batch(serialized);
+}
+
+} // namespace client
+} // namespace libbitcoin
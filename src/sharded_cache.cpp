@@ -0,0 +1,175 @@
+/**
+ * Copyright (c) 2011-2019 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/client/sharded_cache.hpp>
+
+#include <algorithm>
+
+using namespace bc::system;
+
+namespace libbitcoin {
+namespace client {
+
+const size_t sharded_cache::default_shards = 64;
+
+static size_t round_up_power_of_two(size_t value)
+{
+    size_t power = 1;
+    while (power < value)
+        power <<= 1;
+
+    return power;
+}
+
+sharded_cache::sharded_cache(size_t capacity_bytes, size_t shards)
+  : shard_capacity_(capacity_bytes / round_up_power_of_two(shards)),
+    shards_(round_up_power_of_two(shards))
+{
+    for (auto& shard: shards_)
+    {
+        shard.reset(new sharded_cache::shard);
+        shard->hand = 0;
+        shard->size = 0;
+    }
+}
+
+sharded_cache::shard& sharded_cache::get_shard(const hash_digest& key)
+{
+    // Keys are hashes, so their leading bytes are uniformly distributed.
+    const auto stripe = from_little_endian_unsafe<uint32_t>(key.begin());
+    return *shards_[stripe & (shards_.size() - 1)];
+}
+
+bool sharded_cache::fetch(const hash_digest& key, data_chunk& payload)
+{
+    auto& shard = get_shard(key);
+    payload_ptr shared;
+
+    // Critical Section.
+    ///////////////////////////////////////////////////////////////////////////
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        const auto it = shard.index.find(key);
+        if (it == shard.index.end())
+            return false;
+
+        auto& slot = shard.slots[it->second];
+        slot.referenced = true;
+        shared = slot.payload;
+    }
+    ///////////////////////////////////////////////////////////////////////////
+
+    payload = *shared;
+    return true;
+}
+
+void sharded_cache::store(const hash_digest& key, const data_chunk& payload)
+{
+    if (payload.size() > shard_capacity_)
+        return;
+
+    auto& shard = get_shard(key);
+
+    // Allocate outside of the lock.
+    const auto shared = std::make_shared<const data_chunk>(payload);
+
+    // Critical Section.
+    ///////////////////////////////////////////////////////////////////////////
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (shard.index.find(key) != shard.index.end())
+        return;
+
+    evict(shard, payload.size());
+
+    size_t position;
+    if (shard.free.empty())
+    {
+        position = shard.slots.size();
+        shard.slots.push_back({ key, shared, false });
+    }
+    else
+    {
+        position = shard.free.back();
+        shard.free.pop_back();
+        shard.slots[position] = { key, shared, false };
+    }
+
+    shard.index.emplace(key, position);
+    shard.size += payload.size();
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+void sharded_cache::evict(shard& shard, size_t payload_size)
+{
+    // Referenced slots get a second chance as the hand passes them.
+    while (!shard.index.empty() && shard.size + payload_size > shard_capacity_)
+    {
+        auto& slot = shard.slots[shard.hand];
+        const auto position = shard.hand;
+        shard.hand = (shard.hand + 1) % shard.slots.size();
+
+        if (!slot.payload)
+            continue;
+
+        if (slot.referenced)
+        {
+            slot.referenced = false;
+            continue;
+        }
+
+        shard.size -= slot.payload->size();
+        shard.index.erase(slot.key);
+        slot.payload.reset();
+        shard.free.push_back(position);
+    }
+}
+
+void sharded_cache::clear()
+{
+    for (auto& shard: shards_)
+    {
+        // Critical Section.
+        ///////////////////////////////////////////////////////////////////////
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        shard->slots.clear();
+        shard->free.clear();
+        shard->index.clear();
+        shard->hand = 0;
+        shard->size = 0;
+        ///////////////////////////////////////////////////////////////////////
+    }
+}
+
+size_t sharded_cache::size() const
+{
+    size_t total = 0;
+
+    for (const auto& shard: shards_)
+    {
+        // Critical Section.
+        ///////////////////////////////////////////////////////////////////////
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        total += shard->size;
+        ///////////////////////////////////////////////////////////////////////
+    }
+
+    return total;
+}
+
+} // namespace client
+} // namespace libbitcoin
@@ -0,0 +1,495 @@
+/**
+ * Copyright (c) 2011-2019 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/client/subscription_table.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <iterator>
+#include <memory>
+#include <utility>
+
+using namespace bc::system;
+
+namespace libbitcoin {
+namespace client {
+
+const size_t subscription_table::not_found;
+
+// The id that marks an empty index entry, never used as a request id.
+static constexpr uint32_t empty_id = max_uint32;
+
+// The handler that marks the end of the free list.
+static constexpr uint32_t no_handler = max_uint32;
+
+// Table chunk sizes, powers of two. The index is at least one chunk.
+static constexpr size_t slot_chunk_size = 256;
+static constexpr size_t registry_chunk_size = 256;
+static constexpr size_t index_chunk_size = 1024;
+
+// Position chunk c holds first_chunk << c positions from index
+// first_chunk * (2^c - 1), so that the chunks address all position indexes.
+static constexpr size_t first_chunk = 64;
+static constexpr size_t chunk_count = 27;
+
+// A position is packed as [ sequence:16 | height:32 ] for atomic update.
+static uint64_t pack(uint16_t sequence, uint32_t height)
+{
+    return (static_cast<uint64_t>(sequence) << 32) | height;
+}
+
+static uint32_t unpack_height(uint64_t position)
+{
+    return static_cast<uint32_t>(position);
+}
+
+static size_t chunk_of(uint32_t index)
+{
+    const auto ordinal = index / first_chunk + 1;
+    size_t chunk = 0;
+    while ((ordinal >> (chunk + 1)) != 0)
+        ++chunk;
+
+    return chunk;
+}
+
+static size_t chunk_start(size_t chunk)
+{
+    return first_chunk * ((size_t(1) << chunk) - 1);
+}
+
+// A chunk shared with another table is copied before it is written, and
+// only the writing thread holds a reference that it may copy, so a count of
+// one is never stale.
+template <typename Chunk>
+static Chunk& writable(std::shared_ptr<Chunk>& chunk)
+{
+    if (chunk.use_count() > 1)
+        chunk = std::make_shared<Chunk>(*chunk);
+
+    return *chunk;
+}
+
+// Chunks are allocated as the array grows and never move, so that positions
+// may be read through one copy of the table while another adds to the array.
+struct subscription_table::position_array
+{
+    typedef std::atomic<uint64_t> position;
+
+    position& at(uint32_t index) const
+    {
+        const auto chunk = chunk_of(index);
+        return chunks[chunk][index - chunk_start(chunk)];
+    }
+
+    uint32_t allocate()
+    {
+        if (!reusable.empty())
+        {
+            const auto index = reusable.back();
+            reusable.pop_back();
+            return index;
+        }
+
+        const auto index = size++;
+        const auto chunk = chunk_of(index);
+        if (index == chunk_start(chunk))
+            chunks[chunk].reset(new position[first_chunk << chunk]);
+
+        return index;
+    }
+
+    std::unique_ptr<position[]> chunks[chunk_count];
+    uint32_t size = 0;
+
+    // Indexes free for reuse, and those removed but not yet released.
+    position_list reusable;
+    position_list released;
+};
+
+struct subscription_table::slot_chunk
+{
+    uint32_t ids[slot_chunk_size];
+    hash_digest keys[slot_chunk_size];
+    uint32_t handlers[slot_chunk_size];
+    uint32_t positions[slot_chunk_size];
+};
+
+struct subscription_table::registry_chunk
+{
+    registered entries[registry_chunk_size];
+};
+
+struct subscription_table::index_chunk
+{
+    index_chunk()
+    {
+        std::fill(std::begin(entries), std::end(entries),
+            index_entry{ empty_id, 0 });
+    }
+
+    index_entry entries[index_chunk_size];
+};
+
+subscription_table::subscription_table()
+  : size_(0),
+    shared_positions_(std::make_shared<position_array>()),
+    registry_size_(0),
+    free_handler_(no_handler),
+    index_{ std::make_shared<index_chunk>() }
+{
+}
+
+uint32_t subscription_table::register_handler(handler handler)
+{
+    // Copies of the table share the handler.
+    const registered value
+    {
+        std::make_shared<subscription_table::handler>(std::move(handler)), 1,
+        no_handler
+    };
+
+    if (free_handler_ == no_handler)
+    {
+        if (registry_size_ % registry_chunk_size == 0)
+            registry_.push_back(std::make_shared<registry_chunk>());
+
+        const auto index = registry_size_++;
+        write_entry(index) = value;
+        return index;
+    }
+
+    const auto index = free_handler_;
+    auto& reused = write_entry(index);
+    free_handler_ = reused.next_free;
+    reused = value;
+    return index;
+}
+
+void subscription_table::release_handler(uint32_t handler)
+{
+    release(handler);
+}
+
+bool subscription_table::add(uint32_t id, const hash_digest& key,
+    uint32_t handler, uint16_t sequence, uint32_t height)
+{
+    if (id == empty_id || find(id) != not_found)
+        return false;
+
+    reserve_index(size_ + 1);
+
+    auto position = bucket(id);
+    while (index(position).id != empty_id)
+        position = (position + 1) & (index_size() - 1);
+
+    write_index(position) = { id, static_cast<uint32_t>(size_) };
+
+    if (size_ % slot_chunk_size == 0)
+        slots_.push_back(std::make_shared<slot_chunk>());
+
+    const auto offset = size_ % slot_chunk_size;
+    auto& chunk = write_slots(size_++);
+    chunk.ids[offset] = id;
+    chunk.keys[offset] = key;
+    chunk.handlers[offset] = handler;
+    chunk.positions[offset] = shared_positions_->allocate();
+    shared_positions_->at(chunk.positions[offset]).store(
+        pack(sequence, height));
+
+    ++write_entry(handler).references;
+    return true;
+}
+
+bool subscription_table::remove(uint32_t id)
+{
+    const auto position = locate(id);
+    if (position == not_found)
+        return false;
+
+    const size_t slot = index(position).slot;
+    const auto offset = slot % slot_chunk_size;
+    const auto handler = slots(slot).handlers[offset];
+    shared_positions_->released.push_back(slots(slot).positions[offset]);
+    erase_index(position);
+
+    // The last slot fills the hole, keeping the arrays dense.
+    const auto last = size_ - 1;
+    if (slot != last)
+    {
+        const auto& from = slots(last);
+        const auto from_offset = last % slot_chunk_size;
+        const auto moved = from.ids[from_offset];
+        const auto moved_key = from.keys[from_offset];
+        const auto moved_handler = from.handlers[from_offset];
+        const auto moved_position = from.positions[from_offset];
+
+        auto& to = write_slots(slot);
+        to.ids[offset] = moved;
+        to.keys[offset] = moved_key;
+        to.handlers[offset] = moved_handler;
+        to.positions[offset] = moved_position;
+        write_index(locate(moved)).slot = static_cast<uint32_t>(slot);
+    }
+
+    // A chunk emptied by the removal is dropped.
+    if (--size_ % slot_chunk_size == 0)
+        slots_.pop_back();
+
+    release(handler);
+    return true;
+}
+
+size_t subscription_table::find(uint32_t id) const
+{
+    const auto position = locate(id);
+    return position == not_found ? not_found : index(position).slot;
+}
+
+uint32_t subscription_table::id(size_t slot) const
+{
+    return slots(slot).ids[slot % slot_chunk_size];
+}
+
+const hash_digest& subscription_table::key(size_t slot) const
+{
+    return slots(slot).keys[slot % slot_chunk_size];
+}
+
+const subscription_table::handler& subscription_table::get_handler(
+    size_t slot) const
+{
+    return *entry(slots(slot).handlers[slot % slot_chunk_size]).value;
+}
+
+uint16_t subscription_table::sequence(size_t slot) const
+{
+    return static_cast<uint16_t>(position(slot).load() >> 32);
+}
+
+uint32_t subscription_table::height(size_t slot) const
+{
+    return unpack_height(position(slot).load());
+}
+
+void subscription_table::set_position(size_t slot, uint16_t sequence,
+    uint32_t height) const
+{
+    position(slot).store(pack(sequence, height));
+}
+
+void subscription_table::update_position(size_t slot, uint16_t sequence,
+    uint32_t height) const
+{
+    auto& value = position(slot);
+    auto current = value.load();
+
+    // Concurrent notifications of the slot may not lower the height.
+    while (!value.compare_exchange_weak(current,
+        pack(sequence, std::max(unpack_height(current), height))));
+}
+
+subscription_table::position_list
+    subscription_table::release_positions() const
+{
+    position_list positions;
+    positions.swap(shared_positions_->released);
+    return positions;
+}
+
+void subscription_table::recycle_positions(
+    const position_list& positions) const
+{
+    auto& reusable = shared_positions_->reusable;
+    reusable.insert(reusable.end(), positions.begin(), positions.end());
+}
+
+size_t subscription_table::size() const
+{
+    return size_;
+}
+
+bool subscription_table::empty() const
+{
+    return size_ == 0;
+}
+
+void subscription_table::clear()
+{
+    // Handlers held by callers remain registered.
+    auto& released = shared_positions_->released;
+    for (size_t slot = 0; slot < size_; ++slot)
+    {
+        const auto offset = slot % slot_chunk_size;
+        release(slots(slot).handlers[offset]);
+        released.push_back(slots(slot).positions[offset]);
+    }
+
+    size_ = 0;
+    slots_.clear();
+    index_.assign(1, std::make_shared<index_chunk>());
+}
+
+// Private.
+//-----------------------------------------------------------------------------
+
+const subscription_table::slot_chunk& subscription_table::slots(
+    size_t slot) const
+{
+    return *slots_[slot / slot_chunk_size];
+}
+
+const subscription_table::registered& subscription_table::entry(
+    uint32_t handler) const
+{
+    return registry_[handler / registry_chunk_size]->entries[
+        handler % registry_chunk_size];
+}
+
+const subscription_table::index_entry& subscription_table::index(
+    size_t position) const
+{
+    return index_[position / index_chunk_size]->entries[
+        position % index_chunk_size];
+}
+
+subscription_table::slot_chunk& subscription_table::write_slots(size_t slot)
+{
+    return writable(slots_[slot / slot_chunk_size]);
+}
+
+subscription_table::registered& subscription_table::write_entry(
+    uint32_t handler)
+{
+    return writable(registry_[handler / registry_chunk_size]).entries[
+        handler % registry_chunk_size];
+}
+
+subscription_table::index_entry& subscription_table::write_index(
+    size_t position)
+{
+    return writable(index_[position / index_chunk_size]).entries[
+        position % index_chunk_size];
+}
+
+size_t subscription_table::index_size() const
+{
+    return index_.size() * index_chunk_size;
+}
+
+size_t subscription_table::bucket(uint32_t id) const
+{
+    // Fibonacci hashing spreads sequential ids.
+    return static_cast<uint32_t>(id * 2654435769u) & (index_size() - 1);
+}
+
+size_t subscription_table::locate(uint32_t id) const
+{
+    if (id == empty_id)
+        return not_found;
+
+    for (auto position = bucket(id); index(position).id != empty_id;
+        position = (position + 1) & (index_size() - 1))
+        if (index(position).id == id)
+            return position;
+
+    return not_found;
+}
+
+void subscription_table::reserve_index(size_t count)
+{
+    // The index is kept at most half full.
+    if (count * 2 <= index_size())
+        return;
+
+    auto size = index_size();
+    while (count * 2 > size)
+        size *= 2;
+
+    // The entries are rehashed into new chunks, which are not shared.
+    std::vector<std::shared_ptr<index_chunk>> entries;
+    entries.reserve(size / index_chunk_size);
+    for (size_t chunk = 0; chunk < size / index_chunk_size; ++chunk)
+        entries.push_back(std::make_shared<index_chunk>());
+
+    index_.swap(entries);
+
+    for (const auto& chunk: entries)
+    {
+        for (const auto& moved: chunk->entries)
+        {
+            if (moved.id == empty_id)
+                continue;
+
+            auto position = bucket(moved.id);
+            while (index(position).id != empty_id)
+                position = (position + 1) & (size - 1);
+
+            write_index(position) = moved;
+        }
+    }
+}
+
+void subscription_table::erase_index(size_t position)
+{
+    const auto mask = index_size() - 1;
+    write_index(position).id = empty_id;
+
+    // Shift back entries of the probe sequence to close the hole.
+    for (auto next = (position + 1) & mask; index(next).id != empty_id;
+        next = (next + 1) & mask)
+    {
+        const auto home = bucket(index(next).id);
+
+        // The entry moves unless its home lies cyclically in (hole, next].
+        const auto stays = position <= next ?
+            (position < home && home <= next) :
+            (position < home || home <= next);
+
+        if (stays)
+            continue;
+
+        write_index(position) = index(next);
+        write_index(next).id = empty_id;
+        position = next;
+    }
+}
+
+std::atomic<uint64_t>& subscription_table::position(size_t slot) const
+{
+    return shared_positions_->at(slots(slot).positions[
+        slot % slot_chunk_size]);
+}
+
+void subscription_table::release(uint32_t handler)
+{
+    if (entry(handler).references != 1)
+    {
+        --write_entry(handler).references;
+        return;
+    }
+
+    auto& released = write_entry(handler);
+    released.value.reset();
+    released.references = 0;
+    released.next_free = free_handler_;
+    free_handler_ = handler;
+}
+
+} // namespace client
+} // namespace libbitcoin
@@ -0,0 +1,143 @@
+/**
+ * Copyright (c) 2011-2019 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/client/traffic_recorder.hpp>
+
+#include <iterator>
+
+using namespace bc::system;
+using namespace std::chrono;
+
+namespace libbitcoin {
+namespace client {
+
+const uint32_t traffic_recorder::version = 1;
+
+// Record.
+// ----------------------------------------------------------------------------
+
+bool traffic_record::from_data(istream_reader& source, size_t& remaining)
+{
+    // Sizes are checked against the remaining bytes before allocation.
+    const auto consume = [&remaining](size_t bytes)
+    {
+        if (bytes > remaining)
+            return false;
+
+        remaining -= bytes;
+        return true;
+    };
+
+    response = source.read_byte() != 0;
+    timestamp = source.read_variable_little_endian();
+    const auto command_size = source.read_size_little_endian();
+
+    if (!source || !consume(1u + variable_uint_size(timestamp) +
+        variable_uint_size(command_size)) || !consume(command_size))
+        return false;
+
+    const auto text = source.read_bytes(command_size);
+    command.assign(text.begin(), text.end());
+    id = source.read_4_bytes_little_endian();
+    const auto payload_size = source.read_size_little_endian();
+
+    if (!source || !consume(sizeof(uint32_t) +
+        variable_uint_size(payload_size)) || !consume(payload_size))
+        return false;
+
+    payload = source.read_bytes(payload_size);
+    return source;
+}
+
+void traffic_record::to_data(ostream_writer& sink) const
+{
+    sink.write_byte(response ? 1 : 0);
+    sink.write_variable_little_endian(timestamp);
+    sink.write_string(command);
+    sink.write_4_bytes_little_endian(id);
+    sink.write_size_little_endian(payload.size());
+    sink.write_bytes(payload);
+}
+
+// Recorder.
+// ----------------------------------------------------------------------------
+
+traffic_recorder::traffic_recorder(std::ostream& stream)
+  : stream_(stream),
+    sink_(stream),
+    start_(steady_clock::now())
+{
+    sink_.write_4_bytes_little_endian(version);
+}
+
+void traffic_recorder::record(bool response, const std::string& command,
+    uint32_t id, const data_chunk& payload)
+{
+    const auto elapsed = steady_clock::now() - start_;
+    const traffic_record record
+    {
+        response,
+        static_cast<uint64_t>(duration_cast<microseconds>(elapsed).count()),
+        command,
+        id,
+        payload
+    };
+
+    // Critical Section.
+    ///////////////////////////////////////////////////////////////////////////
+    std::lock_guard<std::mutex> lock(mutex_);
+    record.to_data(sink_);
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+void traffic_recorder::flush()
+{
+    // Critical Section.
+    ///////////////////////////////////////////////////////////////////////////
+    std::lock_guard<std::mutex> lock(mutex_);
+    stream_.flush();
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+bool traffic_recorder::load(std::istream& stream, traffic_record::list& out)
+{
+    const data_chunk log((std::istreambuf_iterator<char>(stream)),
+        std::istreambuf_iterator<char>());
+
+    data_source istream(log);
+    istream_reader source(istream);
+    if (source.read_4_bytes_little_endian() != version || !source)
+        return false;
+
+    out.clear();
+    traffic_record record;
+    auto remaining = log.size() - sizeof(uint32_t);
+
+    while (remaining != 0)
+    {
+        if (!record.from_data(source, remaining))
+            return false;
+
+        out.push_back(std::move(record));
+    }
+
+    return true;
+}
+
+} // namespace client
+} // namespace libbitcoin
@@ -0,0 +1,158 @@
+/**
+ * Copyright (c) 2011-2019 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/client/verification.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <bitcoin/client/hash_batch.hpp>
+
+using namespace bc::system;
+using namespace bc::system::chain;
+
+namespace libbitcoin {
+namespace client {
+
+// Offsets of the fields within a serialized header.
+static constexpr size_t previous_offset = 4;
+static constexpr size_t bits_offset = 72;
+
+hash_list transaction_hashes(const transaction::list& transactions)
+{
+    data_stack messages;
+    messages.reserve(transactions.size());
+
+    for (const auto& tx: transactions)
+        messages.push_back(tx.to_data(true, false));
+
+    return bitcoin_hash_batch(messages);
+}
+
+hash_list header_hashes(const header_buffer& headers)
+{
+    return bitcoin_hash_batch(headers.data(), headers.size(),
+        header_buffer::record_size);
+}
+
+hash_digest merkle_root(const hash_list& hashes)
+{
+    if (hashes.empty())
+        return null_hash;
+
+    auto level = hashes;
+    data_chunk pairs;
+
+    while (level.size() > 1)
+    {
+        // An odd level is completed by pairing its last hash with itself.
+        if (level.size() % 2 != 0)
+            level.push_back(level.back());
+
+        pairs.resize(level.size() * hash_size);
+        for (size_t index = 0; index < level.size(); ++index)
+            std::copy(level[index].begin(), level[index].end(),
+                pairs.begin() + index * hash_size);
+
+        level = bitcoin_hash_batch(pairs.data(), level.size() / 2,
+            2 * hash_size);
+    }
+
+    return level.front();
+}
+
+bool verify_proof_of_work(uint32_t bits, const hash_digest& hash)
+{
+    const auto exponent = static_cast<int>(bits >> 24);
+    const auto mantissa = bits & 0x007fffff;
+
+    // A negative target is invalid.
+    if (mantissa != 0 && (bits & 0x00800000) != 0)
+        return false;
+
+    // Expand the compact target to big endian bytes, rejecting overflow.
+    hash_digest target{};
+    for (int byte = 0; byte < 3; ++byte)
+    {
+        const auto value = static_cast<uint8_t>(mantissa >> (8 * (2 - byte)));
+        const auto position = exponent - 1 - byte;
+
+        if (value == 0 || position < 0)
+            continue;
+
+        if (position >= static_cast<int>(hash_size))
+            return false;
+
+        target[hash_size - 1 - position] = value;
+    }
+
+    if (target == null_hash)
+        return false;
+
+    // The hash is a little endian number, compare from the most significant.
+    for (size_t index = 0; index < hash_size; ++index)
+    {
+        const auto value = hash[hash_size - 1 - index];
+        if (value != target[index])
+            return value < target[index];
+    }
+
+    return true;
+}
+
+static uint32_t read_bits(const uint8_t* record)
+{
+    const auto bits = record + bits_offset;
+    return
+        (static_cast<uint32_t>(bits[0])) |
+        (static_cast<uint32_t>(bits[1]) << 8) |
+        (static_cast<uint32_t>(bits[2]) << 16) |
+        (static_cast<uint32_t>(bits[3]) << 24);
+}
+
+bool verify_header_chain(hash_list& out_hashes, const header_buffer& headers,
+    const hash_digest& previous_hash)
+{
+    out_hashes = header_hashes(headers);
+
+    for (size_t index = 0; index < headers.size(); ++index)
+    {
+        const auto record = headers.data() + index * header_buffer::record_size;
+        const auto& previous = index == 0 ? previous_hash :
+            out_hashes[index - 1];
+
+        if (!std::equal(previous.begin(), previous.end(),
+            record + previous_offset))
+            return false;
+
+        if (!verify_proof_of_work(read_bits(record), out_hashes[index]))
+            return false;
+    }
+
+    return true;
+}
+
+bool verify_merkle_root(const block& block)
+{
+    const auto& transactions = block.transactions();
+    return !transactions.empty() && merkle_root(
+        transaction_hashes(transactions)) == block.header().merkle_root();
+}
+
+} // namespace client
+} // namespace libbitcoin
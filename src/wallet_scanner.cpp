@@ -0,0 +1,139 @@
+/**
+ * Copyright (c) 2011-2019 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/client/wallet_scanner.hpp>
+
+#include <algorithm>
+#include <vector>
+#include <bitcoin/client/script_keys.hpp>
+
+using namespace bc::system;
+using namespace bc::system::wallet;
+
+namespace libbitcoin {
+namespace client {
+
+const wallet_scanner::settings wallet_scanner::default_settings
+{
+    20,
+    100,
+    payment_address::mainnet_p2kh,
+    30000
+};
+
+wallet_scanner::wallet_scanner(obelisk_client& client,
+    const hd_public& chain_key, const settings& settings)
+  : client_(client),
+    chain_key_(chain_key),
+    settings_(settings)
+{
+}
+
+payment_address wallet_scanner::derive_address(uint32_t index) const
+{
+    const ec_public point(chain_key_.derive_public(index).point());
+    return { point, settings_.address_version };
+}
+
+code wallet_scanner::scan(checkpoint& position, found_handler on_found,
+    progress_handler on_progress)
+{
+    if (!chain_key_ || settings_.concurrency == 0)
+        return error::operation_failed;
+
+    struct query
+    {
+        uint32_t index;
+        hash_digest key;
+        code ec;
+        history::list rows;
+    };
+
+    std::vector<query> round;
+    round.reserve(settings_.concurrency);
+
+    // The window is extended by the gap limit beyond each used index.
+    auto horizon = [&]()
+    {
+        return position.used_count + settings_.gap_limit;
+    };
+
+    while (position.next_index < horizon() &&
+        position.next_index < hd_first_hardened_key)
+    {
+        const auto end = std::min({ horizon(), hd_first_hardened_key,
+            position.next_index + settings_.concurrency });
+
+        payment_address::list addresses;
+        addresses.reserve(end - position.next_index);
+        for (auto index = position.next_index; index < end; ++index)
+            addresses.push_back(derive_address(index));
+
+        // Script hashing for the round is batched.
+        const auto keys = address_keys(addresses);
+
+        round.clear();
+        for (auto index = position.next_index; index < end; ++index)
+            round.push_back({ index, keys[index - position.next_index],
+                error::success, {} });
+
+        // The round is fully allocated, so handlers may retain references.
+        for (auto& entry: round)
+        {
+            auto handler = [&entry](const code& ec, const history::list& rows)
+            {
+                entry.ec = ec;
+                entry.rows = rows;
+            };
+
+            client_.blockchain_fetch_history4(handler, entry.key,
+                position.from_height);
+        }
+
+        // Queries are pipelined over the connection and resolved together.
+        client_.wait(settings_.timeout_milliseconds);
+
+        for (const auto& entry: round)
+        {
+            if (entry.ec)
+            {
+                position.next_index = entry.index;
+                return entry.ec;
+            }
+
+            if (entry.rows.empty())
+                continue;
+
+            position.used_count = std::max(position.used_count,
+                entry.index + 1u);
+
+            if (on_found)
+                on_found(entry.index, entry.key, entry.rows);
+        }
+
+        position.next_index = end;
+
+        if (on_progress)
+            on_progress(position);
+    }
+
+    return error::success;
+}
+
+} // namespace client
+} // namespace libbitcoin
@@ -0,0 +1,360 @@
+/**
+ * Copyright (c) 2011-2019 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/client/watch_wallet.hpp>
+
+#include <algorithm>
+#include <thread>
+#include <bitcoin/client/script_keys.hpp>
+
+using namespace bc::system;
+using namespace bc::system::chain;
+using namespace bc::system::wallet;
+
+namespace libbitcoin {
+namespace client {
+
+const watch_wallet::settings watch_wallet::default_settings
+{
+    20,
+    payment_address::mainnet_p2kh,
+    0,
+    100,
+    30000
+};
+
+hash_list watch_wallet::derive_keys(const hd_public& chain_key,
+    uint32_t first, uint32_t count, uint8_t address_version,
+    uint32_t threads)
+{
+    if (threads == 0)
+        threads = std::max(std::thread::hardware_concurrency(), 1u);
+
+    // Each thread derives a contiguous range of the preallocated addresses.
+    payment_address::list addresses(count);
+    const auto workers = std::max(std::min(threads, count), 1u);
+    const auto span = (count + workers - 1) / workers;
+
+    const auto derive = [&](uint32_t begin, uint32_t end)
+    {
+        for (auto index = begin; index < end; ++index)
+        {
+            const ec_public point(
+                chain_key.derive_public(first + index).point());
+            addresses[index] = { point, address_version };
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (uint32_t begin = span; begin < count; begin += span)
+        pool.emplace_back(derive, begin, std::min(begin + span, count));
+
+    derive(0, std::min(span, count));
+
+    for (auto& thread: pool)
+        thread.join();
+
+    // Script hashing is batched.
+    return address_keys(addresses);
+}
+
+watch_wallet::watch_wallet(obelisk_client& client,
+    const hd_public& account_key, const settings& settings)
+  : client_(client),
+    settings_(settings),
+    chains_
+    {
+        { account_key.derive_public(receive_chain), {}, {}, 0 },
+        { account_key.derive_public(change_chain), {}, {}, 0 }
+    },
+    pending_(std::make_shared<std::unordered_set<hash_digest>>()),
+    ended_(std::make_shared<std::unordered_set<hash_digest>>()),
+    balance_(0)
+{
+}
+
+watch_wallet::~watch_wallet()
+{
+    const auto ignore = [](const code&) {};
+
+    // Each chain is removed from the client's subscriptions at once.
+    for (const auto& chain: chains_)
+        client_.unsubscribe_keys(ignore, chain.subscriptions);
+}
+
+code watch_wallet::load()
+{
+    if (!chains_[receive_chain].key || settings_.concurrency == 0)
+        return error::operation_failed;
+
+    return synchronize();
+}
+
+code watch_wallet::refresh()
+{
+    return synchronize();
+}
+
+size_t watch_wallet::pending() const
+{
+    return pending_->size();
+}
+
+bool watch_wallet::stale() const
+{
+    return !ended_->empty();
+}
+
+uint32_t watch_wallet::derived_count(uint32_t chain) const
+{
+    return static_cast<uint32_t>(chains_[chain].keys.size());
+}
+
+uint32_t watch_wallet::used_count(uint32_t chain) const
+{
+    return chains_[chain].used_count;
+}
+
+const hash_digest& watch_wallet::key(uint32_t chain, uint32_t index) const
+{
+    return chains_[chain].keys[index];
+}
+
+uint64_t watch_wallet::balance() const
+{
+    return balance_;
+}
+
+watch_wallet::unspent_list watch_wallet::unspent_outputs() const
+{
+    unspent_list outputs;
+    outputs.reserve(unspent_.size());
+
+    for (const auto& entry: unspent_)
+        outputs.push_back(entry.second);
+
+    return outputs;
+}
+
+void watch_wallet::extend(uint32_t chain, uint32_t count)
+{
+    auto& state = chains_[chain];
+    const auto first = static_cast<uint32_t>(state.keys.size());
+    count = std::min(count, hd_first_hardened_key);
+
+    if (count <= first)
+        return;
+
+    const auto keys = derive_keys(state.key, first, count - first,
+        settings_.address_version, settings_.threads);
+
+    for (size_t offset = 0; offset < keys.size(); ++offset)
+    {
+        const auto index = first + static_cast<uint32_t>(offset);
+        locations_[keys[offset]] = { chain, index };
+
+        // New keys are fetched once subscribed, so no update is missed.
+        pending_->insert(keys[offset]);
+    }
+
+    const auto subscriptions = subscribe(keys);
+    state.subscriptions.insert(state.subscriptions.end(),
+        subscriptions.begin(), subscriptions.end());
+    state.keys.insert(state.keys.end(), keys.begin(), keys.end());
+}
+
+std::vector<uint32_t> watch_wallet::subscribe(const hash_list& keys)
+{
+    // The handler retains the shared sets, not the wallet. Subscription
+    // acknowledgements carry no transaction hash and are ignored.
+    const auto pending = pending_;
+    const auto ended = ended_;
+    auto handler = [pending, ended](const code& ec, const hash_digest& key,
+        uint16_t, size_t, const hash_digest& tx_hash)
+    {
+        // Any error ends the subscription, as when monitor returns.
+        if (ec)
+            ended->insert(key);
+        else if (tx_hash != null_hash)
+            pending->insert(key);
+    };
+
+    const auto subscriptions = client_.subscribe_keys(handler, keys);
+
+    // A subscription that could not be requested is retried as if ended.
+    for (size_t index = 0; index < keys.size(); ++index)
+        if (subscriptions[index] == obelisk_client::null_subscription)
+            ended_->insert(keys[index]);
+
+    return subscriptions;
+}
+
+void watch_wallet::resubscribe()
+{
+    if (ended_->empty())
+        return;
+
+    const hash_list keys(ended_->begin(), ended_->end());
+    ended_->clear();
+
+    const auto subscriptions = subscribe(keys);
+
+    // Notifications may have been missed while ended, so each is refetched.
+    for (size_t index = 0; index < keys.size(); ++index)
+    {
+        const auto& location = locations_[keys[index]];
+        chains_[location.chain].subscriptions[location.index] =
+            subscriptions[index];
+
+        pending_->insert(keys[index]);
+    }
+}
+
+code watch_wallet::synchronize()
+{
+    // A chain short of its gap is extended by at least a full round of
+    // queries, so that a used key at the end of the window does not cost a
+    // round for each gap limit of keys.
+    const auto lookahead = std::max(settings_.gap_limit, settings_.concurrency);
+
+    resubscribe();
+
+    while (true)
+    {
+        for (uint32_t chain = receive_chain; chain <= change_chain; ++chain)
+        {
+            const auto derived = derived_count(chain);
+            const auto required = chains_[chain].used_count +
+                settings_.gap_limit;
+
+            if (derived < required)
+                extend(chain, std::max(required, derived + lookahead));
+        }
+
+        if (pending_->empty())
+            return error::success;
+
+        const hash_list keys(pending_->begin(), pending_->end());
+        const auto ec = fetch(keys);
+        if (ec)
+            return ec;
+    }
+}
+
+code watch_wallet::fetch(const hash_list& keys)
+{
+    struct query
+    {
+        hash_digest key;
+        code ec;
+        history::list rows;
+    };
+
+    std::vector<query> round;
+    round.reserve(settings_.concurrency);
+
+    for (size_t next = 0; next < keys.size();)
+    {
+        const auto end = std::min(keys.size(), next + settings_.concurrency);
+
+        round.clear();
+        for (auto index = next; index < end; ++index)
+            round.push_back({ keys[index], error::success, {} });
+
+        // The round is fully allocated, so handlers may retain references.
+        for (auto& entry: round)
+        {
+            auto handler = [&entry](const code& ec, const history::list& rows)
+            {
+                entry.ec = ec;
+                entry.rows = rows;
+            };
+
+            // Keys notified from here on are fetched again.
+            pending_->erase(entry.key);
+            client_.blockchain_fetch_history4(handler, entry.key, 0);
+        }
+
+        // Queries are pipelined over the connection and resolved together.
+        client_.wait(settings_.timeout_milliseconds);
+
+        code result(error::success);
+        for (const auto& entry: round)
+        {
+            if (entry.ec)
+            {
+                // Failed keys remain pending for the next refresh.
+                pending_->insert(entry.key);
+                if (!result)
+                    result = entry.ec;
+
+                continue;
+            }
+
+            apply(entry.key, entry.rows);
+        }
+
+        if (result)
+            return result;
+
+        next = end;
+    }
+
+    return error::success;
+}
+
+void watch_wallet::apply(const hash_digest& key, const history::list& rows)
+{
+    auto& points = key_unspent_[key];
+
+    for (const auto& point: points)
+    {
+        const auto it = unspent_.find(point);
+        balance_ -= it->second.value;
+        unspent_.erase(it);
+    }
+
+    points.clear();
+
+    for (const auto& row: rows)
+    {
+        if (row.output.is_null() || !row.spend.is_null())
+            continue;
+
+        const chain::point point(row.output.hash(), row.output.index());
+        if (unspent_.emplace(point, unspent{ row.output, row.value,
+            row.output_height, key }).second)
+        {
+            balance_ += row.value;
+            points.push_back(point);
+        }
+    }
+
+    if (points.empty())
+        key_unspent_.erase(key);
+
+    if (rows.empty())
+        return;
+
+    const auto& location = locations_[key];
+    auto& used_count = chains_[location.chain].used_count;
+    used_count = std::max(used_count, location.index + 1u);
+}
+
+} // namespace client
+} // namespace libbitcoin
@@ -0,0 +1,81 @@
+/**
+ * Copyright (c) 2011-2019 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cstdint>
+#include <boost/test/test_tools.hpp>
+#include <boost/test/unit_test_suite.hpp>
+#include <bitcoin/client.hpp>
+
+using namespace bc::client;
+using namespace bc::system;
+
+static const char test_key[] = "2ef44127d8b0e66eb991f79a8da10e901fc07a82d69a9cfc1ea6e53ae1c66465";
+
+BOOST_AUTO_TEST_SUITE(offline)
+
+BOOST_AUTO_TEST_CASE(client_state__constructor__default__empty)
+{
+    const client_state state;
+    BOOST_REQUIRE_EQUAL(state.tip_height, 0u);
+    BOOST_REQUIRE(state.tip_headers.empty());
+    BOOST_REQUIRE(state.watermarks.empty());
+    BOOST_REQUIRE(state.subscriptions.empty());
+}
+
+BOOST_AUTO_TEST_CASE(client_state__from_data__round_trip__expected)
+{
+    client_state expected;
+    expected.tip_height = 800001;
+    expected.tip_headers.push_back(chain::header{});
+    expected.watermarks["scan"] = 799000;
+    expected.subscriptions.push_back({ hash_literal(test_key), 42, 800000 });
+
+    client_state state;
+    BOOST_REQUIRE(state.from_data(expected.to_data()));
+    BOOST_REQUIRE_EQUAL(state.tip_height, expected.tip_height);
+    BOOST_REQUIRE_EQUAL(state.tip_headers.size(), 1u);
+    BOOST_REQUIRE_EQUAL(state.watermarks["scan"], 799000u);
+    BOOST_REQUIRE_EQUAL(state.subscriptions.size(), 1u);
+    BOOST_REQUIRE(state.subscriptions.front().key == hash_literal(test_key));
+    BOOST_REQUIRE_EQUAL(state.subscriptions.front().sequence, 42u);
+    BOOST_REQUIRE_EQUAL(state.subscriptions.front().height, 800000u);
+}
+
+BOOST_AUTO_TEST_CASE(client_state__from_data__truncated__false_and_reset)
+{
+    client_state expected;
+    expected.subscriptions.push_back({ hash_literal(test_key), 1, 2 });
+    auto data = expected.to_data();
+    data.resize(data.size() - 1);
+
+    client_state state;
+    BOOST_REQUIRE(!state.from_data(data));
+    BOOST_REQUIRE(state.subscriptions.empty());
+}
+
+BOOST_AUTO_TEST_CASE(client_state__from_data__other_version__false)
+{
+    client_state expected;
+    auto data = expected.to_data();
+    data[0] = static_cast<uint8_t>(client_state::version + 1);
+
+    client_state state;
+    BOOST_REQUIRE(!state.from_data(data));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,131 @@
+/**
+ * Copyright (c) 2011-2019 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cstdint>
+#include <boost/test/test_tools.hpp>
+#include <boost/test/unit_test_suite.hpp>
+#include <bitcoin/client.hpp>
+
+using namespace bc::client;
+using namespace bc::system;
+using namespace bc::system::chain;
+
+// The transaction whose outputs the wallet spends.
+static const auto wallet_hash = sha256_hash(data_chunk{ 7 });
+
+// A spend of the wallet output, distinct spends of it differ by locktime.
+static transaction spend_wallet(uint32_t index, uint32_t locktime=0)
+{
+    return
+    {
+        1, locktime,
+        { input(output_point(wallet_hash, index), script(), max_uint32) },
+        { output(1000, script()) }
+    };
+}
+
+BOOST_AUTO_TEST_SUITE(offline)
+
+BOOST_AUTO_TEST_CASE(conflict_detector__check__double_spend__flagged)
+{
+    size_t notified = 0;
+    conflict_detector detector([&](const conflict_detector::conflict&)
+    {
+        ++notified;
+    });
+
+    const auto ours = spend_wallet(0);
+    const auto theirs = spend_wallet(0, 1);
+
+    BOOST_REQUIRE(detector.watch(ours));
+    BOOST_REQUIRE(!detector.watch(ours));
+    BOOST_REQUIRE(detector.check(ours).empty());
+    BOOST_REQUIRE(detector.check(spend_wallet(1)).empty());
+
+    const auto conflicts = detector.check(theirs);
+    BOOST_REQUIRE_EQUAL(conflicts.size(), 1u);
+    BOOST_REQUIRE(conflicts.front().outpoint == point(wallet_hash, 0));
+    BOOST_REQUIRE(conflicts.front().watched == ours.hash());
+    BOOST_REQUIRE(conflicts.front().spender == theirs.hash());
+    BOOST_REQUIRE(!conflicts.front().confirmed);
+    BOOST_REQUIRE_EQUAL(notified, 1u);
+}
+
+BOOST_AUTO_TEST_CASE(conflict_detector__check__mirrored_notification__flagged)
+{
+    conflict_detector detector(nullptr);
+    mempool_mirror mirror;
+    const auto theirs = spend_wallet(0, 1);
+
+    BOOST_REQUIRE(detector.watch(spend_wallet(0)));
+
+    conflict_detector::list conflicts;
+    BOOST_REQUIRE(!detector.check(conflicts, theirs.hash(), mirror));
+
+    BOOST_REQUIRE(mirror.store(theirs));
+    BOOST_REQUIRE(detector.check(conflicts, theirs.hash(), mirror));
+    BOOST_REQUIRE_EQUAL(conflicts.size(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(conflict_detector__confirm__block__unwatches_and_flags)
+{
+    conflict_detector detector(nullptr);
+    const auto confirmed = spend_wallet(0);
+    const auto ours = spend_wallet(1);
+    const auto theirs = spend_wallet(1, 1);
+
+    BOOST_REQUIRE(detector.watch(confirmed));
+    BOOST_REQUIRE(detector.watch(ours));
+
+    const auto conflicts = detector.confirm(block(header(),
+        { confirmed, theirs }));
+
+    BOOST_REQUIRE_EQUAL(conflicts.size(), 1u);
+    BOOST_REQUIRE(conflicts.front().confirmed);
+    BOOST_REQUIRE(conflicts.front().watched == ours.hash());
+    BOOST_REQUIRE_EQUAL(detector.size(), 1u);
+    BOOST_REQUIRE(detector.unwatch(ours.hash()));
+    BOOST_REQUIRE(!detector.unwatch(ours.hash()));
+}
+
+BOOST_AUTO_TEST_CASE(conflict_detector__confirm__watched_replacement__flags_remaining)
+{
+    conflict_detector detector(nullptr);
+    const auto ours = spend_wallet(0);
+    const auto replacement = spend_wallet(0, 1);
+    const auto theirs = spend_wallet(0, 2);
+
+    // The wallet watches its transaction and its own replacement.
+    BOOST_REQUIRE(detector.watch(ours));
+    BOOST_REQUIRE(detector.watch(replacement));
+    BOOST_REQUIRE_EQUAL(detector.check(theirs).size(), 2u);
+
+    const auto conflicts = detector.confirm(block(header(), { replacement }));
+    BOOST_REQUIRE_EQUAL(conflicts.size(), 1u);
+    BOOST_REQUIRE(conflicts.front().confirmed);
+    BOOST_REQUIRE(conflicts.front().watched == ours.hash());
+    BOOST_REQUIRE(conflicts.front().spender == replacement.hash());
+    BOOST_REQUIRE_EQUAL(detector.size(), 1u);
+
+    // The confirmed replacement no longer watches the outpoint.
+    const auto remaining = detector.check(theirs);
+    BOOST_REQUIRE_EQUAL(remaining.size(), 1u);
+    BOOST_REQUIRE(remaining.front().watched == ours.hash());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,151 @@
+/**
+ * Copyright (c) 2011-2019 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <boost/test/test_tools.hpp>
+#include <boost/test/unit_test_suite.hpp>
+#include <bitcoin/client.hpp>
+
+using namespace bc::client;
+using namespace bc::system;
+using namespace bc::system::chain;
+
+static history make_row(uint8_t tag, uint64_t height, uint64_t value)
+{
+    hash_digest hash = null_hash;
+    hash.front() = tag;
+    return { output_point{ hash, 0 }, height, value,
+        input_point{ null_hash, max_uint32 }, max_uint64 };
+}
+
+static consistency_checker::report make_report(const hash_list& digests)
+{
+    return { 0, std::vector<code>(digests.size(), error::success), digests };
+}
+
+// A server that answers the block queries of check_block at height 42.
+static traffic_record::list make_block_playback(const header& header,
+    const hash_list& tx_hashes)
+{
+    static const uint32_t success = 0;
+    const auto height = to_chunk(to_little_endian(uint32_t(42)));
+
+    data_chunk hashes = to_chunk(to_little_endian(success));
+    for (const auto& hash: tx_hashes)
+        extend_data(hashes, hash);
+
+    return
+    {
+        { false, 0, "blockchain.fetch_block_header", 1, height },
+        { true, 0, "blockchain.fetch_block_header", 1,
+            build_chunk({ to_little_endian(success), header.to_data() }) },
+        { false, 0, "blockchain.fetch_block_transaction_hashes", 2, height },
+        { true, 0, "blockchain.fetch_block_transaction_hashes", 2, hashes }
+    };
+}
+
+BOOST_AUTO_TEST_SUITE(offline)
+
+BOOST_AUTO_TEST_CASE(consistency_checker__history_digest__reordered__equal)
+{
+    const history::list forward{ make_row(1, 100, 5), make_row(2, 200, 7) };
+    const history::list reverse{ make_row(2, 200, 7), make_row(1, 100, 5) };
+
+    BOOST_REQUIRE(consistency_checker::history_digest(forward) ==
+        consistency_checker::history_digest(reverse));
+}
+
+BOOST_AUTO_TEST_CASE(consistency_checker__history_digest__value_differs__not_equal)
+{
+    const history::list first{ make_row(1, 100, 5) };
+    const history::list second{ make_row(1, 100, 6) };
+
+    BOOST_REQUIRE(consistency_checker::history_digest(first) !=
+        consistency_checker::history_digest(second));
+}
+
+BOOST_AUTO_TEST_CASE(consistency_checker__hashes_digest__reordered__not_equal)
+{
+    const hash_list forward{ null_hash, sha256_hash(data_chunk{ 1 }) };
+    const hash_list reverse{ sha256_hash(data_chunk{ 1 }), null_hash };
+
+    BOOST_REQUIRE(consistency_checker::hashes_digest(forward) !=
+        consistency_checker::hashes_digest(reverse));
+}
+
+BOOST_AUTO_TEST_CASE(consistency_checker__report__divergent__expected)
+{
+    const auto one = sha256_hash(data_chunk{ 1 });
+    const auto two = sha256_hash(data_chunk{ 2 });
+
+    auto report = make_report({ one, one, two });
+    BOOST_REQUIRE(!report.consistent());
+    BOOST_REQUIRE(report.divergent() == (std::vector<size_t>{ 2 }));
+
+    // A failed query is not consistent but does not diverge.
+    report = make_report({ two, one, one });
+    report.codes[0] = error::channel_timeout;
+    BOOST_REQUIRE(!report.consistent());
+    BOOST_REQUIRE(report.divergent().empty());
+
+    report = make_report({ one, one });
+    BOOST_REQUIRE(report.consistent());
+}
+
+// Equal headers do not imply equal transaction hashes from a faulty server.
+BOOST_AUTO_TEST_CASE(consistency_checker__check_block__hashes_differ__divergent)
+{
+    const header header{ 1, null_hash, null_hash, 2, 3, 4 };
+    const hash_list hashes{ sha256_hash(data_chunk{ 1 }) };
+    const hash_list other{ sha256_hash(data_chunk{ 2 }) };
+
+    obelisk_client first;
+    obelisk_client second;
+    obelisk_client third;
+    first.set_playback(make_block_playback(header, hashes));
+    second.set_playback(make_block_playback(header, hashes));
+    third.set_playback(make_block_playback(header, other));
+
+    consistency_checker checker({ &first, &second, &third }, 1000);
+    const auto report = checker.check_block(42);
+    BOOST_REQUIRE_EQUAL(report.height, 42u);
+    BOOST_REQUIRE(report.codes == std::vector<code>(3, error::success));
+    BOOST_REQUIRE(report.divergent() == (std::vector<size_t>{ 2 }));
+}
+
+// An unanswered server times out without delaying the others' results.
+BOOST_AUTO_TEST_CASE(consistency_checker__check_block__unanswered__channel_timeout)
+{
+    const header header{ 1, null_hash, null_hash, 2, 3, 4 };
+    const hash_list hashes{ sha256_hash(data_chunk{ 1 }) };
+
+    obelisk_client first;
+    obelisk_client second;
+    first.set_playback(make_block_playback(header, hashes));
+    second.set_playback(
+    {
+        { false, 0, "blockchain.fetch_last_height", 1, {} }
+    });
+
+    consistency_checker checker({ &first, &second }, 10);
+    const auto report = checker.check_block(42);
+    BOOST_REQUIRE_EQUAL(report.codes[0], error::success);
+    BOOST_REQUIRE_EQUAL(report.codes[1], error::channel_timeout);
+    BOOST_REQUIRE(!report.consistent());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
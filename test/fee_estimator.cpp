@@ -0,0 +1,155 @@
+/**
+ * Copyright (c) 2011-2019 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cstdint>
+#include <boost/test/test_tools.hpp>
+#include <boost/test/unit_test_suite.hpp>
+#include <bitcoin/client.hpp>
+
+using namespace bc::client;
+using namespace bc::system;
+using namespace bc::system::chain;
+
+// The estimator observes only hashes, so transactions differ by locktime.
+static transaction numbered_tx(uint32_t locktime)
+{
+    return
+    {
+        1, locktime,
+        { input(output_point(null_hash, 0), script(), max_uint32) },
+        { output(1000, script()) }
+    };
+}
+
+// An entry of 100 virtual bytes.
+static mempool_mirror::entry make_entry(const transaction& tx, uint64_t fee)
+{
+    return { tx.hash(), 100, 100, fee, 0, {}, {} };
+}
+
+static fee_estimator::settings make_settings()
+{
+    auto settings = fee_estimator::default_settings;
+    settings.maximum_target = 3;
+    settings.minimum_samples = 1.0;
+    return settings;
+}
+
+BOOST_AUTO_TEST_SUITE(offline)
+
+BOOST_AUTO_TEST_CASE(fee_estimator__estimate__no_data__zero)
+{
+    const fee_estimator estimator;
+    BOOST_REQUIRE_EQUAL(estimator.estimate(0), 0u);
+    BOOST_REQUIRE_EQUAL(estimator.estimate(1), 0u);
+    BOOST_REQUIRE_EQUAL(estimator.estimate(1000), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(fee_estimator__construct__zero_target_or_buckets__invalid)
+{
+    BOOST_REQUIRE(fee_estimator());
+
+    auto settings = make_settings();
+    settings.maximum_target = 0;
+    fee_estimator no_targets(settings);
+    BOOST_REQUIRE(!no_targets);
+    BOOST_REQUIRE(!no_targets.track(make_entry(numbered_tx(0), 100)));
+    BOOST_REQUIRE_EQUAL(no_targets.estimate(1), 0u);
+
+    settings = make_settings();
+    settings.buckets = 0;
+    fee_estimator no_buckets(settings);
+    BOOST_REQUIRE(!no_buckets);
+    BOOST_REQUIRE(!no_buckets.track(make_entry(numbered_tx(0), 100)));
+    no_buckets.confirm(block());
+    BOOST_REQUIRE_EQUAL(no_buckets.estimate(1), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(fee_estimator__track__unknown_fee__false)
+{
+    fee_estimator estimator;
+    const auto tx = numbered_tx(0);
+    BOOST_REQUIRE(!estimator.track(make_entry(tx, mempool_mirror::unknown_fee)));
+    BOOST_REQUIRE(estimator.track(make_entry(tx, 100)));
+    BOOST_REQUIRE(!estimator.track(make_entry(tx, 100)));
+    BOOST_REQUIRE_EQUAL(estimator.tracked(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(fee_estimator__untrack__replaced__not_failed)
+{
+    fee_estimator estimator(make_settings());
+    transaction::list confirmed;
+
+    for (uint32_t index = 0; index < 10; ++index)
+    {
+        confirmed.push_back(numbered_tx(index));
+        BOOST_REQUIRE(estimator.track(make_entry(confirmed.back(), 10000)));
+    }
+
+    // Replaced transactions would otherwise fail at the maximum target.
+    for (uint32_t index = 10; index < 20; ++index)
+    {
+        const auto replaced = numbered_tx(index);
+        BOOST_REQUIRE(estimator.track(make_entry(replaced, 100000)));
+        BOOST_REQUIRE(estimator.untrack(replaced.hash()));
+        BOOST_REQUIRE(!estimator.untrack(replaced.hash()));
+    }
+
+    BOOST_REQUIRE_EQUAL(estimator.tracked(), 10u);
+    estimator.confirm(block(header(), confirmed));
+    estimator.confirm(block());
+    estimator.confirm(block());
+    BOOST_REQUIRE_EQUAL(estimator.tracked(), 0u);
+
+    // Only the confirmed rate is judged, so every target is estimated.
+    for (size_t target = 1; target <= 3; ++target)
+        BOOST_REQUIRE_GT(estimator.estimate(target), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(fee_estimator__confirm__high_rates_confirm__estimate_between)
+{
+    fee_estimator estimator(make_settings());
+    transaction::list confirmed;
+
+    // High rate (100000 per 1000 bytes) transactions confirm in one block.
+    for (uint32_t index = 0; index < 10; ++index)
+    {
+        confirmed.push_back(numbered_tx(index));
+        BOOST_REQUIRE(estimator.track(make_entry(confirmed.back(), 10000)));
+    }
+
+    // Low rate (1000 per 1000 bytes) transactions never confirm.
+    for (uint32_t index = 10; index < 20; ++index)
+        BOOST_REQUIRE(estimator.track(make_entry(numbered_tx(index), 100)));
+
+    estimator.confirm(block(header(), confirmed));
+    BOOST_REQUIRE_EQUAL(estimator.tracked(), 10u);
+
+    estimator.confirm(block());
+    estimator.confirm(block());
+    BOOST_REQUIRE_EQUAL(estimator.tracked(), 0u);
+
+    for (size_t target = 1; target <= 3; ++target)
+    {
+        const auto rate = estimator.estimate(target);
+        BOOST_REQUIRE_GT(rate, 1000u);
+        BOOST_REQUIRE_LE(rate, 100000u);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,65 @@
+/**
+ * Copyright (c) 2011-2019 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <bitcoin/client.hpp>
+
+using namespace bc::client;
+using namespace bc::system;
+
+// libFuzzer entry point for the response decoders of obelisk_client.
+// The first input byte selects the command and the remainder is the payload
+// of its response, which is dispatched as recorded traffic.
+
+static const std::vector<std::string> commands
+{
+    "transaction_pool.broadcast",
+    "transaction_pool.fetch_transaction2",
+    "blockchain.fetch_transaction2",
+    "blockchain.fetch_last_height",
+    "blockchain.fetch_block",
+    "blockchain.fetch_block_header",
+    "blockchain.fetch_compact_filter",
+    "blockchain.fetch_compact_filter_checkpoint",
+    "blockchain.fetch_compact_filter_headers",
+    "blockchain.fetch_transaction_index",
+    "blockchain.fetch_history4",
+    "blockchain.fetch_block_transaction_hashes",
+    "notification.key",
+    "server.version"
+};
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+    static obelisk_client client;
+
+    if (size == 0)
+        return 0;
+
+    const auto& command = commands[data[0] % commands.size()];
+    const traffic_record record
+    {
+        true, 0, command, 0, data_chunk(data + 1, data + size)
+    };
+
+    client.replay({ record });
+    return 0;
+}
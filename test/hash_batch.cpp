@@ -0,0 +1,168 @@
+/**
+ * Copyright (c) 2011-2019 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cstdint>
+#include <boost/test/test_tools.hpp>
+#include <boost/test/unit_test_suite.hpp>
+#include <bitcoin/client.hpp>
+
+using namespace bc::client;
+using namespace bc::system;
+using namespace bc::system::wallet;
+
+// Messages of every length across the padding boundaries of several blocks.
+static data_stack make_messages(size_t count)
+{
+    data_stack messages;
+    for (size_t size = 0; size < count; ++size)
+    {
+        data_chunk message(size);
+        for (size_t index = 0; index < size; ++index)
+            message[index] = static_cast<uint8_t>(index * 7 + size);
+
+        messages.push_back(message);
+    }
+
+    return messages;
+}
+
+BOOST_AUTO_TEST_SUITE(offline)
+
+BOOST_AUTO_TEST_CASE(hash_batch__sha256_hash_batch__empty__empty)
+{
+    BOOST_REQUIRE(sha256_hash_batch({}).empty());
+}
+
+BOOST_AUTO_TEST_CASE(hash_batch__sha256_hash_batch__empty_message__expected)
+{
+    const auto hashes = sha256_hash_batch({ data_chunk{} });
+    BOOST_REQUIRE_EQUAL(hashes.size(), 1u);
+    BOOST_REQUIRE_EQUAL(encode_base16(hashes.front()),
+        "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+}
+
+BOOST_AUTO_TEST_CASE(hash_batch__sha256_hash_batch__mixed_lengths__matches_sha256_hash)
+{
+    const auto messages = make_messages(300);
+    const auto hashes = sha256_hash_batch(messages);
+    BOOST_REQUIRE_EQUAL(hashes.size(), messages.size());
+
+    for (size_t index = 0; index < messages.size(); ++index)
+        BOOST_REQUIRE(hashes[index] == sha256_hash(messages[index]));
+}
+
+BOOST_AUTO_TEST_CASE(hash_batch__bitcoin_hash_batch__mixed_lengths__matches_bitcoin_hash)
+{
+    const auto messages = make_messages(200);
+    const auto hashes = bitcoin_hash_batch(messages);
+    BOOST_REQUIRE_EQUAL(hashes.size(), messages.size());
+
+    for (size_t index = 0; index < messages.size(); ++index)
+        BOOST_REQUIRE(hashes[index] == bitcoin_hash(messages[index]));
+}
+
+BOOST_AUTO_TEST_CASE(hash_batch__bitcoin_hash_batch__records__matches_bitcoin_hash)
+{
+    static const size_t record_size = 80;
+    data_chunk records(9 * record_size);
+    for (size_t index = 0; index < records.size(); ++index)
+        records[index] = static_cast<uint8_t>(index * 13);
+
+    const auto hashes = bitcoin_hash_batch(records.data(), 9, record_size);
+    BOOST_REQUIRE_EQUAL(hashes.size(), 9u);
+
+    for (size_t index = 0; index < hashes.size(); ++index)
+        BOOST_REQUIRE(hashes[index] == bitcoin_hash(data_chunk(
+            records.begin() + index * record_size,
+            records.begin() + (index + 1) * record_size)));
+}
+
+BOOST_AUTO_TEST_CASE(hash_batch__hash_supported__portable__true)
+{
+    BOOST_REQUIRE(hash_supported(hash_implementation::automatic));
+    BOOST_REQUIRE(hash_supported(hash_implementation::portable));
+}
+
+// Each implementation is forced in turn, so the AVX2 lanes are exercised even
+// where automatic selection prefers SHA-NI. Unsupported ones are skipped.
+BOOST_AUTO_TEST_CASE(hash_batch__sha256_hash_batch__each_implementation__matches_sha256_hash)
+{
+    const auto messages = make_messages(150);
+
+    for (const auto implementation: { hash_implementation::portable,
+        hash_implementation::shani, hash_implementation::avx2 })
+    {
+        if (!hash_supported(implementation))
+            continue;
+
+        const auto hashes = sha256_hash_batch(messages, implementation);
+        BOOST_REQUIRE_EQUAL(hashes.size(), messages.size());
+
+        for (size_t index = 0; index < messages.size(); ++index)
+            BOOST_REQUIRE(hashes[index] == sha256_hash(messages[index]));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(hash_batch__bitcoin_hash_batch__each_implementation__matches_bitcoin_hash)
+{
+    const auto messages = make_messages(150);
+
+    for (const auto implementation: { hash_implementation::portable,
+        hash_implementation::shani, hash_implementation::avx2 })
+    {
+        if (!hash_supported(implementation))
+            continue;
+
+        const auto hashes = bitcoin_hash_batch(messages, implementation);
+        BOOST_REQUIRE_EQUAL(hashes.size(), messages.size());
+
+        for (size_t index = 0; index < messages.size(); ++index)
+            BOOST_REQUIRE(hashes[index] == bitcoin_hash(messages[index]));
+    }
+}
+
+// A single message leaves seven of the eight AVX2 lanes idle.
+BOOST_AUTO_TEST_CASE(hash_batch__bitcoin_hash_batch__avx2_single_message__matches_bitcoin_hash)
+{
+    if (!hash_supported(hash_implementation::avx2))
+        return;
+
+    const data_chunk message(100, 0x2a);
+    const auto hashes = bitcoin_hash_batch({ message },
+        hash_implementation::avx2);
+    BOOST_REQUIRE_EQUAL(hashes.size(), 1u);
+    BOOST_REQUIRE(hashes.front() == bitcoin_hash(message));
+}
+
+BOOST_AUTO_TEST_CASE(hash_batch__script_keys__addresses__matches_script_key)
+{
+    const payment_address::list addresses
+    {
+        payment_address("1A1zP1eP5QGefi2DMPTfTL5SLmv7DivfNa"),
+        payment_address("2NGDnSYWMPY1mZCre69wWWgqV1T2wryAXNV")
+    };
+
+    const auto keys = address_keys(addresses);
+    BOOST_REQUIRE_EQUAL(keys.size(), addresses.size());
+
+    for (size_t index = 0; index < addresses.size(); ++index)
+        BOOST_REQUIRE(keys[index] ==
+            script_key(addresses[index].output_script()));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,53 @@
+/**
+ * Copyright (c) 2011-2019 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <boost/test/test_tools.hpp>
+#include <boost/test/unit_test_suite.hpp>
+#include <bitcoin/client.hpp>
+
+using namespace bc::client;
+using namespace bc::system;
+using namespace bc::system::chain;
+
+BOOST_AUTO_TEST_SUITE(offline)
+
+BOOST_AUTO_TEST_CASE(header_buffer__construct__count__zero_filled)
+{
+    const header_buffer buffer(100, 3);
+    BOOST_REQUIRE_EQUAL(buffer.start_height(), 100u);
+    BOOST_REQUIRE_EQUAL(buffer.size(), 3u);
+    BOOST_REQUIRE(!buffer.empty());
+    BOOST_REQUIRE(to_chunk(buffer.record(2)) == data_chunk(header_buffer::record_size, 0));
+}
+
+BOOST_AUTO_TEST_CASE(header_buffer__set__header__round_trips)
+{
+    const header expected(2, null_hash, sha256_hash(data_chunk{ 1 }), 42,
+        0x1d00ffff, 7);
+
+    header_buffer buffer(0, 2);
+    buffer.set(1, expected);
+
+    BOOST_REQUIRE(buffer.header(1) == expected);
+    BOOST_REQUIRE(to_chunk(buffer.record(1)) == expected.to_data());
+    BOOST_REQUIRE(to_chunk(buffer.record(0)) == data_chunk(header_buffer::record_size, 0));
+    BOOST_REQUIRE(data_chunk(buffer.data() + header_buffer::record_size,
+        buffer.data() + 2 * header_buffer::record_size) == expected.to_data());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
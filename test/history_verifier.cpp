@@ -0,0 +1,256 @@
+/**
+ * Copyright (c) 2011-2019 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+#include <boost/test/test_tools.hpp>
+#include <boost/test/unit_test_suite.hpp>
+#include <bitcoin/client.hpp>
+
+using namespace bc::client;
+using namespace bc::system;
+using namespace bc::system::chain;
+
+static const uint32_t easy_bits = 0x207fffff;
+
+static const uint32_t success = 0;
+
+// Headers commit to the given merkle roots, by index, and otherwise null.
+static header_buffer make_chain(uint32_t start_height, size_t count,
+    const hash_list& roots={})
+{
+    header_buffer buffer(start_height, count);
+    auto parent = null_hash;
+
+    for (size_t index = 0; index < count; ++index)
+    {
+        const auto root = index < roots.size() ? roots[index] : null_hash;
+        header item(1, parent, root, 1000 + index, easy_bits, 0);
+        while (!verify_proof_of_work(easy_bits, item.hash()))
+            item.set_nonce(item.nonce() + 1);
+
+        buffer.set(index, item);
+        parent = item.hash();
+    }
+
+    return buffer;
+}
+
+static history make_row(const hash_digest& output_hash, uint64_t height)
+{
+    return
+    {
+        output_point{ output_hash, 0 }, height, 1000,
+        input_point{ null_hash, point::null_index }, max_uint64
+    };
+}
+
+// Records a server answering the transaction hashes of each block.
+static traffic_record::list make_blocks(
+    const std::vector<std::pair<uint32_t, hash_list>>& blocks)
+{
+    traffic_record::list records;
+    static const std::string command =
+        "blockchain.fetch_block_transaction_hashes";
+
+    for (size_t index = 0; index < blocks.size(); ++index)
+    {
+        const auto id = static_cast<uint32_t>(index);
+        auto response = to_chunk(to_little_endian(success));
+        for (const auto& hash: blocks[index].second)
+            extend_data(response, hash);
+
+        records.push_back({ false, 0, command, id,
+            to_chunk(to_little_endian(blocks[index].first)) });
+        records.push_back({ true, 0, command, id, response });
+    }
+
+    return records;
+}
+
+static const history_verifier::settings test_settings{ 100, 50 };
+
+BOOST_AUTO_TEST_SUITE(offline)
+
+BOOST_AUTO_TEST_CASE(history_verifier__set_headers__linked__true)
+{
+    obelisk_client client;
+    history_verifier verifier(client);
+    BOOST_REQUIRE(verifier.set_headers(make_chain(100, 5)));
+}
+
+BOOST_AUTO_TEST_CASE(history_verifier__set_headers__broken_link__false)
+{
+    obelisk_client client;
+    history_verifier verifier(client);
+
+    auto headers = make_chain(100, 5);
+    headers.data()[2 * header_buffer::record_size + 4] ^= 0x01;
+    BOOST_REQUIRE(!verifier.set_headers(headers));
+    BOOST_REQUIRE(!verifier.set_headers(header_buffer()));
+}
+
+BOOST_AUTO_TEST_CASE(history_verifier__verify__uncovered_height__not_found)
+{
+    obelisk_client client;
+    history_verifier verifier(client);
+    BOOST_REQUIRE(verifier.set_headers(make_chain(100, 5)));
+
+    const history::list rows
+    {
+        make_row(bitcoin_hash(data_chunk{ 1 }), 99),
+        make_row(bitcoin_hash(data_chunk{ 2 }), 105)
+    };
+
+    std::vector<code> codes;
+    BOOST_REQUIRE_EQUAL(verifier.verify(rows, codes), error::not_found);
+    BOOST_REQUIRE_EQUAL(codes.size(), 2u);
+    BOOST_REQUIRE_EQUAL(codes[0], error::not_found);
+    BOOST_REQUIRE_EQUAL(codes[1], error::not_found);
+    BOOST_REQUIRE_EQUAL(verifier.cached_blocks(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(history_verifier__verify__empty__success)
+{
+    obelisk_client client;
+    history_verifier verifier(client);
+
+    std::vector<code> codes;
+    BOOST_REQUIRE_EQUAL(verifier.verify({}, codes), error::success);
+    BOOST_REQUIRE(codes.empty());
+}
+
+BOOST_AUTO_TEST_CASE(history_verifier__verify__merkle_match__success_and_cached)
+{
+    const auto a = bitcoin_hash(data_chunk{ 1 });
+    const auto b = bitcoin_hash(data_chunk{ 2 });
+    const auto c = bitcoin_hash(data_chunk{ 3 });
+
+    obelisk_client client;
+    client.set_playback(make_blocks({ { 101, { a } }, { 103, { b, c } } }));
+
+    history_verifier verifier(client, test_settings);
+    BOOST_REQUIRE(verifier.set_headers(make_chain(100, 5,
+    {
+        null_hash, merkle_root({ a }), null_hash, merkle_root({ b, c })
+    })));
+
+    // Two rows confirmed in block 103 share its query.
+    const history::list rows
+    {
+        make_row(a, 101), make_row(b, 103), make_row(c, 103)
+    };
+
+    std::vector<code> codes;
+    BOOST_REQUIRE_EQUAL(verifier.verify(rows, codes), error::success);
+    BOOST_REQUIRE(codes == std::vector<code>(3, error::success));
+    BOOST_REQUIRE_EQUAL(verifier.cached_blocks(), 2u);
+
+    // Cached blocks are not queried again, playback answers each once.
+    BOOST_REQUIRE_EQUAL(verifier.verify(rows, codes), error::success);
+    BOOST_REQUIRE(codes == std::vector<code>(3, error::success));
+}
+
+BOOST_AUTO_TEST_CASE(history_verifier__verify__merkle_mismatch__row_fails)
+{
+    const auto a = bitcoin_hash(data_chunk{ 1 });
+    const auto b = bitcoin_hash(data_chunk{ 2 });
+
+    // The server omits b from block 102.
+    obelisk_client client;
+    client.set_playback(make_blocks({ { 101, { a } }, { 102, { a } } }));
+
+    history_verifier verifier(client, test_settings);
+    BOOST_REQUIRE(verifier.set_headers(make_chain(100, 5,
+    {
+        null_hash, merkle_root({ a }), merkle_root({ a, b })
+    })));
+
+    std::vector<code> codes;
+    BOOST_REQUIRE_EQUAL(verifier.verify({ make_row(a, 101),
+        make_row(b, 102) }, codes), error::merkle_mismatch);
+    BOOST_REQUIRE_EQUAL(codes[0], error::success);
+    BOOST_REQUIRE_EQUAL(codes[1], error::merkle_mismatch);
+}
+
+BOOST_AUTO_TEST_CASE(history_verifier__verify__absent_transaction__not_found)
+{
+    const auto a = bitcoin_hash(data_chunk{ 1 });
+    const auto b = bitcoin_hash(data_chunk{ 2 });
+
+    obelisk_client client;
+    client.set_playback(make_blocks({ { 101, { a } } }));
+
+    history_verifier verifier(client, test_settings);
+    BOOST_REQUIRE(verifier.set_headers(make_chain(100, 5,
+    {
+        null_hash, merkle_root({ a })
+    })));
+
+    std::vector<code> codes;
+    BOOST_REQUIRE_EQUAL(verifier.verify({ make_row(b, 101) }, codes),
+        error::not_found);
+}
+
+BOOST_AUTO_TEST_CASE(history_verifier__verify__unconfirmed__skipped)
+{
+    const auto a = bitcoin_hash(data_chunk{ 1 });
+    const auto b = bitcoin_hash(data_chunk{ 2 });
+
+    obelisk_client client;
+    client.set_playback(make_blocks({ { 101, { a } } }));
+
+    history_verifier verifier(client, test_settings);
+    BOOST_REQUIRE(verifier.set_headers(make_chain(100, 5,
+    {
+        null_hash, merkle_root({ a })
+    })));
+
+    std::vector<code> codes;
+    BOOST_REQUIRE_EQUAL(verifier.verify({ make_row(a, 101),
+        make_row(b, 0) }, codes), error::success);
+    BOOST_REQUIRE(codes == std::vector<code>(2, error::success));
+    BOOST_REQUIRE_EQUAL(verifier.cached_blocks(), 1u);
+}
+
+// A failed query fails its rows but the rest of its round is retained.
+BOOST_AUTO_TEST_CASE(history_verifier__verify__unanswered__round_cached)
+{
+    const auto a = bitcoin_hash(data_chunk{ 1 });
+    const auto b = bitcoin_hash(data_chunk{ 2 });
+
+    obelisk_client client;
+    client.set_playback(make_blocks({ { 101, { a } } }));
+
+    history_verifier verifier(client, test_settings);
+    BOOST_REQUIRE(verifier.set_headers(make_chain(100, 5,
+    {
+        null_hash, merkle_root({ a }), merkle_root({ b })
+    })));
+
+    std::vector<code> codes;
+    BOOST_REQUIRE_EQUAL(verifier.verify({ make_row(a, 101),
+        make_row(b, 102) }, codes), error::channel_timeout);
+    BOOST_REQUIRE_EQUAL(codes[0], error::success);
+    BOOST_REQUIRE_EQUAL(codes[1], error::channel_timeout);
+    BOOST_REQUIRE_EQUAL(verifier.cached_blocks(), 1u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
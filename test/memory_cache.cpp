@@ -0,0 +1,216 @@
+/**
+ * Copyright (c) 2011-2019 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cstdint>
+#include <boost/test/test_tools.hpp>
+#include <boost/test/unit_test_suite.hpp>
+#include <bitcoin/client.hpp>
+
+using namespace bc::client;
+using namespace bc::system;
+
+static const uint32_t success = 0;
+
+static hash_digest make_key(uint8_t value)
+{
+    hash_digest key = null_hash;
+    key.front() = value;
+    return key;
+}
+
+static data_chunk header_request(uint32_t height)
+{
+    return to_chunk(to_little_endian(height));
+}
+
+static data_chunk header_response(const chain::header& header)
+{
+    return build_chunk({ to_little_endian(success), header.to_data() });
+}
+
+// Plays back the tip height followed by the given header requests.
+static traffic_record::list make_playback(uint32_t tip_height,
+    const traffic_record::list& requests)
+{
+    traffic_record::list records
+    {
+        { false, 0, "blockchain.fetch_last_height", 1, {} },
+        { true, 0, "blockchain.fetch_last_height", 1, build_chunk(
+        {
+            to_little_endian(success),
+            to_little_endian(tip_height)
+        }) }
+    };
+
+    records.insert(records.end(), requests.begin(), requests.end());
+    return records;
+}
+
+BOOST_AUTO_TEST_SUITE(offline)
+
+BOOST_AUTO_TEST_CASE(memory_cache__fetch__stored__expected)
+{
+    memory_cache cache(100);
+    cache.store(make_key(1), data_chunk{ 1, 2, 3 });
+
+    data_chunk payload;
+    BOOST_REQUIRE(cache.fetch(make_key(1), payload));
+    BOOST_REQUIRE(payload == (data_chunk{ 1, 2, 3 }));
+    BOOST_REQUIRE(!cache.fetch(make_key(2), payload));
+    BOOST_REQUIRE_EQUAL(cache.size(), 3u);
+}
+
+BOOST_AUTO_TEST_CASE(memory_cache__store__over_capacity__evicts_least_recently_used)
+{
+    memory_cache cache(4);
+    cache.store(make_key(1), data_chunk(2));
+    cache.store(make_key(2), data_chunk(2));
+
+    // Using the first entry makes the second the least recently used.
+    data_chunk payload;
+    BOOST_REQUIRE(cache.fetch(make_key(1), payload));
+    cache.store(make_key(3), data_chunk(2));
+
+    BOOST_REQUIRE(cache.fetch(make_key(1), payload));
+    BOOST_REQUIRE(!cache.fetch(make_key(2), payload));
+    BOOST_REQUIRE(cache.fetch(make_key(3), payload));
+    BOOST_REQUIRE_EQUAL(cache.size(), 4u);
+}
+
+BOOST_AUTO_TEST_CASE(memory_cache__store__larger_than_capacity__not_cached)
+{
+    memory_cache cache(4);
+    cache.store(make_key(1), data_chunk(5));
+
+    data_chunk payload;
+    BOOST_REQUIRE(!cache.fetch(make_key(1), payload));
+    BOOST_REQUIRE_EQUAL(cache.size(), 0u);
+}
+
+// Client admission.
+//-----------------------------------------------------------------------------
+
+BOOST_AUTO_TEST_CASE(obelisk_client__set_cache__by_height__admitted_when_buried)
+{
+    const chain::header header{ 1, null_hash, null_hash, 2, 3, 4 };
+    static const std::string command = "blockchain.fetch_block_header";
+
+    obelisk_client client;
+    client.set_cache(std::make_shared<memory_cache>(1000), 6);
+    client.set_playback(make_playback(100,
+    {
+        { false, 0, command, 2, header_request(94) },
+        { true, 0, command, 2, header_response(header) },
+        { false, 0, command, 3, header_request(95) },
+        { true, 0, command, 3, header_response(header) }
+    }));
+
+    client.blockchain_fetch_last_height([](const code&, size_t) {});
+    client.wait(1000);
+
+    size_t called = 0;
+    const auto handler = [&](const code& ec, const chain::header& result)
+    {
+        BOOST_REQUIRE_EQUAL(ec, error::success);
+        BOOST_REQUIRE(result.hash() == header.hash());
+        ++called;
+    };
+
+    // Six blocks deep is buried, five is not.
+    client.blockchain_fetch_block_header(handler, uint32_t(94));
+    client.blockchain_fetch_block_header(handler, uint32_t(95));
+    client.wait(1000);
+    BOOST_REQUIRE_EQUAL(called, 2u);
+    BOOST_REQUIRE_EQUAL(client.cache_metrics().admitted, 1u);
+    BOOST_REQUIRE_EQUAL(client.cache_metrics().rejected, 1u);
+
+    // The buried header is served from the cache, playback answers once.
+    client.blockchain_fetch_block_header(handler, uint32_t(94));
+    client.wait(1000);
+    BOOST_REQUIRE_EQUAL(called, 3u);
+    BOOST_REQUIRE_EQUAL(client.cache_metrics().hits, 1u);
+}
+
+BOOST_AUTO_TEST_CASE(obelisk_client__set_cache__undecodable__not_admitted)
+{
+    const chain::header header{ 1, null_hash, null_hash, 2, 3, 4 };
+    static const std::string command = "blockchain.fetch_block_header";
+    auto truncated = header_response(header);
+    truncated.pop_back();
+
+    obelisk_client client;
+    client.set_cache(std::make_shared<memory_cache>(1000), 6);
+    client.set_playback(make_playback(100,
+    {
+        { false, 0, command, 2, header_request(10) },
+        { true, 0, command, 2, truncated }
+    }));
+
+    client.blockchain_fetch_last_height([](const code&, size_t) {});
+    client.wait(1000);
+
+    code result(error::unknown);
+    client.blockchain_fetch_block_header([&](const code& ec,
+        const chain::header&)
+    {
+        result = ec;
+    }, uint32_t(10));
+
+    client.wait(1000);
+    BOOST_REQUIRE_EQUAL(result, error::bad_stream);
+    BOOST_REQUIRE_EQUAL(client.cache_metrics().admitted, 0u);
+    BOOST_REQUIRE_EQUAL(client.cache_metrics().rejected, 0u);
+}
+
+BOOST_AUTO_TEST_CASE(obelisk_client__set_cache__unverified__not_admitted)
+{
+    const chain::header header{ 1, null_hash, null_hash, 2, 3, 4 };
+    const chain::header other{ 2, null_hash, null_hash, 2, 3, 4 };
+    static const std::string command = "blockchain.fetch_block_header";
+
+    obelisk_client client;
+    client.set_verification(true);
+    client.set_cache(std::make_shared<memory_cache>(1000), 6);
+    client.set_playback(
+    {
+        { false, 0, command, 1, to_chunk(header.hash()) },
+        { true, 0, command, 1, header_response(other) },
+        { false, 0, command, 2, to_chunk(header.hash()) },
+        { true, 0, command, 2, header_response(header) }
+    });
+
+    code result(error::unknown);
+    const auto handler = [&](const code& ec, const chain::header&)
+    {
+        result = ec;
+    };
+
+    client.blockchain_fetch_block_header(handler, header.hash());
+    client.wait(1000);
+    BOOST_REQUIRE_EQUAL(result, error::bad_stream);
+    BOOST_REQUIRE_EQUAL(client.cache_metrics().admitted, 0u);
+
+    // The second recorded response is correct and requested by hash, so it
+    // is admitted regardless of the tip height.
+    client.blockchain_fetch_block_header(handler, header.hash());
+    client.wait(1000);
+    BOOST_REQUIRE_EQUAL(result, error::success);
+    BOOST_REQUIRE_EQUAL(client.cache_metrics().admitted, 1u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
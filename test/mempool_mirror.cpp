@@ -0,0 +1,196 @@
+/**
+ * Copyright (c) 2011-2019 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cstdint>
+#include <boost/test/test_tools.hpp>
+#include <boost/test/unit_test_suite.hpp>
+#include <bitcoin/client.hpp>
+
+using namespace bc::client;
+using namespace bc::system;
+using namespace bc::system::chain;
+
+static const auto funding_hash = bitcoin_hash(data_chunk{ 42 });
+
+// Confirmed outputs of the funding transaction are each worth 10000.
+static bool lookup(uint64_t& out_value, const point& outpoint)
+{
+    if (outpoint.hash() != funding_hash)
+        return false;
+
+    out_value = 10000;
+    return true;
+}
+
+static transaction spend(const point& outpoint, uint64_t value,
+    uint32_t locktime=0)
+{
+    return
+    {
+        1, locktime,
+        { input(output_point(outpoint), script(), max_uint32) },
+        { output(value, script()) }
+    };
+}
+
+BOOST_AUTO_TEST_SUITE(offline)
+
+BOOST_AUTO_TEST_CASE(mempool_mirror__store__parent_and_child__fees)
+{
+    mempool_mirror mirror(lookup);
+    const auto parent = spend({ funding_hash, 0 }, 9000);
+    const auto child = spend({ parent.hash(), 0 }, 8500);
+
+    BOOST_REQUIRE(mirror.store(parent));
+    BOOST_REQUIRE(mirror.store(child));
+    BOOST_REQUIRE(!mirror.store(child));
+    BOOST_REQUIRE_EQUAL(mirror.size(), 2u);
+
+    mempool_mirror::entry entry;
+    BOOST_REQUIRE(mirror.find(entry, parent.hash()));
+    BOOST_REQUIRE_EQUAL(entry.fee, 1000u);
+    BOOST_REQUIRE(entry.virtual_size != 0);
+    BOOST_REQUIRE_EQUAL(entry.fee_rate(), 1000u * 1000u / entry.virtual_size);
+
+    BOOST_REQUIRE(mirror.find(entry, child.hash()));
+    BOOST_REQUIRE_EQUAL(entry.fee, 500u);
+
+    hash_digest spender;
+    BOOST_REQUIRE(mirror.spender(spender, { parent.hash(), 0 }));
+    BOOST_REQUIRE(spender == child.hash());
+}
+
+BOOST_AUTO_TEST_CASE(mempool_mirror__store__unknown_prevout__unknown_fee)
+{
+    mempool_mirror mirror;
+    const auto tx = spend({ funding_hash, 0 }, 9000);
+    BOOST_REQUIRE(mirror.store(tx));
+
+    mempool_mirror::entry entry;
+    BOOST_REQUIRE(mirror.find(entry, tx.hash()));
+    BOOST_REQUIRE_EQUAL(entry.fee, mempool_mirror::unknown_fee);
+    BOOST_REQUIRE_EQUAL(entry.fee_rate(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(mempool_mirror__store__lookup_queries_mirror__fee)
+{
+    // The lookup is invoked unlocked, so it may use the mirror itself.
+    size_t mirrored = 0;
+    mempool_mirror* self = nullptr;
+    mempool_mirror mirror([&](uint64_t& out_value, const point& outpoint)
+    {
+        mirrored = self->size();
+        return lookup(out_value, outpoint);
+    });
+
+    self = &mirror;
+    BOOST_REQUIRE(mirror.store(spend({ funding_hash, 0 }, 9000)));
+    BOOST_REQUIRE(mirror.store(spend({ funding_hash, 1 }, 9500)));
+    BOOST_REQUIRE_EQUAL(mirrored, 1u);
+
+    const auto entries = mirror.entries();
+    BOOST_REQUIRE_EQUAL(entries.size(), 2u);
+    BOOST_REQUIRE_EQUAL(entries[0].fee + entries[1].fee, 1500u);
+}
+
+BOOST_AUTO_TEST_CASE(mempool_mirror__store__conflict__replaces_with_descendants)
+{
+    mempool_mirror mirror(lookup);
+    const auto parent = spend({ funding_hash, 0 }, 9000);
+    const auto child = spend({ parent.hash(), 0 }, 8500);
+    const auto replacement = spend({ funding_hash, 0 }, 8000, 1);
+
+    BOOST_REQUIRE(mirror.store(parent));
+    BOOST_REQUIRE(mirror.store(child));
+
+    const auto conflicts = mirror.conflicts(replacement);
+    BOOST_REQUIRE_EQUAL(conflicts.size(), 1u);
+    BOOST_REQUIRE(conflicts.front() == parent.hash());
+
+    BOOST_REQUIRE(mirror.store(replacement));
+    BOOST_REQUIRE_EQUAL(mirror.size(), 1u);
+
+    mempool_mirror::entry entry;
+    BOOST_REQUIRE(mirror.find(entry, replacement.hash()));
+    BOOST_REQUIRE(!mirror.find(entry, child.hash()));
+}
+
+BOOST_AUTO_TEST_CASE(mempool_mirror__confirm__block__prunes)
+{
+    mempool_mirror mirror(lookup);
+    const auto parent = spend({ funding_hash, 0 }, 9000);
+    const auto child = spend({ parent.hash(), 0 }, 8500);
+    const auto other = spend({ funding_hash, 1 }, 9000);
+
+    BOOST_REQUIRE(mirror.store(parent));
+    BOOST_REQUIRE(mirror.store(child));
+    BOOST_REQUIRE(mirror.store(other));
+
+    // The parent confirms, its child remains unconfirmed.
+    BOOST_REQUIRE_EQUAL(mirror.confirm(block(header(), { parent })), 1u);
+    BOOST_REQUIRE_EQUAL(mirror.size(), 2u);
+
+    // A confirmed conflict removes the mirrored spender.
+    const auto conflict = spend({ funding_hash, 1 }, 7000, 1);
+    BOOST_REQUIRE_EQUAL(mirror.confirm(block(header(), { conflict })), 1u);
+    BOOST_REQUIRE_EQUAL(mirror.size(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(mempool_mirror__remove__replaced_or_conflicted__notified)
+{
+    hash_list removed;
+    mempool_mirror mirror(lookup, [&](const hash_digest& tx_hash)
+    {
+        removed.push_back(tx_hash);
+    });
+
+    const auto parent = spend({ funding_hash, 0 }, 9000);
+    const auto child = spend({ parent.hash(), 0 }, 8500);
+    const auto other = spend({ funding_hash, 1 }, 9000);
+
+    BOOST_REQUIRE(mirror.store(parent));
+    BOOST_REQUIRE(mirror.store(child));
+    BOOST_REQUIRE(mirror.store(other));
+    BOOST_REQUIRE(removed.empty());
+
+    // The replaced parent and its child are notified.
+    BOOST_REQUIRE(mirror.store(spend({ funding_hash, 0 }, 8000, 1)));
+    BOOST_REQUIRE(removed == (hash_list{ parent.hash(), child.hash() }));
+
+    // A confirmed conflict is notified, a confirmed transaction is not.
+    removed.clear();
+    const auto conflict = spend({ funding_hash, 1 }, 7000, 1);
+    BOOST_REQUIRE_EQUAL(mirror.confirm(block(header(), { conflict })), 1u);
+    BOOST_REQUIRE(removed == (hash_list{ other.hash() }));
+
+    removed.clear();
+    const auto replacement = spend({ funding_hash, 0 }, 8000, 1);
+    BOOST_REQUIRE_EQUAL(mirror.confirm(block(header(), { replacement })), 1u);
+    BOOST_REQUIRE(removed.empty());
+    BOOST_REQUIRE_EQUAL(mirror.size(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(mempool_mirror__expire__recent__kept)
+{
+    mempool_mirror mirror;
+    BOOST_REQUIRE(mirror.store(spend({ funding_hash, 0 }, 9000)));
+    BOOST_REQUIRE_EQUAL(mirror.expire(3600), 0u);
+    BOOST_REQUIRE_EQUAL(mirror.size(), 1u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,180 @@
+/**
+ * Copyright (c) 2011-2019 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cstdint>
+#include <vector>
+#include <boost/test/test_tools.hpp>
+#include <boost/test/unit_test_suite.hpp>
+#include <bitcoin/client.hpp>
+
+using namespace bc::client;
+using namespace bc::system;
+
+static const auto test_key = bitcoin_hash(data_chunk{ 1 });
+static const auto tx_a = bitcoin_hash(data_chunk{ 2 });
+static const auto tx_b = bitcoin_hash(data_chunk{ 3 });
+
+static const uint32_t success = 0;
+
+// [ kind:1 ][ hash:32 ][ index:4 ][ height:4 ][ value:8 ], an output row.
+static data_chunk output_row(uint32_t height)
+{
+    return build_chunk(
+    {
+        to_array(0),
+        bitcoin_hash(to_chunk(to_little_endian(height))),
+        to_little_endian(uint32_t(0)),
+        to_little_endian(height),
+        to_little_endian(uint64_t(1000))
+    });
+}
+
+// Record a history query of the key from the height, answered with one row
+// at the given row height.
+static void add_history(traffic_record::list& records, uint32_t from_height,
+    uint32_t row_height)
+{
+    const auto id = static_cast<uint32_t>(records.size());
+    records.push_back({ false, 0, "blockchain.fetch_history4", id,
+        build_chunk({ test_key, to_little_endian(from_height) }) });
+    records.push_back({ true, 0, "blockchain.fetch_history4", id,
+        build_chunk({ to_little_endian(success), output_row(row_height) }) });
+}
+
+BOOST_AUTO_TEST_SUITE(offline)
+
+BOOST_AUTO_TEST_CASE(notification_coalescer__flush__burst__one_update)
+{
+    std::vector<notification_coalescer::update> updates;
+    notification_coalescer coalescer(60000,
+        [&](const notification_coalescer::update& value)
+        {
+            updates.push_back(value);
+        });
+
+    const auto handler = coalescer.handler();
+    handler(error::success, test_key, 1, 0, tx_a);
+    handler(error::success, test_key, 2, 700, tx_a);
+    handler(error::success, test_key, 3, 650, tx_b);
+    BOOST_REQUIRE_EQUAL(coalescer.pending(), 1u);
+
+    // The window has not elapsed.
+    BOOST_REQUIRE_EQUAL(coalescer.flush(), 0u);
+    BOOST_REQUIRE_EQUAL(coalescer.flush(true), 1u);
+    BOOST_REQUIRE_EQUAL(coalescer.pending(), 0u);
+
+    BOOST_REQUIRE_EQUAL(updates.size(), 1u);
+    const auto& value = updates.front();
+    BOOST_REQUIRE_EQUAL(value.ec, error::success);
+    BOOST_REQUIRE(value.key == test_key);
+    BOOST_REQUIRE_EQUAL(value.tx_hashes.size(), 2u);
+    BOOST_REQUIRE(value.tx_hashes[0] == tx_a);
+    BOOST_REQUIRE(value.tx_hashes[1] == tx_b);
+    BOOST_REQUIRE_EQUAL(value.minimum_height, 650u);
+    BOOST_REQUIRE(value.unconfirmed);
+    BOOST_REQUIRE_EQUAL(value.sequence, 3u);
+    BOOST_REQUIRE_EQUAL(value.notifications, 3u);
+}
+
+BOOST_AUTO_TEST_CASE(notification_coalescer__handler__acknowledgement__ignored)
+{
+    notification_coalescer coalescer(0, nullptr);
+    coalescer.handler()(error::success, test_key, 0, 0, null_hash);
+    BOOST_REQUIRE_EQUAL(coalescer.pending(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(notification_coalescer__flush__error__delivered_immediately)
+{
+    code result;
+    notification_coalescer coalescer(60000,
+        [&](const notification_coalescer::update& value)
+        {
+            result = value.ec;
+        });
+
+    coalescer.handler()(error::channel_timeout, test_key, 0, 0, null_hash);
+    BOOST_REQUIRE_EQUAL(coalescer.flush(), 1u);
+    BOOST_REQUIRE_EQUAL(result, error::channel_timeout);
+}
+
+BOOST_AUTO_TEST_CASE(notification_coalescer__flush__zero_window__delivered)
+{
+    size_t delivered = 0;
+    notification_coalescer coalescer(0,
+        [&](const notification_coalescer::update&)
+        {
+            ++delivered;
+        });
+
+    const auto handler = coalescer.handler();
+    handler(error::success, test_key, 1, 10, tx_a);
+    handler(error::success, tx_b, 1, 10, tx_a);
+    BOOST_REQUIRE_EQUAL(coalescer.flush(), 2u);
+    BOOST_REQUIRE_EQUAL(delivered, 2u);
+}
+
+BOOST_AUTO_TEST_CASE(notification_coalescer__flush__history_fetch__from_height)
+{
+    // Only queries from the expected heights are answered.
+    traffic_record::list records;
+    add_history(records, 0, 10);
+    add_history(records, 650, 650);
+    add_history(records, 650, 660);
+    add_history(records, 800, 800);
+
+    obelisk_client client;
+    client.set_playback(records);
+
+    std::vector<size_t> heights;
+    notification_coalescer coalescer(60000, nullptr);
+    coalescer.set_history_fetch(client,
+        [&](const code& ec, const hash_digest& key, const history::list& rows)
+        {
+            BOOST_REQUIRE_EQUAL(ec, error::success);
+            BOOST_REQUIRE(key == test_key);
+            BOOST_REQUIRE_EQUAL(rows.size(), 1u);
+            heights.push_back(rows.front().output_height);
+        });
+
+    const auto handler = coalescer.handler();
+    const auto deliver = [&]()
+    {
+        BOOST_REQUIRE_EQUAL(coalescer.flush(true), 1u);
+        client.wait(1000);
+    };
+
+    // Without a confirmed update the full history is fetched.
+    handler(error::success, test_key, 1, 0, tx_a);
+    deliver();
+
+    // From the lowest confirmed height of the window.
+    handler(error::success, test_key, 2, 700, tx_a);
+    handler(error::success, test_key, 3, 650, tx_b);
+    deliver();
+
+    // Unconfirmed only, from the height of the last confirmed update.
+    handler(error::success, test_key, 4, 0, tx_b);
+    deliver();
+
+    handler(error::success, test_key, 5, 800, tx_b);
+    deliver();
+
+    BOOST_REQUIRE(heights == (std::vector<size_t>{ 10, 650, 660, 800 }));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -18,6 +18,7 @@
  */
 #include <cstdint>
 #include <string>
+#include <vector>
 #include <boost/test/test_tools.hpp>
 #include <boost/test/unit_test_suite.hpp>
 #include <bitcoin/client.hpp>
@@ -53,6 +54,510 @@ BOOST_AUTO_TEST_CASE(client__dummy_test__ok)
 
 BOOST_AUTO_TEST_SUITE_END()
 
+static const uint32_t success = 0;
+
+// Playback that answers no request of the test, as an unresponsive server.
+static const traffic_record::list unanswered
+{
+    { false, 0, "server.version", 1, { 0xff } }
+};
+
+BOOST_AUTO_TEST_SUITE(offline)
+
+// Compact filter handlers were once missing from the expired families, so
+// that their requests never completed.
+BOOST_AUTO_TEST_CASE(client__fetch_compact_filter__unanswered__channel_timeout)
+{
+    obelisk_client client;
+    client.set_playback(unanswered);
+
+    code filter_result(error::unknown);
+    code headers_result(error::unknown);
+    code checkpoint_result(error::unknown);
+
+    client.blockchain_fetch_compact_filter([&](const code& ec,
+        const message::compact_filter&)
+    {
+        filter_result = ec;
+    }, 0, uint32_t(42));
+
+    client.blockchain_fetch_compact_filter_headers([&](const code& ec,
+        const message::compact_filter_headers&)
+    {
+        headers_result = ec;
+    }, 0, 42, uint32_t(43));
+
+    client.blockchain_fetch_compact_filter_checkpoint([&](const code& ec,
+        const message::compact_filter_checkpoint&)
+    {
+        checkpoint_result = ec;
+    }, 0, null_hash);
+
+    client.wait(10);
+    BOOST_REQUIRE_EQUAL(filter_result, error::channel_timeout);
+    BOOST_REQUIRE_EQUAL(headers_result, error::channel_timeout);
+    BOOST_REQUIRE_EQUAL(checkpoint_result, error::channel_timeout);
+}
+
+BOOST_AUTO_TEST_CASE(client__timeouts__expired_by_family__counted)
+{
+    obelisk_client client;
+    client.set_playback(
+    {
+        { false, 0, "blockchain.fetch_last_height", 1, {} },
+        { true, 0, "blockchain.fetch_last_height", 1, build_chunk(
+        {
+            to_little_endian(success),
+            to_little_endian(uint32_t(42))
+        }) }
+    });
+
+    BOOST_REQUIRE(client.timeouts().empty());
+
+    // The first request is answered, the others are not.
+    const auto ignore = [](const code&, size_t) {};
+    client.blockchain_fetch_last_height(ignore);
+    client.blockchain_fetch_last_height(ignore);
+    client.blockchain_fetch_block_height(ignore, null_hash);
+    client.blockchain_fetch_compact_filter([](const code&,
+        const message::compact_filter&) {}, 0, uint32_t(42));
+    client.wait(10);
+
+    auto timeouts = client.timeouts();
+    BOOST_REQUIRE_EQUAL(timeouts["height_handler"], 2u);
+    BOOST_REQUIRE_EQUAL(timeouts["compact_filter_handler"], 1u);
+    BOOST_REQUIRE_EQUAL(timeouts["history_handler"], 0u);
+
+    // Counts accumulate across rounds.
+    client.blockchain_fetch_last_height(ignore);
+    client.wait(10);
+    BOOST_REQUIRE_EQUAL(client.timeouts().at("height_handler"), 3u);
+}
+
+// Negotiation.
+//-----------------------------------------------------------------------------
+
+static traffic_record::list version_playback(const std::string& version)
+{
+    return
+    {
+        { false, 0, "server.version", 1, {} },
+        { true, 0, "server.version", 1, build_chunk(
+        {
+            to_little_endian(success),
+            data_chunk(version.begin(), version.end())
+        }) }
+    };
+}
+
+BOOST_AUTO_TEST_CASE(client__negotiate__versions__expected_capabilities)
+{
+    struct expectation
+    {
+        std::string version;
+        uint32_t major;
+        uint32_t minor;
+        bool witness;
+        bool script_hash;
+    };
+
+    const std::vector<expectation> expectations
+    {
+        { "4.0.0", 4, 0, true, true },
+        { "v3.4", 3, 4, true, false },
+        { "3.3.1-rc1", 3, 3, false, false },
+        { "10.2", 10, 2, true, true }
+    };
+
+    for (const auto& expected: expectations)
+    {
+        obelisk_client client;
+        client.set_playback(version_playback(expected.version));
+        BOOST_REQUIRE(client.negotiate(1000));
+
+        const auto& capabilities = client.server_capabilities();
+        BOOST_REQUIRE_EQUAL(capabilities.version, expected.version);
+        BOOST_REQUIRE_EQUAL(capabilities.major, expected.major);
+        BOOST_REQUIRE_EQUAL(capabilities.minor, expected.minor);
+        BOOST_REQUIRE_EQUAL(capabilities.witness, expected.witness);
+        BOOST_REQUIRE_EQUAL(capabilities.script_hash, expected.script_hash);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(client__negotiate__malformed_versions__false)
+{
+    for (const auto& version: { "", "4", "x4.0", "4-0", "v.4" })
+    {
+        obelisk_client client;
+        client.set_playback(version_playback(version));
+        BOOST_REQUIRE(!client.negotiate(1000));
+        BOOST_REQUIRE(client.server_capabilities().version.empty());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(client__negotiate__unanswered__false)
+{
+    obelisk_client client;
+    client.set_playback(unanswered);
+    BOOST_REQUIRE(!client.negotiate(10));
+}
+
+// Commands newer than the negotiated server fail without being sent.
+BOOST_AUTO_TEST_CASE(client__supported__older_server__operation_failed)
+{
+    obelisk_client client;
+    client.set_playback(version_playback("3.4.0"));
+    BOOST_REQUIRE(client.negotiate(1000));
+
+    code history_result(error::unknown);
+    client.blockchain_fetch_history4([&](const code& ec,
+        const history::list&)
+    {
+        history_result = ec;
+    }, null_hash);
+
+    code transaction_result(error::unknown);
+    client.blockchain_fetch_transaction2([&](const code& ec,
+        const chain::transaction&)
+    {
+        transaction_result = ec;
+    }, null_hash);
+
+    // Both are resolved before waiting: the first as unsupported, and the
+    // second is supported but unanswered by playback so it times out.
+    BOOST_REQUIRE_EQUAL(history_result, error::operation_failed);
+    BOOST_REQUIRE_EQUAL(transaction_result, error::unknown);
+
+    const auto subscription = client.subscribe_key([](const code&, uint16_t,
+        size_t, const hash_digest&) {}, null_hash);
+    BOOST_REQUIRE_EQUAL(subscription, obelisk_client::null_subscription);
+
+    client.wait(10);
+    BOOST_REQUIRE_EQUAL(transaction_result, error::channel_timeout);
+    BOOST_REQUIRE(client.timeouts()["history_handler"] == 0u);
+}
+
+// Without negotiation every command is sent.
+BOOST_AUTO_TEST_CASE(client__supported__not_negotiated__sent)
+{
+    obelisk_client client;
+    client.set_playback(unanswered);
+
+    code result(error::unknown);
+    client.blockchain_fetch_history4([&](const code& ec,
+        const history::list&)
+    {
+        result = ec;
+    }, null_hash);
+
+    BOOST_REQUIRE_EQUAL(result, error::unknown);
+    client.wait(10);
+    BOOST_REQUIRE_EQUAL(result, error::channel_timeout);
+}
+
+// Batching.
+//-----------------------------------------------------------------------------
+
+static const obelisk_client::batched_message::list batched
+{
+    { "blockchain.fetch_last_height", 1, {} },
+    { "blockchain.fetch_block_height", 2, to_chunk(null_hash) }
+};
+
+static data_chunk height_response(uint32_t height)
+{
+    return build_chunk({ to_little_endian(success), to_little_endian(height) });
+}
+
+BOOST_AUTO_TEST_CASE(client__encode_batch__round_trip__expected)
+{
+    const auto envelope = obelisk_client::encode_batch(batched);
+    BOOST_REQUIRE_EQUAL(envelope.front(), 2u);
+
+    obelisk_client::batched_message::list replies;
+    BOOST_REQUIRE(obelisk_client::decode_batch(build_chunk(
+    {
+        to_little_endian(success),
+        envelope
+    }), replies));
+
+    BOOST_REQUIRE_EQUAL(replies.size(), batched.size());
+    for (size_t index = 0; index < replies.size(); ++index)
+    {
+        BOOST_REQUIRE_EQUAL(replies[index].command, batched[index].command);
+        BOOST_REQUIRE_EQUAL(replies[index].id, batched[index].id);
+        BOOST_REQUIRE(replies[index].payload == batched[index].payload);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(client__decode_batch__rejected__false)
+{
+    obelisk_client::batched_message::list replies;
+    BOOST_REQUIRE(!obelisk_client::decode_batch({}, replies));
+    BOOST_REQUIRE(!obelisk_client::decode_batch(build_chunk(
+    {
+        to_little_endian(uint32_t(error::not_implemented)),
+        obelisk_client::encode_batch(batched)
+    }), replies));
+    BOOST_REQUIRE(replies.empty());
+}
+
+BOOST_AUTO_TEST_CASE(client__decode_batch__truncated__preceding_replies)
+{
+    auto payload = build_chunk(
+    {
+        to_little_endian(success),
+        obelisk_client::encode_batch(batched)
+    });
+
+    payload.pop_back();
+
+    obelisk_client::batched_message::list replies;
+    BOOST_REQUIRE(obelisk_client::decode_batch(payload, replies));
+    BOOST_REQUIRE_EQUAL(replies.size(), 1u);
+    BOOST_REQUIRE_EQUAL(replies.front().command, batched.front().command);
+}
+
+// Playback does not answer the envelope, as a server that does not batch.
+BOOST_AUTO_TEST_CASE(client__set_batching__unanswered_envelope__sent_individually)
+{
+    obelisk_client client;
+    client.set_batching(10, 20);
+    client.set_playback(
+    {
+        { false, 0, "blockchain.fetch_last_height", 1, {} },
+        { true, 0, "blockchain.fetch_last_height", 1, height_response(42) },
+        { false, 0, "blockchain.fetch_block_height", 2, to_chunk(null_hash) },
+        { true, 0, "blockchain.fetch_block_height", 2, height_response(7) }
+    });
+
+    size_t last_height = 0;
+    size_t block_height = 0;
+    client.blockchain_fetch_last_height([&](const code& ec, size_t height)
+    {
+        BOOST_REQUIRE_EQUAL(ec, error::success);
+        last_height = height;
+    });
+
+    client.blockchain_fetch_block_height([&](const code& ec, size_t height)
+    {
+        BOOST_REQUIRE_EQUAL(ec, error::success);
+        block_height = height;
+    }, null_hash);
+
+    client.wait(1000);
+    BOOST_REQUIRE_EQUAL(last_height, 42u);
+    BOOST_REQUIRE_EQUAL(block_height, 7u);
+}
+
+BOOST_AUTO_TEST_CASE(client__set_batching__answered_envelope__replies_dispatched)
+{
+    const auto replies = obelisk_client::encode_batch(
+    {
+        { "blockchain.fetch_last_height", 1, height_response(42) },
+        { "blockchain.fetch_block_height", 2, height_response(7) }
+    });
+
+    // The envelope takes the id following those of the queries it carries.
+    obelisk_client client;
+    client.set_batching(10, 20);
+    client.set_playback(
+    {
+        { false, 0, "server.batch", 3, obelisk_client::encode_batch(batched) },
+        { true, 0, "server.batch", 3, build_chunk(
+        {
+            to_little_endian(success),
+            replies
+        }) }
+    });
+
+    size_t last_height = 0;
+    size_t block_height = 0;
+    client.blockchain_fetch_last_height([&](const code&, size_t height)
+    {
+        last_height = height;
+    });
+
+    client.blockchain_fetch_block_height([&](const code&, size_t height)
+    {
+        block_height = height;
+    }, null_hash);
+
+    client.wait(1000);
+    BOOST_REQUIRE_EQUAL(last_height, 42u);
+    BOOST_REQUIRE_EQUAL(block_height, 7u);
+}
+
+BOOST_AUTO_TEST_CASE(client__set_batching__truncated_reply__missing_failed)
+{
+    auto payload = build_chunk(
+    {
+        to_little_endian(success),
+        obelisk_client::encode_batch(
+        {
+            { "blockchain.fetch_last_height", 1, height_response(42) },
+            { "blockchain.fetch_block_height", 2, height_response(7) }
+        })
+    });
+
+    payload.pop_back();
+
+    obelisk_client client;
+    client.set_batching(10, 20);
+    client.set_playback(
+    {
+        { false, 0, "server.batch", 3, obelisk_client::encode_batch(batched) },
+        { true, 0, "server.batch", 3, payload }
+    });
+
+    size_t last_height = 0;
+    code block_result(error::unknown);
+    client.blockchain_fetch_last_height([&](const code&, size_t height)
+    {
+        last_height = height;
+    });
+
+    client.blockchain_fetch_block_height([&](const code& ec, size_t)
+    {
+        block_result = ec;
+    }, null_hash);
+
+    client.wait(1000);
+    BOOST_REQUIRE_EQUAL(last_height, 42u);
+    BOOST_REQUIRE_EQUAL(block_result, error::bad_stream);
+}
+
+BOOST_AUTO_TEST_CASE(client__set_batching__unanswered_after_reply__sent_individually)
+{
+    const auto replies = obelisk_client::encode_batch(
+    {
+        { "blockchain.fetch_last_height", 1, height_response(42) },
+        { "blockchain.fetch_block_height", 2, height_response(7) }
+    });
+
+    // The second envelope (id 6) is not answered.
+    obelisk_client client;
+    client.set_batching(10, 20);
+    client.set_playback(
+    {
+        { false, 0, "server.batch", 3, obelisk_client::encode_batch(batched) },
+        { true, 0, "server.batch", 3, build_chunk(
+        {
+            to_little_endian(success),
+            replies
+        }) },
+        { false, 0, "blockchain.fetch_last_height", 4, {} },
+        { true, 0, "blockchain.fetch_last_height", 4, height_response(43) },
+        { false, 0, "blockchain.fetch_block_height", 5, to_chunk(null_hash) },
+        { true, 0, "blockchain.fetch_block_height", 5, height_response(8) }
+    });
+
+    size_t last_height = 0;
+    size_t block_height = 0;
+    const auto fetch = [&]()
+    {
+        client.blockchain_fetch_last_height([&](const code& ec, size_t height)
+        {
+            BOOST_REQUIRE_EQUAL(ec, error::success);
+            last_height = height;
+        });
+
+        client.blockchain_fetch_block_height([&](const code& ec, size_t height)
+        {
+            BOOST_REQUIRE_EQUAL(ec, error::success);
+            block_height = height;
+        }, null_hash);
+    };
+
+    fetch();
+    client.wait(1000);
+    BOOST_REQUIRE_EQUAL(last_height, 42u);
+    BOOST_REQUIRE_EQUAL(block_height, 7u);
+
+    fetch();
+    client.wait(1000);
+    BOOST_REQUIRE_EQUAL(last_height, 43u);
+    BOOST_REQUIRE_EQUAL(block_height, 8u);
+}
+
+// [ code:4 ][ sequence:2 ][ height:4 ][ tx_hash:32 ]
+static data_chunk notification(uint16_t sequence, uint32_t height)
+{
+    return build_chunk(
+    {
+        to_little_endian(success),
+        to_little_endian(sequence),
+        to_little_endian(height),
+        sha256_hash(to_chunk(to_little_endian(sequence)))
+    });
+}
+
+BOOST_AUTO_TEST_CASE(client__monitor__resubscribed_in_handler__snapshot_dispatched)
+{
+    const auto notified = sha256_hash(data_chunk{ 1 });
+    const auto added = sha256_hash(data_chunk{ 2 });
+    const auto removed = sha256_hash(data_chunk{ 3 });
+
+    obelisk_client client;
+    client.set_playback(
+    {
+        { false, 0, "subscribe.key", 1, to_chunk(notified) },
+        { true, 0, "subscribe.key", 1, to_chunk(to_little_endian(success)) },
+        { true, 0, "notification.key", 1, notification(1, 500) },
+        { true, 0, "notification.key", 1, notification(2, 400) },
+        { true, 0, "notification.key", 1, notification(3, 0) }
+    });
+
+    const auto ignore = [](const code&) {};
+    const auto discard = [](const code&, uint16_t, size_t,
+        const hash_digest&) {};
+    const auto other = client.subscribe_key(discard, removed);
+
+    std::vector<size_t> heights;
+    client.subscribe_key([&](const code& ec, uint16_t sequence,
+        size_t height, const hash_digest& tx_hash)
+    {
+        if (ec || tx_hash == null_hash)
+            return;
+
+        heights.push_back(height);
+
+        // Subscriptions replaced while dispatching from the prior snapshot.
+        if (sequence == 1)
+        {
+            BOOST_REQUIRE_EQUAL(client.unsubscribe_keys(ignore, { other }),
+                1u);
+            client.subscribe_key(discard, added);
+        }
+    }, notified);
+
+    client.monitor(10);
+    BOOST_REQUIRE(heights == (std::vector<size_t>{ 500, 400, 0 }));
+    BOOST_REQUIRE_EQUAL(client.unsubscribe_keys(ignore, { other }), 0u);
+
+    // Subscriptions ended by monitor are saved as of their end, and the
+    // notified height is not lowered by later notifications.
+    client_state state;
+    client.save_subscriptions(state);
+    BOOST_REQUIRE_EQUAL(state.subscriptions.size(), 2u);
+
+    const auto first = state.subscriptions[0].key == notified ? 0 : 1;
+    BOOST_REQUIRE(state.subscriptions[first].key == notified);
+    BOOST_REQUIRE_EQUAL(state.subscriptions[first].sequence, 3u);
+    BOOST_REQUIRE_EQUAL(state.subscriptions[first].height, 500u);
+    BOOST_REQUIRE(state.subscriptions[1 - first].key == added);
+
+    // A key subscribed again continues from its saved position.
+    client.subscribe_key(discard, notified);
+    client.save_subscriptions(state);
+    BOOST_REQUIRE_EQUAL(state.subscriptions.size(), 2u);
+    BOOST_REQUIRE(state.subscriptions[0].key == notified);
+    BOOST_REQUIRE_EQUAL(state.subscriptions[0].sequence, 3u);
+    BOOST_REQUIRE_EQUAL(state.subscriptions[0].height, 500u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
 BOOST_AUTO_TEST_SUITE(network)
 
 BOOST_AUTO_TEST_CASE(client__fetch_history4__test)
@@ -196,6 +701,43 @@ BOOST_AUTO_TEST_CASE(client__fetch_transaction2__test)
     BOOST_REQUIRE_EQUAL(received_hash, expected_hash);
 }
 
+BOOST_AUTO_TEST_CASE(client__fetch_transaction2__verified_test)
+{
+    CLIENT_TEST_SETUP;
+    client.set_verification(true);
+
+    code result(error::unknown);
+    const auto on_done = [&result](const code& ec, const chain::transaction&)
+    {
+        result = ec;
+    };
+
+    client.blockchain_fetch_transaction2(on_done, hash_literal(test_tx_hash));
+    client.wait();
+
+    BOOST_REQUIRE_EQUAL(result, error::success);
+}
+
+BOOST_AUTO_TEST_CASE(client__fetch_block__verified_test)
+{
+    CLIENT_TEST_SETUP;
+    client.set_verification(true);
+
+    code result(error::unknown);
+    size_t transactions = 0;
+    const auto on_done = [&](const code& ec, const chain::block& block)
+    {
+        result = ec;
+        transactions = block.transactions().size();
+    };
+
+    client.blockchain_fetch_block(on_done, hash_literal(test_block_hash));
+    client.wait();
+
+    BOOST_REQUIRE_EQUAL(result, error::success);
+    BOOST_REQUIRE(transactions != 0);
+}
+
 BOOST_AUTO_TEST_CASE(client__fetch_unspent_outputs__test)
 {
     CLIENT_TEST_SETUP;
@@ -0,0 +1,416 @@
+/**
+ * Copyright (c) 2011-2019 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+#include <boost/test/test_tools.hpp>
+#include <boost/test/unit_test_suite.hpp>
+#include <bitcoin/client.hpp>
+
+using namespace bc::client;
+using namespace bc::system;
+using namespace bc::system::chain;
+
+// Properties of the response decoders, driven through playback to the
+// handlers of real requests. These are most useful when the tests are
+// compiled with address sanitization.
+
+static const uint32_t success = 0;
+static const uint32_t height = 42;
+
+struct sample
+{
+    typedef std::function<void(obelisk_client&, code&)> fetcher;
+
+    std::string command;
+    data_chunk request;
+    data_chunk response;
+
+    // The response is read to its end, so trailing bytes are rejected.
+    bool exact;
+
+    // The size of each row of a list response, or zero. A truncation to
+    // whole rows is a complete and shorter list.
+    size_t row;
+
+    fetcher fetch;
+};
+
+// Decoders that reject any truncation of their response (to other than
+// whole rows of a list).
+static std::vector<sample> make_samples()
+{
+    const auto ok = to_little_endian(success);
+    const auto hash = bitcoin_hash(data_chunk{ 42 });
+    const transaction tx
+    {
+        1, 0,
+        { input(output_point(hash, 0), script(), max_uint32) },
+        { output(1000, script()) }
+    };
+
+    const chain::header header{ 1, hash, tx.hash(), 0, 0x207fffff, 0 };
+    const chain::block block{ header, { tx } };
+    const auto request_height = to_chunk(to_little_endian(height));
+    const auto key = sha256_hash(data_chunk{ 42 });
+    const auto history_row = build_chunk(
+    {
+        to_array(0),
+        hash,
+        to_little_endian(uint32_t(1)),
+        to_little_endian(height),
+        to_little_endian(uint64_t(1000))
+    });
+
+    return
+    {
+        {
+            "blockchain.fetch_last_height", {},
+            build_chunk({ ok, to_little_endian(height) }),
+            true, 0,
+            [](obelisk_client& client, code& out)
+            {
+                client.blockchain_fetch_last_height(
+                    [&out](const code& ec, size_t) { out = ec; });
+            }
+        },
+        {
+            "blockchain.fetch_transaction_index", to_chunk(hash),
+            build_chunk({ ok, to_little_endian(height),
+                to_little_endian(uint32_t(7)) }),
+            true, 0,
+            [hash](obelisk_client& client, code& out)
+            {
+                client.blockchain_fetch_transaction_index(
+                    [&out](const code& ec, size_t, size_t)
+                    {
+                        out = ec;
+                    }, hash);
+            }
+        },
+        {
+            "blockchain.fetch_block_header", request_height,
+            build_chunk({ ok, header.to_data() }),
+            false, 0,
+            [](obelisk_client& client, code& out)
+            {
+                client.blockchain_fetch_block_header(
+                    [&out](const code& ec, const chain::header&)
+                    {
+                        out = ec;
+                    }, height);
+            }
+        },
+        {
+            "blockchain.fetch_transaction", to_chunk(tx.hash()),
+            build_chunk({ ok, tx.to_data(true, true) }),
+            false, 0,
+            [tx](obelisk_client& client, code& out)
+            {
+                client.blockchain_fetch_transaction(
+                    [&out](const code& ec, const transaction&)
+                    {
+                        out = ec;
+                    }, tx.hash());
+            }
+        },
+        {
+            "blockchain.fetch_block", request_height,
+            build_chunk({ ok, block.to_data() }),
+            false, 0,
+            [](obelisk_client& client, code& out)
+            {
+                client.blockchain_fetch_block(
+                    [&out](const code& ec, const chain::block&)
+                    {
+                        out = ec;
+                    }, height);
+            }
+        },
+        {
+            "blockchain.fetch_compact_filter",
+            build_chunk({ to_array(0), request_height }),
+            build_chunk({ ok, to_array(0), hash, to_array(3),
+                data_chunk{ 1, 2, 3 } }),
+            false, 0,
+            [](obelisk_client& client, code& out)
+            {
+                client.blockchain_fetch_compact_filter(
+                    [&out](const code& ec,
+                        const message::compact_filter&) { out = ec; },
+                    0, height);
+            }
+        },
+        {
+            "blockchain.fetch_compact_filter_headers",
+            build_chunk({ to_array(0), to_little_endian(uint32_t(0)),
+                request_height }),
+            build_chunk({ ok, to_array(0), hash, hash, to_array(2), hash,
+                hash }),
+            false, 0,
+            [](obelisk_client& client, code& out)
+            {
+                client.blockchain_fetch_compact_filter_headers(
+                    [&out](const code& ec,
+                        const message::compact_filter_headers&)
+                    {
+                        out = ec;
+                    }, 0, 0, height);
+            }
+        },
+        {
+            "blockchain.fetch_compact_filter_checkpoint",
+            build_chunk({ to_array(0), hash }),
+            build_chunk({ ok, to_array(0), hash, to_array(2), hash, hash }),
+            false, 0,
+            [hash](obelisk_client& client, code& out)
+            {
+                client.blockchain_fetch_compact_filter_checkpoint(
+                    [&out](const code& ec,
+                        const message::compact_filter_checkpoint&)
+                    {
+                        out = ec;
+                    }, 0, hash);
+            }
+        },
+        {
+            "blockchain.fetch_history4",
+            build_chunk({ key, to_little_endian(uint32_t(0)) }),
+            build_chunk({ ok, history_row, history_row }),
+            true, history_row.size(),
+            [key](obelisk_client& client, code& out)
+            {
+                client.blockchain_fetch_history4(
+                    [&out](const code& ec, const history::list&)
+                    {
+                        out = ec;
+                    }, key);
+            }
+        },
+        {
+            "blockchain.fetch_block_transaction_hashes", request_height,
+            build_chunk({ ok, hash, tx.hash() }),
+            true, hash_size,
+            [](obelisk_client& client, code& out)
+            {
+                client.blockchain_fetch_block_transaction_hashes(
+                    [&out](const code& ec, const hash_list&)
+                    {
+                        out = ec;
+                    }, height);
+            }
+        }
+    };
+}
+
+// A truncation of the response that is a complete shorter list.
+static bool is_whole_rows(const sample& sample, size_t size)
+{
+    return sample.row != 0 && size >= sizeof(uint32_t) &&
+        (size - sizeof(uint32_t)) % sample.row == 0;
+}
+
+// Play the response to the request of the sample, returning its code.
+static code fetch(const sample& sample, const data_chunk& response)
+{
+    obelisk_client client;
+    client.set_playback(
+    {
+        { false, 0, sample.command, 1, sample.request },
+        { true, 0, sample.command, 1, response }
+    });
+
+    code result(error::unknown);
+    sample.fetch(client, result);
+    client.wait(1000);
+    return result;
+}
+
+// Subscribe to a key and play the notification, returning the last code.
+static code notify(const data_chunk& notification)
+{
+    const auto key = sha256_hash(data_chunk{ 42 });
+    obelisk_client client;
+    client.set_playback(
+    {
+        { false, 0, "subscribe.key", 1, to_chunk(key) },
+        { true, 0, "subscribe.key", 1, to_chunk(to_little_endian(success)) },
+        { true, 0, "notification.key", 1, notification }
+    });
+
+    code result(error::unknown);
+    client.subscribe_key([&](const code& ec, uint16_t, size_t,
+        const hash_digest&)
+    {
+        // Expiry by monitor is not a decoding result.
+        if (ec != error::channel_timeout)
+            result = ec;
+    }, key);
+
+    client.monitor(10);
+    return result;
+}
+
+static data_chunk make_notification()
+{
+    return build_chunk(
+    {
+        to_little_endian(success),
+        to_little_endian(uint16_t(1)),
+        to_little_endian(height),
+        bitcoin_hash(data_chunk{ 1 })
+    });
+}
+
+BOOST_AUTO_TEST_SUITE(offline)
+
+BOOST_AUTO_TEST_CASE(response_decoders__fetch__complete__success)
+{
+    for (const auto& sample: make_samples())
+        BOOST_REQUIRE_MESSAGE(fetch(sample, sample.response) ==
+            error::success, sample.command);
+}
+
+BOOST_AUTO_TEST_CASE(response_decoders__fetch__truncated__bad_stream)
+{
+    for (const auto& sample: make_samples())
+    {
+        for (size_t size = 0; size < sample.response.size(); ++size)
+        {
+            if (is_whole_rows(sample, size))
+                continue;
+
+            const data_chunk truncated(sample.response.begin(),
+                sample.response.begin() + size);
+
+            BOOST_REQUIRE_MESSAGE(fetch(sample, truncated) ==
+                error::bad_stream, sample.command << " " << size);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(response_decoders__fetch__truncated_to_rows__success)
+{
+    for (const auto& sample: make_samples())
+    {
+        for (size_t size = 0; size < sample.response.size(); ++size)
+        {
+            if (!is_whole_rows(sample, size))
+                continue;
+
+            const data_chunk truncated(sample.response.begin(),
+                sample.response.begin() + size);
+
+            BOOST_REQUIRE_MESSAGE(fetch(sample, truncated) ==
+                error::success, sample.command << " " << size);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(response_decoders__fetch__extended_position__bad_stream)
+{
+    for (const auto& sample: make_samples())
+    {
+        if (!sample.exact)
+            continue;
+
+        auto extended = sample.response;
+        extended.push_back(0xff);
+        BOOST_REQUIRE_MESSAGE(fetch(sample, extended) == error::bad_stream,
+            sample.command);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(response_decoders__fetch__error_code__error)
+{
+    const auto failure = to_chunk(to_little_endian(
+        static_cast<uint32_t>(error::not_found)));
+
+    for (const auto& sample: make_samples())
+        BOOST_REQUIRE(fetch(sample, failure) == error::not_found);
+}
+
+BOOST_AUTO_TEST_CASE(response_decoders__notify__complete__success)
+{
+    BOOST_REQUIRE(notify(make_notification()) == error::success);
+}
+
+BOOST_AUTO_TEST_CASE(response_decoders__notify__truncated__bad_stream)
+{
+    const auto notification = make_notification();
+
+    // A code alone is the subscription acknowledgement.
+    for (auto size = sizeof(uint32_t) + 1; size < notification.size(); ++size)
+    {
+        const data_chunk truncated(notification.begin(),
+            notification.begin() + size);
+
+        BOOST_REQUIRE(notify(truncated) == error::bad_stream);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(response_decoders__notify__extended__bad_stream)
+{
+    auto extended = make_notification();
+    extended.push_back(0xff);
+    BOOST_REQUIRE(notify(extended) == error::bad_stream);
+}
+
+BOOST_AUTO_TEST_CASE(response_decoders__replay__random__dispatched)
+{
+    static const std::vector<std::string> commands
+    {
+        "blockchain.fetch_last_height",
+        "blockchain.fetch_transaction_index",
+        "blockchain.fetch_block_header",
+        "blockchain.fetch_transaction",
+        "blockchain.fetch_block",
+        "blockchain.fetch_compact_filter",
+        "blockchain.fetch_compact_filter_headers",
+        "blockchain.fetch_compact_filter_checkpoint",
+        "blockchain.fetch_block_transaction_hashes",
+        "blockchain.fetch_history4",
+        "notification.key",
+        "server.version"
+    };
+
+    // Fixed seed, so that failures are reproducible.
+    std::mt19937 generator(42);
+    std::uniform_int_distribution<uint32_t> bytes(0, 255);
+    std::uniform_int_distribution<size_t> sizes(0, 300);
+    obelisk_client client;
+
+    for (const auto& command: commands)
+    {
+        for (size_t round = 0; round < 100; ++round)
+        {
+            data_chunk payload(sizes(generator));
+            for (auto& byte: payload)
+                byte = static_cast<uint8_t>(bytes(generator));
+
+            const traffic_record record{ true, 0, command, 1, payload };
+            BOOST_REQUIRE_EQUAL(client.replay({ record }), 1u);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
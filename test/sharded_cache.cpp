@@ -0,0 +1,155 @@
+/**
+ * Copyright (c) 2011-2019 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include <boost/test/test_tools.hpp>
+#include <boost/test/unit_test_suite.hpp>
+#include <bitcoin/client.hpp>
+
+using namespace bc::client;
+using namespace bc::system;
+
+// Keys are hashes so that they are striped over all shards.
+static hash_digest shard_key(uint32_t value)
+{
+    return sha256_hash(to_chunk(to_little_endian(value)));
+}
+
+static data_chunk shard_payload(uint32_t value)
+{
+    return data_chunk(16, static_cast<uint8_t>(value));
+}
+
+BOOST_AUTO_TEST_SUITE(offline)
+
+BOOST_AUTO_TEST_CASE(sharded_cache__fetch__stored__expected)
+{
+    sharded_cache cache(1000, 4);
+    cache.store(shard_key(1), data_chunk{ 1, 2, 3 });
+
+    data_chunk payload;
+    BOOST_REQUIRE(cache.fetch(shard_key(1), payload));
+    BOOST_REQUIRE(payload == (data_chunk{ 1, 2, 3 }));
+    BOOST_REQUIRE(!cache.fetch(shard_key(2), payload));
+    BOOST_REQUIRE_EQUAL(cache.size(), 3u);
+}
+
+BOOST_AUTO_TEST_CASE(sharded_cache__store__over_capacity__evicts_unreferenced)
+{
+    sharded_cache cache(4, 1);
+    cache.store(shard_key(1), data_chunk(2));
+    cache.store(shard_key(2), data_chunk(2));
+
+    // Referencing the first entry gives it a second chance.
+    data_chunk payload;
+    BOOST_REQUIRE(cache.fetch(shard_key(1), payload));
+    cache.store(shard_key(3), data_chunk(2));
+
+    BOOST_REQUIRE(cache.fetch(shard_key(1), payload));
+    BOOST_REQUIRE(!cache.fetch(shard_key(2), payload));
+    BOOST_REQUIRE(cache.fetch(shard_key(3), payload));
+    BOOST_REQUIRE_EQUAL(cache.size(), 4u);
+}
+
+BOOST_AUTO_TEST_CASE(sharded_cache__store__larger_than_shard__not_cached)
+{
+    // Each of the four shards holds a quarter of the capacity.
+    sharded_cache cache(16, 3);
+    cache.store(shard_key(1), data_chunk(5));
+
+    data_chunk payload;
+    BOOST_REQUIRE(!cache.fetch(shard_key(1), payload));
+    BOOST_REQUIRE_EQUAL(cache.size(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(sharded_cache__fetch__concurrent__expected)
+{
+    sharded_cache cache(1000000);
+    for (uint32_t value = 0; value < 256; ++value)
+        cache.store(shard_key(value), shard_payload(value));
+
+    std::vector<std::thread> threads;
+    std::vector<size_t> mismatches(8, 0);
+
+    for (size_t thread = 0; thread < mismatches.size(); ++thread)
+    {
+        threads.emplace_back([&cache, &mismatches, thread]()
+        {
+            data_chunk payload;
+            for (size_t round = 0; round < 100; ++round)
+            {
+                for (uint32_t value = 0; value < 256; ++value)
+                {
+                    if (!cache.fetch(shard_key(value), payload) ||
+                        payload != shard_payload(value))
+                        ++mismatches[thread];
+                }
+            }
+        });
+    }
+
+    for (auto& thread: threads)
+        thread.join();
+
+    for (const auto count: mismatches)
+        BOOST_REQUIRE_EQUAL(count, 0u);
+}
+
+// Writers overlap on keys and overflow every shard, so stores, second chance
+// evictions and reads race. Any payload read must belong to its key.
+BOOST_AUTO_TEST_CASE(sharded_cache__store__concurrent_evictions__consistent)
+{
+    static const size_t capacity = 1024;
+    static const uint32_t keys = 500;
+    sharded_cache cache(capacity, 4);
+
+    std::vector<std::thread> threads;
+    std::vector<size_t> mismatches(8, 0);
+
+    for (size_t thread = 0; thread < mismatches.size(); ++thread)
+    {
+        threads.emplace_back([&cache, &mismatches, thread]()
+        {
+            data_chunk payload;
+            for (uint32_t round = 0; round < 5000; ++round)
+            {
+                const auto value = static_cast<uint32_t>(
+                    (round * 7 + thread * 131) % keys);
+
+                if (cache.fetch(shard_key(value), payload) &&
+                    payload != shard_payload(value))
+                    ++mismatches[thread];
+
+                cache.store(shard_key(value), shard_payload(value));
+            }
+        });
+    }
+
+    for (auto& thread: threads)
+        thread.join();
+
+    for (const auto count: mismatches)
+        BOOST_REQUIRE_EQUAL(count, 0u);
+
+    BOOST_REQUIRE(cache.size() <= capacity);
+    BOOST_REQUIRE(cache.size() > 0u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,274 @@
+/**
+ * Copyright (c) 2011-2019 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <boost/test/test_tools.hpp>
+#include <boost/test/unit_test_suite.hpp>
+#include <bitcoin/client.hpp>
+
+using namespace bc::client;
+using namespace bc::system;
+
+static hash_digest make_key(uint32_t value)
+{
+    return sha256_hash(to_little_endian(value));
+}
+
+static void discard(const code&, const hash_digest&, uint16_t, size_t,
+    const hash_digest&)
+{
+}
+
+BOOST_AUTO_TEST_SUITE(offline)
+
+BOOST_AUTO_TEST_CASE(subscription_table__add__new_id__found)
+{
+    subscription_table table;
+    const auto handler = table.register_handler(discard);
+
+    BOOST_REQUIRE(table.add(7, make_key(7), handler, 3, 42));
+    BOOST_REQUIRE(!table.add(7, make_key(8), handler));
+    BOOST_REQUIRE_EQUAL(table.size(), 1u);
+
+    const auto slot = table.find(7);
+    BOOST_REQUIRE(slot != subscription_table::not_found);
+    BOOST_REQUIRE_EQUAL(table.id(slot), 7u);
+    BOOST_REQUIRE(table.key(slot) == make_key(7));
+    BOOST_REQUIRE_EQUAL(table.sequence(slot), 3u);
+    BOOST_REQUIRE_EQUAL(table.height(slot), 42u);
+    BOOST_REQUIRE(table.find(8) == subscription_table::not_found);
+}
+
+BOOST_AUTO_TEST_CASE(subscription_table__remove__first__last_moved)
+{
+    subscription_table table;
+    const auto handler = table.register_handler(discard);
+    BOOST_REQUIRE(table.add(1, make_key(1), handler));
+    BOOST_REQUIRE(table.add(2, make_key(2), handler));
+    BOOST_REQUIRE(table.add(3, make_key(3), handler));
+
+    BOOST_REQUIRE(table.remove(1));
+    BOOST_REQUIRE(!table.remove(1));
+    BOOST_REQUIRE_EQUAL(table.size(), 2u);
+    BOOST_REQUIRE(table.find(1) == subscription_table::not_found);
+
+    const auto slot = table.find(3);
+    BOOST_REQUIRE_EQUAL(slot, 0u);
+    BOOST_REQUIRE(table.key(slot) == make_key(3));
+    BOOST_REQUIRE(table.key(table.find(2)) == make_key(2));
+}
+
+BOOST_AUTO_TEST_CASE(subscription_table__set_position__slot__updated)
+{
+    subscription_table table;
+    const auto handler = table.register_handler(discard);
+    BOOST_REQUIRE(table.add(5, make_key(5), handler));
+
+    const auto slot = table.find(5);
+    table.set_position(slot, 9, 100);
+    BOOST_REQUIRE_EQUAL(table.sequence(slot), 9u);
+    BOOST_REQUIRE_EQUAL(table.height(slot), 100u);
+}
+
+BOOST_AUTO_TEST_CASE(subscription_table__update_position__lower_height__retained)
+{
+    subscription_table table;
+    const auto handler = table.register_handler(discard);
+    BOOST_REQUIRE(table.add(5, make_key(5), handler, 1, 500));
+
+    const auto slot = table.find(5);
+    table.update_position(slot, 2, 400);
+    BOOST_REQUIRE_EQUAL(table.sequence(slot), 2u);
+    BOOST_REQUIRE_EQUAL(table.height(slot), 500u);
+
+    table.update_position(slot, 3, 600);
+    BOOST_REQUIRE_EQUAL(table.sequence(slot), 3u);
+    BOOST_REQUIRE_EQUAL(table.height(slot), 600u);
+}
+
+BOOST_AUTO_TEST_CASE(subscription_table__recycle_positions__removed__reused_only_after)
+{
+    subscription_table table;
+    const auto handler = table.register_handler(discard);
+    BOOST_REQUIRE(table.add(1, make_key(1), handler, 1, 100));
+
+    // A removal in the copy leaves the position of the original intact.
+    subscription_table copy(table);
+    BOOST_REQUIRE(copy.remove(1));
+    BOOST_REQUIRE(copy.add(2, make_key(2), handler, 2, 200));
+    BOOST_REQUIRE_EQUAL(table.height(table.find(1)), 100u);
+
+    // Once recycled the position is reused, the original no longer in use.
+    const auto released = copy.release_positions();
+    BOOST_REQUIRE_EQUAL(released.size(), 1u);
+    BOOST_REQUIRE(copy.release_positions().empty());
+    copy.recycle_positions(released);
+    BOOST_REQUIRE(copy.add(3, make_key(3), handler, 3, 300));
+    BOOST_REQUIRE_EQUAL(table.height(table.find(1)), 300u);
+    BOOST_REQUIRE_EQUAL(copy.height(copy.find(2)), 200u);
+}
+
+BOOST_AUTO_TEST_CASE(subscription_table__add__many__positions_retained)
+{
+    static const uint32_t count = 10000;
+    subscription_table table;
+    const auto handler = table.register_handler(discard);
+
+    // Positions span several storage chunks.
+    for (uint32_t id = 0; id < count; ++id)
+        BOOST_REQUIRE(table.add(id, make_key(id), handler,
+            static_cast<uint16_t>(id), id * 2));
+
+    for (uint32_t id = 0; id < count; ++id)
+    {
+        const auto slot = table.find(id);
+        BOOST_REQUIRE_EQUAL(table.sequence(slot), static_cast<uint16_t>(id));
+        BOOST_REQUIRE_EQUAL(table.height(slot), id * 2);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(subscription_table__release_handler__subscribed__retained_until_removed)
+{
+    subscription_table table;
+    const auto token = std::make_shared<int>(0);
+    const auto handler = table.register_handler(
+        [token](const code&, const hash_digest&, uint16_t, size_t,
+            const hash_digest&) {});
+
+    BOOST_REQUIRE(table.add(1, make_key(1), handler));
+    BOOST_REQUIRE(table.add(2, make_key(2), handler));
+    table.release_handler(handler);
+    BOOST_REQUIRE_EQUAL(token.use_count(), 2);
+
+    size_t calls = 0;
+    const auto counted = [&](const code&, const hash_digest&, uint16_t,
+        size_t, const hash_digest&) { ++calls; };
+    table.get_handler(table.find(1))(error::success, {}, 0, 0, {});
+    BOOST_REQUIRE_EQUAL(calls, 0u);
+
+    BOOST_REQUIRE(table.remove(1));
+    BOOST_REQUIRE_EQUAL(token.use_count(), 2);
+    BOOST_REQUIRE(table.remove(2));
+    BOOST_REQUIRE_EQUAL(token.use_count(), 1);
+
+    // The released registry entry is reused.
+    BOOST_REQUIRE_EQUAL(table.register_handler(counted), handler);
+    BOOST_REQUIRE(table.add(3, make_key(3), handler));
+    table.get_handler(table.find(3))(error::success, {}, 0, 0, {});
+    BOOST_REQUIRE_EQUAL(calls, 1u);
+}
+
+BOOST_AUTO_TEST_CASE(subscription_table__remove__many__remaining_found)
+{
+    static const uint32_t count = 10000;
+    subscription_table table;
+    const auto handler = table.register_handler(discard);
+
+    for (uint32_t id = 0; id < count; ++id)
+        BOOST_REQUIRE(table.add(id, make_key(id), handler));
+
+    for (uint32_t id = 0; id < count; id += 2)
+        BOOST_REQUIRE(table.remove(id));
+
+    BOOST_REQUIRE_EQUAL(table.size(), count / 2);
+
+    for (uint32_t id = 0; id < count; ++id)
+    {
+        const auto slot = table.find(id);
+
+        if (id % 2 == 0)
+        {
+            BOOST_REQUIRE(slot == subscription_table::not_found);
+            continue;
+        }
+
+        BOOST_REQUIRE(slot != subscription_table::not_found);
+        BOOST_REQUIRE(table.key(slot) == make_key(id));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(subscription_table__copy__set_position__shared)
+{
+    subscription_table table;
+    const auto handler = table.register_handler(discard);
+    BOOST_REQUIRE(table.add(1, make_key(1), handler));
+    table.release_handler(handler);
+
+    const subscription_table snapshot(table);
+    snapshot.set_position(snapshot.find(1), 4, 200);
+    BOOST_REQUIRE_EQUAL(table.sequence(table.find(1)), 4u);
+    BOOST_REQUIRE_EQUAL(table.height(table.find(1)), 200u);
+}
+
+BOOST_AUTO_TEST_CASE(subscription_table__copy__remove__original_unchanged)
+{
+    subscription_table table;
+    const auto handler = table.register_handler(discard);
+    BOOST_REQUIRE(table.add(1, make_key(1), handler));
+    BOOST_REQUIRE(table.add(2, make_key(2), handler));
+
+    subscription_table copy(table);
+    BOOST_REQUIRE(copy.remove(1));
+    BOOST_REQUIRE_EQUAL(copy.size(), 1u);
+    BOOST_REQUIRE_EQUAL(table.size(), 2u);
+    BOOST_REQUIRE(table.key(table.find(1)) == make_key(1));
+}
+
+BOOST_AUTO_TEST_CASE(subscription_table__copy__many_modified__original_unchanged)
+{
+    static const uint32_t count = 10000;
+    subscription_table table;
+    const auto handler = table.register_handler(discard);
+
+    for (uint32_t id = 0; id < count; ++id)
+        BOOST_REQUIRE(table.add(id, make_key(id), handler));
+
+    // Writes to the copy span shared chunks of slots, index and registry.
+    subscription_table copy(table);
+    BOOST_REQUIRE(copy.remove(0));
+    BOOST_REQUIRE(copy.remove(count / 2));
+    BOOST_REQUIRE(copy.add(count, make_key(count),
+        copy.register_handler(discard)));
+
+    BOOST_REQUIRE_EQUAL(copy.size(), count - 1);
+    BOOST_REQUIRE_EQUAL(table.size(), count);
+    BOOST_REQUIRE(table.find(count) == subscription_table::not_found);
+    BOOST_REQUIRE(copy.find(0) == subscription_table::not_found);
+
+    for (uint32_t id = 0; id < count; ++id)
+        BOOST_REQUIRE(table.key(table.find(id)) == make_key(id));
+
+    for (uint32_t id = 1; id <= count; ++id)
+        if (id != count / 2)
+            BOOST_REQUIRE(copy.key(copy.find(id)) == make_key(id));
+}
+
+BOOST_AUTO_TEST_CASE(subscription_table__clear__populated__empty)
+{
+    subscription_table table;
+    const auto handler = table.register_handler(discard);
+    BOOST_REQUIRE(table.add(1, make_key(1), handler));
+    table.clear();
+
+    BOOST_REQUIRE(table.empty());
+    BOOST_REQUIRE(table.find(1) == subscription_table::not_found);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
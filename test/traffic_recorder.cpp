@@ -0,0 +1,261 @@
+/**
+ * Copyright (c) 2011-2019 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cstdint>
+#include <sstream>
+#include <boost/test/test_tools.hpp>
+#include <boost/test/unit_test_suite.hpp>
+#include <bitcoin/client.hpp>
+
+using namespace bc::client;
+using namespace bc::system;
+
+static const uint32_t success = 0;
+
+BOOST_AUTO_TEST_SUITE(offline)
+
+BOOST_AUTO_TEST_CASE(traffic_recorder__load__recorded__round_trips)
+{
+    std::stringstream stream;
+    traffic_recorder recorder(stream);
+    recorder.record(false, "blockchain.fetch_last_height", 7, {});
+    recorder.record(true, "blockchain.fetch_last_height", 7, { 1, 2, 3 });
+    recorder.flush();
+
+    traffic_record::list records;
+    BOOST_REQUIRE(traffic_recorder::load(stream, records));
+    BOOST_REQUIRE_EQUAL(records.size(), 2u);
+    BOOST_REQUIRE(!records[0].response);
+    BOOST_REQUIRE(records[1].response);
+    BOOST_REQUIRE_EQUAL(records[1].command, "blockchain.fetch_last_height");
+    BOOST_REQUIRE_EQUAL(records[1].id, 7u);
+    BOOST_REQUIRE(records[1].payload == (data_chunk{ 1, 2, 3 }));
+    BOOST_REQUIRE(records[0].timestamp <= records[1].timestamp);
+}
+
+BOOST_AUTO_TEST_CASE(traffic_recorder__load__invalid_version__false)
+{
+    std::stringstream stream(std::string{ 2, 0, 0, 0 });
+
+    traffic_record::list records;
+    BOOST_REQUIRE(!traffic_recorder::load(stream, records));
+}
+
+BOOST_AUTO_TEST_CASE(traffic_recorder__load__oversized_payload__false)
+{
+    std::stringstream stream;
+    ostream_writer sink(stream);
+    sink.write_4_bytes_little_endian(traffic_recorder::version);
+    sink.write_byte(1);
+    sink.write_variable_little_endian(0);
+    sink.write_string("blockchain.fetch_last_height");
+    sink.write_4_bytes_little_endian(7);
+    sink.write_size_little_endian(max_uint32);
+    sink.write_bytes(data_chunk{ 1, 2, 3 });
+    stream.flush();
+
+    traffic_record::list records;
+    BOOST_REQUIRE(!traffic_recorder::load(stream, records));
+}
+
+BOOST_AUTO_TEST_CASE(traffic_recorder__load__oversized_command__false)
+{
+    std::stringstream stream;
+    ostream_writer sink(stream);
+    sink.write_4_bytes_little_endian(traffic_recorder::version);
+    sink.write_byte(1);
+    sink.write_variable_little_endian(0);
+    sink.write_size_little_endian(max_uint32);
+    stream.flush();
+
+    traffic_record::list records;
+    BOOST_REQUIRE(!traffic_recorder::load(stream, records));
+}
+
+BOOST_AUTO_TEST_CASE(obelisk_client__replay__responses__dispatched)
+{
+    const auto height = build_chunk(
+    {
+        to_little_endian(success),
+        to_little_endian(uint32_t(42))
+    });
+
+    const auto hashes = build_chunk(
+    {
+        to_little_endian(success),
+        null_hash,
+        null_hash
+    });
+
+    const auto notification = build_chunk(
+    {
+        to_little_endian(success),
+        to_little_endian(uint16_t(1)),
+        to_little_endian(uint32_t(42)),
+        null_hash
+    });
+
+    const traffic_record::list records
+    {
+        { false, 0, "blockchain.fetch_last_height", 1, {} },
+        { true, 1, "blockchain.fetch_last_height", 1, height },
+        { true, 2, "blockchain.fetch_block_transaction_hashes", 2, hashes },
+        { true, 3, "notification.key", 3, notification },
+        { true, 4, "unknown.command", 4, {} }
+    };
+
+    obelisk_client client;
+    BOOST_REQUIRE_EQUAL(client.replay(records), 3u);
+}
+
+BOOST_AUTO_TEST_CASE(obelisk_client__replay__live_request_id__unaffected)
+{
+    const auto height = build_chunk(
+    {
+        to_little_endian(success),
+        to_little_endian(uint32_t(42))
+    });
+
+    obelisk_client client;
+
+    // Playback of another command leaves the request unanswered.
+    client.set_playback({ { false, 0, "server.version", 1, {} } });
+
+    auto calls = 0;
+    code result;
+    client.blockchain_fetch_last_height([&](const code& ec, size_t)
+    {
+        ++calls;
+        result = ec;
+    });
+
+    BOOST_REQUIRE_EQUAL(client.replay(
+    {
+        { true, 0, "blockchain.fetch_last_height", 1, height }
+    }), 1u);
+
+    BOOST_REQUIRE_EQUAL(calls, 0);
+    client.wait(10);
+    BOOST_REQUIRE_EQUAL(calls, 1);
+    BOOST_REQUIRE_EQUAL(result, error::channel_timeout);
+}
+
+BOOST_AUTO_TEST_CASE(obelisk_client__replay__live_subscription_id__unaffected)
+{
+    const auto key = sha256_hash(data_chunk{ 42 });
+    const auto notification = build_chunk(
+    {
+        to_little_endian(success),
+        to_little_endian(uint16_t(1)),
+        to_little_endian(uint32_t(42)),
+        null_hash
+    });
+
+    obelisk_client client;
+    client.set_playback({ { false, 0, "server.version", 1, {} } });
+
+    auto notifications = 0;
+    const auto subscription = client.subscribe_key(
+        [&](const code&, uint16_t, size_t height, const hash_digest&)
+        {
+            if (height != 0)
+                ++notifications;
+        }, key);
+
+    BOOST_REQUIRE(subscription != obelisk_client::null_subscription);
+    BOOST_REQUIRE_EQUAL(client.replay(
+    {
+        { true, 0, "notification.key", subscription, notification }
+    }), 1u);
+
+    client_state state;
+    client.save_subscriptions(state);
+    BOOST_REQUIRE_EQUAL(notifications, 0);
+    BOOST_REQUIRE_EQUAL(state.subscriptions.size(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(obelisk_client__set_playback__recorded_request__answered)
+{
+    const auto height = build_chunk(
+    {
+        to_little_endian(success),
+        to_little_endian(uint32_t(42))
+    });
+
+    obelisk_client client;
+    client.set_playback(
+    {
+        { false, 0, "blockchain.fetch_last_height", 9, {} },
+        { true, 1, "blockchain.fetch_last_height", 9, height }
+    });
+
+    code result(error::unknown);
+    size_t value = 0;
+    const auto handler = [&](const code& ec, size_t height)
+    {
+        result = ec;
+        value = height;
+    };
+
+    client.blockchain_fetch_last_height(handler);
+    client.wait(1000);
+    BOOST_REQUIRE_EQUAL(result, error::success);
+    BOOST_REQUIRE_EQUAL(value, 42u);
+
+    // Each recorded request answers once.
+    client.blockchain_fetch_last_height(handler);
+    client.wait(10);
+    BOOST_REQUIRE_EQUAL(result, error::channel_timeout);
+}
+
+BOOST_AUTO_TEST_CASE(obelisk_client__set_playback__subscription__notified)
+{
+    const auto key = sha256_hash(data_chunk{ 42 });
+    const auto notification = build_chunk(
+    {
+        to_little_endian(success),
+        to_little_endian(uint16_t(1)),
+        to_little_endian(uint32_t(42)),
+        bitcoin_hash(data_chunk{ 1 })
+    });
+
+    obelisk_client client;
+    client.set_playback(
+    {
+        { false, 0, "subscribe.key", 3, to_chunk(key) },
+        { true, 1, "notification.key", 3, notification }
+    });
+
+    size_t notified = 0;
+    hash_digest tx_hash = null_hash;
+    client.subscribe_key([&](const code& ec, uint16_t, size_t height,
+        const hash_digest& hash)
+    {
+        if (!ec && height != 0)
+        {
+            notified = height;
+            tx_hash = hash;
+        }
+    }, key);
+
+    client.monitor(10);
+    BOOST_REQUIRE_EQUAL(notified, 42u);
+    BOOST_REQUIRE(tx_hash == bitcoin_hash(data_chunk{ 1 }));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,274 @@
+/**
+ * Copyright (c) 2011-2019 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cstdint>
+#include <boost/test/test_tools.hpp>
+#include <boost/test/unit_test_suite.hpp>
+#include <bitcoin/client.hpp>
+
+using namespace bc::client;
+using namespace bc::system;
+using namespace bc::system::chain;
+
+// The regtest limit, satisfied by about half of all hashes.
+static const uint32_t easy_bits = 0x207fffff;
+
+// Headers linked from the previous hash with nonces ground to satisfy work.
+static header_buffer make_chain(const hash_digest& previous, size_t count)
+{
+    header_buffer buffer(1, count);
+    auto parent = previous;
+
+    for (size_t index = 0; index < count; ++index)
+    {
+        header item(1, parent, null_hash, 1000 + index, easy_bits, 0);
+        while (!verify_proof_of_work(easy_bits, item.hash()))
+            item.set_nonce(item.nonce() + 1);
+
+        buffer.set(index, item);
+        parent = item.hash();
+    }
+
+    return buffer;
+}
+
+static const uint32_t success = 0;
+
+static transaction make_transaction(const hash_digest& previous)
+{
+    return
+    {
+        1, 0,
+        { input(output_point(previous, 0), script(), max_uint32) },
+        { output(1000, script()) }
+    };
+}
+
+// A client that answers the request with the response, verifying results.
+static void play(obelisk_client& client, const std::string& command,
+    const data_chunk& request, const data_chunk& response)
+{
+    client.set_verification(true);
+    client.set_playback(
+    {
+        { false, 0, command, 1, request },
+        { true, 0, command, 1, build_chunk(
+        {
+            to_little_endian(success),
+            response
+        }) }
+    });
+}
+
+BOOST_AUTO_TEST_SUITE(offline)
+
+BOOST_AUTO_TEST_CASE(verification__merkle_root__empty__null_hash)
+{
+    BOOST_REQUIRE(merkle_root({}) == null_hash);
+}
+
+BOOST_AUTO_TEST_CASE(verification__merkle_root__one__same)
+{
+    const auto hash = bitcoin_hash(data_chunk{ 42 });
+    BOOST_REQUIRE(merkle_root({ hash }) == hash);
+}
+
+BOOST_AUTO_TEST_CASE(verification__merkle_root__odd__duplicates_last)
+{
+    const auto a = bitcoin_hash(data_chunk{ 1 });
+    const auto b = bitcoin_hash(data_chunk{ 2 });
+    const auto c = bitcoin_hash(data_chunk{ 3 });
+    const auto ab = bitcoin_hash(build_chunk({ a, b }));
+    const auto cc = bitcoin_hash(build_chunk({ c, c }));
+
+    BOOST_REQUIRE(merkle_root({ a, b }) == ab);
+    BOOST_REQUIRE(merkle_root({ a, b, c }) ==
+        bitcoin_hash(build_chunk({ ab, cc })));
+}
+
+BOOST_AUTO_TEST_CASE(verification__verify_proof_of_work__genesis__expected)
+{
+    const auto genesis = hash_literal(
+        "000000000019d6689c085ae165831e934ff763ae46a2a6c172b3f1b60a8ce26f");
+
+    BOOST_REQUIRE(verify_proof_of_work(0x1d00ffff, genesis));
+    BOOST_REQUIRE(!verify_proof_of_work(0x1b0404cb, genesis));
+    BOOST_REQUIRE(!verify_proof_of_work(0x1d00ffff, hash_literal(
+        "00000001019d6689c085ae165831e934ff763ae46a2a6c172b3f1b60a8ce26f0")));
+}
+
+BOOST_AUTO_TEST_CASE(verification__verify_proof_of_work__invalid_bits__false)
+{
+    BOOST_REQUIRE(!verify_proof_of_work(0, null_hash));
+    BOOST_REQUIRE(!verify_proof_of_work(0x1d80ffff, null_hash));
+    BOOST_REQUIRE(!verify_proof_of_work(0xff00ffff, null_hash));
+}
+
+BOOST_AUTO_TEST_CASE(verification__verify_header_chain__linked__true)
+{
+    const auto previous = bitcoin_hash(data_chunk{ 7 });
+    const auto buffer = make_chain(previous, 20);
+
+    hash_list hashes;
+    BOOST_REQUIRE(verify_header_chain(hashes, buffer, previous));
+    BOOST_REQUIRE_EQUAL(hashes.size(), 20u);
+
+    for (size_t index = 0; index < hashes.size(); ++index)
+        BOOST_REQUIRE(hashes[index] == buffer.header(index).hash());
+}
+
+BOOST_AUTO_TEST_CASE(verification__verify_header_chain__wrong_previous__false)
+{
+    const auto buffer = make_chain(null_hash, 3);
+
+    hash_list hashes;
+    BOOST_REQUIRE(!verify_header_chain(hashes, buffer,
+        bitcoin_hash(data_chunk{ 1 })));
+}
+
+BOOST_AUTO_TEST_CASE(verification__verify_header_chain__broken_link__false)
+{
+    auto buffer = make_chain(null_hash, 3);
+    buffer.data()[header_buffer::record_size + 4] ^= 0x01;
+
+    hash_list hashes;
+    BOOST_REQUIRE(!verify_header_chain(hashes, buffer, null_hash));
+}
+
+// Client verification.
+//-----------------------------------------------------------------------------
+
+BOOST_AUTO_TEST_CASE(verification__fetch_transaction__wrong_hash__bad_stream)
+{
+    const auto tx = make_transaction(bitcoin_hash(data_chunk{ 1 }));
+    const auto requested = make_transaction(bitcoin_hash(data_chunk{ 2 }));
+
+    obelisk_client client;
+    play(client, "blockchain.fetch_transaction", to_chunk(requested.hash()),
+        tx.to_data(true, true));
+
+    code result(error::unknown);
+    client.blockchain_fetch_transaction([&](const code& ec,
+        const transaction&)
+    {
+        result = ec;
+    }, requested.hash());
+
+    client.wait(1000);
+    BOOST_REQUIRE_EQUAL(result, error::bad_stream);
+}
+
+BOOST_AUTO_TEST_CASE(verification__fetch_transaction__matching_hash__success)
+{
+    const auto tx = make_transaction(bitcoin_hash(data_chunk{ 1 }));
+
+    obelisk_client client;
+    play(client, "blockchain.fetch_transaction", to_chunk(tx.hash()),
+        tx.to_data(true, true));
+
+    code result(error::unknown);
+    hash_digest hash = null_hash;
+    client.blockchain_fetch_transaction([&](const code& ec,
+        const transaction& value)
+    {
+        result = ec;
+        hash = value.hash();
+    }, tx.hash());
+
+    client.wait(1000);
+    BOOST_REQUIRE_EQUAL(result, error::success);
+    BOOST_REQUIRE(hash == tx.hash());
+}
+
+BOOST_AUTO_TEST_CASE(verification__fetch_block_header__wrong_hash__bad_stream)
+{
+    const header served(1, null_hash, null_hash, 0, easy_bits, 0);
+    const header requested(1, null_hash, null_hash, 0, easy_bits, 1);
+
+    obelisk_client client;
+    play(client, "blockchain.fetch_block_header", to_chunk(requested.hash()),
+        served.to_data());
+
+    code result(error::unknown);
+    client.blockchain_fetch_block_header([&](const code& ec, const header&)
+    {
+        result = ec;
+    }, requested.hash());
+
+    client.wait(1000);
+    BOOST_REQUIRE_EQUAL(result, error::bad_stream);
+}
+
+// The header commits to a merkle root other than that of the transactions.
+BOOST_AUTO_TEST_CASE(verification__fetch_block__tampered_merkle_root__merkle_mismatch)
+{
+    const auto tx = make_transaction(bitcoin_hash(data_chunk{ 1 }));
+    const header tampered(1, null_hash, bitcoin_hash(data_chunk{ 2 }), 0,
+        easy_bits, 0);
+    const block served(tampered, { tx });
+
+    // By hash the block matches the requested hash, but not its root.
+    obelisk_client by_hash;
+    play(by_hash, "blockchain.fetch_block", to_chunk(tampered.hash()),
+        served.to_data());
+
+    code result(error::unknown);
+    by_hash.blockchain_fetch_block([&](const code& ec, const block&)
+    {
+        result = ec;
+    }, tampered.hash());
+
+    by_hash.wait(1000);
+    BOOST_REQUIRE_EQUAL(result, error::merkle_mismatch);
+
+    obelisk_client by_height;
+    play(by_height, "blockchain.fetch_block",
+        to_chunk(to_little_endian(uint32_t(42))), served.to_data());
+
+    result = error::unknown;
+    by_height.blockchain_fetch_block([&](const code& ec, const block&)
+    {
+        result = ec;
+    }, uint32_t(42));
+
+    by_height.wait(1000);
+    BOOST_REQUIRE_EQUAL(result, error::merkle_mismatch);
+}
+
+BOOST_AUTO_TEST_CASE(verification__fetch_block__matching_merkle_root__success)
+{
+    const auto tx = make_transaction(bitcoin_hash(data_chunk{ 1 }));
+    const header committed(1, null_hash, merkle_root({ tx.hash() }), 0,
+        easy_bits, 0);
+    const block served(committed, { tx });
+
+    obelisk_client client;
+    play(client, "blockchain.fetch_block", to_chunk(committed.hash()),
+        served.to_data());
+
+    code result(error::unknown);
+    client.blockchain_fetch_block([&](const code& ec, const block&)
+    {
+        result = ec;
+    }, committed.hash());
+
+    client.wait(1000);
+    BOOST_REQUIRE_EQUAL(result, error::success);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
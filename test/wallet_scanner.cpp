@@ -0,0 +1,177 @@
+/**
+ * Copyright (c) 2011-2019 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cstdint>
+#include <set>
+#include <boost/test/test_tools.hpp>
+#include <boost/test/unit_test_suite.hpp>
+#include <bitcoin/client.hpp>
+
+using namespace bc::client;
+using namespace bc::system;
+using namespace bc::system::wallet;
+
+// BIP32 test vector 1, chain m.
+static const hd_public test_key("xpub661MyMwAqRbcFtXgS5sYJABqqG9YLmC4Q1Rdap9gSE8NqtwybGhePY2gZ29ESFjqJoCu1Rupje8YtGqsefD265TMg7usUDFdp6W1EGMcet8");
+
+static const uint32_t success = 0;
+
+// [ kind:1 ][ hash:32 ][ index:4 ][ height:4 ][ value:8 ], an output row.
+static data_chunk output_row(uint32_t height)
+{
+    return build_chunk(
+    {
+        to_array(0),
+        bitcoin_hash(to_chunk(to_little_endian(height))),
+        to_little_endian(uint32_t(0)),
+        to_little_endian(height),
+        to_little_endian(uint64_t(1000))
+    });
+}
+
+// Record the history query of each index below count, those used with a row.
+static traffic_record::list make_history(const wallet_scanner& scanner,
+    uint32_t count, const std::set<uint32_t>& used, uint32_t from_height=0)
+{
+    traffic_record::list records;
+    for (uint32_t index = 0; index < count; ++index)
+    {
+        const auto key = script_key(
+            scanner.derive_address(index).output_script());
+        const auto request = build_chunk(
+        {
+            key,
+            to_little_endian(from_height)
+        });
+
+        const auto response = used.count(index) == 0 ?
+            to_chunk(to_little_endian(success)) :
+            build_chunk({ to_little_endian(success), output_row(100) });
+
+        records.push_back({ false, 0, "blockchain.fetch_history4", index,
+            request });
+        records.push_back({ true, 0, "blockchain.fetch_history4", index,
+            response });
+    }
+
+    return records;
+}
+
+static const wallet_scanner::settings test_settings
+{
+    3,
+    2,
+    payment_address::mainnet_p2kh,
+    100
+};
+
+BOOST_AUTO_TEST_SUITE(offline)
+
+BOOST_AUTO_TEST_CASE(wallet_scanner__scan__unused__stops_at_gap_limit)
+{
+    obelisk_client client;
+    wallet_scanner scanner(client, test_key, test_settings);
+    client.set_playback(make_history(scanner, 10, {}));
+
+    size_t found = 0;
+    wallet_scanner::checkpoint position{ 0, 0, 0 };
+    const auto ec = scanner.scan(position,
+        [&](uint32_t, const hash_digest&, const history::list&)
+        {
+            ++found;
+        });
+
+    BOOST_REQUIRE_EQUAL(ec, error::success);
+    BOOST_REQUIRE_EQUAL(found, 0u);
+    BOOST_REQUIRE_EQUAL(position.next_index, 3u);
+    BOOST_REQUIRE_EQUAL(position.used_count, 0u);
+}
+
+BOOST_AUTO_TEST_CASE(wallet_scanner__scan__used__horizon_extended)
+{
+    obelisk_client client;
+    wallet_scanner scanner(client, test_key, test_settings);
+    client.set_playback(make_history(scanner, 12, { 1, 4 }));
+
+    std::set<uint32_t> found;
+    size_t rounds = 0;
+    wallet_scanner::checkpoint position{ 0, 0, 0 };
+    const auto ec = scanner.scan(position,
+        [&](uint32_t index, const hash_digest& key, const history::list& rows)
+        {
+            BOOST_REQUIRE(key == script_key(
+                scanner.derive_address(index).output_script()));
+            BOOST_REQUIRE_EQUAL(rows.size(), 1u);
+            found.insert(index);
+        },
+        [&](const wallet_scanner::checkpoint&)
+        {
+            ++rounds;
+        });
+
+    BOOST_REQUIRE_EQUAL(ec, error::success);
+    BOOST_REQUIRE(found == (std::set<uint32_t>{ 1, 4 }));
+
+    // Index 4 is within the gap of index 1, so the gap extends to index 8.
+    BOOST_REQUIRE_EQUAL(position.used_count, 5u);
+    BOOST_REQUIRE_EQUAL(position.next_index, 8u);
+
+    // Rounds of at most concurrency queries: [0,2) [2,4) [4,5) [5,7) [7,8).
+    BOOST_REQUIRE_EQUAL(rounds, 5u);
+}
+
+BOOST_AUTO_TEST_CASE(wallet_scanner__scan__unanswered__resumable)
+{
+    obelisk_client client;
+    wallet_scanner scanner(client, test_key, test_settings);
+
+    // Index 2 is not recorded and so times out.
+    auto records = make_history(scanner, 10, { 1 });
+    records.erase(records.begin() + 4, records.begin() + 6);
+    client.set_playback(records);
+
+    wallet_scanner::checkpoint position{ 0, 0, 0 };
+    const auto ec = scanner.scan(position,
+        [](uint32_t, const hash_digest&, const history::list&) {});
+
+    BOOST_REQUIRE_EQUAL(ec, error::channel_timeout);
+    BOOST_REQUIRE_EQUAL(position.next_index, 2u);
+    BOOST_REQUIRE_EQUAL(position.used_count, 2u);
+}
+
+BOOST_AUTO_TEST_CASE(wallet_scanner__scan__checkpoint__resumes_from_height)
+{
+    obelisk_client client;
+    wallet_scanner scanner(client, test_key, test_settings);
+    client.set_playback(make_history(scanner, 10, { 6 }, 500));
+
+    std::set<uint32_t> found;
+    wallet_scanner::checkpoint position{ 5, 5, 500 };
+    const auto ec = scanner.scan(position,
+        [&](uint32_t index, const hash_digest&, const history::list&)
+        {
+            found.insert(index);
+        });
+
+    BOOST_REQUIRE_EQUAL(ec, error::success);
+    BOOST_REQUIRE(found == (std::set<uint32_t>{ 6 }));
+    BOOST_REQUIRE_EQUAL(position.used_count, 7u);
+    BOOST_REQUIRE_EQUAL(position.next_index, 10u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
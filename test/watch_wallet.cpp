@@ -0,0 +1,251 @@
+/**
+ * Copyright (c) 2011-2019 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cstdint>
+#include <boost/test/test_tools.hpp>
+#include <boost/test/unit_test_suite.hpp>
+#include <bitcoin/client.hpp>
+
+using namespace bc::client;
+using namespace bc::system;
+using namespace bc::system::wallet;
+
+// BIP32 test vector 1, chain m.
+static const hd_public test_key("xpub661MyMwAqRbcFtXgS5sYJABqqG9YLmC4Q1Rdap9gSE8NqtwybGhePY2gZ29ESFjqJoCu1Rupje8YtGqsefD265TMg7usUDFdp6W1EGMcet8");
+
+static const uint32_t success = 0;
+
+static const watch_wallet::settings test_settings
+{
+    2,
+    payment_address::mainnet_p2kh,
+    2,
+    4,
+    100
+};
+
+// [ kind:1 ][ hash:32 ][ index:4 ][ height:4 ][ value:8 ], an output row.
+static data_chunk output_row(uint32_t index, uint64_t value)
+{
+    return build_chunk(
+    {
+        to_array(0),
+        bitcoin_hash(to_chunk(to_little_endian(value))),
+        to_little_endian(index),
+        to_little_endian(uint32_t(100)),
+        to_little_endian(value)
+    });
+}
+
+static hash_digest chain_key(uint32_t chain, uint32_t index)
+{
+    return watch_wallet::derive_keys(test_key.derive_public(chain), index, 1,
+        payment_address::mainnet_p2kh, 1).front();
+}
+
+// Record a history query of the key, answered with the rows.
+static void add_history(traffic_record::list& records,
+    const hash_digest& key, const data_chunk& rows={})
+{
+    const auto id = static_cast<uint32_t>(records.size());
+    records.push_back({ false, 0, "blockchain.fetch_history4", id,
+        build_chunk({ key, to_little_endian(uint32_t(0)) }) });
+    records.push_back({ true, 0, "blockchain.fetch_history4", id,
+        build_chunk({ to_little_endian(success), rows }) });
+}
+
+// Record a subscription of the key, acknowledged and notified once.
+static void add_subscription(traffic_record::list& records,
+    const hash_digest& key, uint16_t sequence)
+{
+    const auto id = static_cast<uint32_t>(records.size());
+    records.push_back({ false, 0, "subscribe.key", id, to_chunk(key) });
+    records.push_back({ true, 0, "subscribe.key", id,
+        to_chunk(to_little_endian(success)) });
+    records.push_back({ true, 0, "notification.key", id, build_chunk(
+    {
+        to_little_endian(success),
+        to_little_endian(sequence),
+        to_little_endian(uint32_t(0)),
+        bitcoin_hash(to_chunk(to_little_endian(sequence)))
+    }) });
+}
+
+// Receive keys 1 and 3 and change key 0 are used, and the first eight
+// receive and four change keys are recorded for the load and each refresh.
+// Receive key 1 is notified once for each subscription, and its output is
+// spent as of the first refresh.
+static traffic_record::list make_wallet_playback(size_t refreshes=1)
+{
+    using wallet = watch_wallet;
+    traffic_record::list records;
+
+    for (size_t round = 0; round <= refreshes; ++round)
+    {
+        for (uint32_t index = 0; index < 8; ++index)
+        {
+            const auto key = chain_key(wallet::receive_chain, index);
+            if (index == 1 && round == 0)
+                add_history(records, key, output_row(0, 1000));
+            else if (index == 3)
+                add_history(records, key, output_row(1, 2000));
+            else
+                add_history(records, key);
+        }
+
+        for (uint32_t index = 0; index < 4; ++index)
+            add_history(records, chain_key(wallet::change_chain, index),
+                index == 0 ? output_row(2, 500) : data_chunk{});
+
+        add_subscription(records, chain_key(wallet::receive_chain, 1),
+            static_cast<uint16_t>(round + 1));
+    }
+
+    return records;
+}
+
+BOOST_AUTO_TEST_SUITE(offline)
+
+BOOST_AUTO_TEST_CASE(watch_wallet__derive_keys__threads__matches_scanner)
+{
+    obelisk_client client;
+    const wallet_scanner scanner(client, test_key);
+    const auto version = payment_address::mainnet_p2kh;
+
+    const auto keys = watch_wallet::derive_keys(test_key, 5, 30, version, 4);
+    BOOST_REQUIRE_EQUAL(keys.size(), 30u);
+
+    for (uint32_t index = 0; index < keys.size(); ++index)
+        BOOST_REQUIRE(keys[index] == script_key(
+            scanner.derive_address(5 + index).output_script()));
+}
+
+BOOST_AUTO_TEST_CASE(watch_wallet__derive_keys__more_threads_than_keys__expected)
+{
+    obelisk_client client;
+    const wallet_scanner scanner(client, test_key);
+    const auto version = payment_address::mainnet_p2kh;
+
+    const auto keys = watch_wallet::derive_keys(test_key, 7, 1, version, 16);
+    BOOST_REQUIRE_EQUAL(keys.size(), 1u);
+    BOOST_REQUIRE(keys.front() == script_key(
+        scanner.derive_address(7).output_script()));
+    BOOST_REQUIRE(watch_wallet::derive_keys(test_key, 0, 0, version, 0).empty());
+}
+
+BOOST_AUTO_TEST_CASE(watch_wallet__construct__account__empty)
+{
+    obelisk_client client;
+    const watch_wallet wallet(client, test_key);
+    BOOST_REQUIRE_EQUAL(wallet.derived_count(watch_wallet::receive_chain), 0u);
+    BOOST_REQUIRE_EQUAL(wallet.used_count(watch_wallet::change_chain), 0u);
+    BOOST_REQUIRE_EQUAL(wallet.pending(), 0u);
+    BOOST_REQUIRE_EQUAL(wallet.balance(), 0u);
+    BOOST_REQUIRE(wallet.unspent_outputs().empty());
+}
+
+BOOST_AUTO_TEST_CASE(watch_wallet__load__used_keys__indexed_and_extended)
+{
+    using wallet = watch_wallet;
+    obelisk_client client;
+    client.set_playback(make_wallet_playback());
+
+    wallet watch(client, test_key, test_settings);
+    BOOST_REQUIRE_EQUAL(watch.load(), error::success);
+    BOOST_REQUIRE_EQUAL(watch.pending(), 0u);
+
+    // Each chain starts with a round of four keys. Receive key 3 is used so
+    // the receive chain is extended by another round, not only to its gap.
+    BOOST_REQUIRE_EQUAL(watch.used_count(wallet::receive_chain), 4u);
+    BOOST_REQUIRE_EQUAL(watch.derived_count(wallet::receive_chain), 8u);
+    BOOST_REQUIRE_EQUAL(watch.used_count(wallet::change_chain), 1u);
+    BOOST_REQUIRE_EQUAL(watch.derived_count(wallet::change_chain), 4u);
+    BOOST_REQUIRE(watch.key(wallet::receive_chain, 7) ==
+        chain_key(wallet::receive_chain, 7));
+
+    BOOST_REQUIRE_EQUAL(watch.balance(), 3500u);
+    const auto outputs = watch.unspent_outputs();
+    BOOST_REQUIRE_EQUAL(outputs.size(), 3u);
+
+    // Each output is indexed by its point index to the key that holds it.
+    const hash_list holders
+    {
+        chain_key(wallet::receive_chain, 1),
+        chain_key(wallet::receive_chain, 3),
+        chain_key(wallet::change_chain, 0)
+    };
+
+    for (const auto& output: outputs)
+    {
+        BOOST_REQUIRE_LT(output.point.index(), holders.size());
+        BOOST_REQUIRE(output.key == holders[output.point.index()]);
+        BOOST_REQUIRE_EQUAL(output.height, 100u);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(watch_wallet__refresh__notified_key__reapplied)
+{
+    using wallet = watch_wallet;
+    obelisk_client client;
+    client.set_playback(make_wallet_playback());
+
+    wallet watch(client, test_key, test_settings);
+    BOOST_REQUIRE_EQUAL(watch.load(), error::success);
+    BOOST_REQUIRE_EQUAL(watch.balance(), 3500u);
+
+    // The subscription acknowledgement is not a notification.
+    client.monitor(10);
+    BOOST_REQUIRE_EQUAL(watch.pending(), 1u);
+    BOOST_REQUIRE(watch.stale());
+
+    // The spent output of receive key 1 leaves the index, the key stays used.
+    BOOST_REQUIRE_EQUAL(watch.refresh(), error::success);
+    BOOST_REQUIRE_EQUAL(watch.pending(), 0u);
+    BOOST_REQUIRE_EQUAL(watch.balance(), 2500u);
+    BOOST_REQUIRE_EQUAL(watch.unspent_outputs().size(), 2u);
+    BOOST_REQUIRE_EQUAL(watch.used_count(wallet::receive_chain), 4u);
+    BOOST_REQUIRE_EQUAL(watch.derived_count(wallet::receive_chain), 8u);
+}
+
+BOOST_AUTO_TEST_CASE(watch_wallet__refresh__after_monitor_return__notified)
+{
+    obelisk_client client;
+    client.set_playback(make_wallet_playback(2));
+
+    watch_wallet watch(client, test_key, test_settings);
+    BOOST_REQUIRE_EQUAL(watch.load(), error::success);
+    BOOST_REQUIRE(!watch.stale());
+
+    // Subscriptions end as monitor returns.
+    client.monitor(10);
+    BOOST_REQUIRE_EQUAL(watch.pending(), 1u);
+    BOOST_REQUIRE(watch.stale());
+
+    // The refresh renews the subscriptions, so the key is notified again.
+    BOOST_REQUIRE_EQUAL(watch.refresh(), error::success);
+    BOOST_REQUIRE(!watch.stale());
+    BOOST_REQUIRE_EQUAL(watch.pending(), 0u);
+
+    client.monitor(10);
+    BOOST_REQUIRE_EQUAL(watch.pending(), 1u);
+    BOOST_REQUIRE_EQUAL(watch.refresh(), error::success);
+    BOOST_REQUIRE_EQUAL(watch.pending(), 0u);
+    BOOST_REQUIRE_EQUAL(watch.balance(), 2500u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()